@@ -0,0 +1,22 @@
+/***********************************************************************
+ * ActiveTileSet.hpp
+ *
+ * The set of tiles of a mesh in which the solution may change during
+ * the next time step. Kernels given an active tile set are launched
+ * only over those tiles; everywhere else the solution is dry and at
+ * rest and its time derivative is zero.
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef ActiveTileSet_hpp
+#define ActiveTileSet_hpp
+
+#include "FieldVector.hpp"
+
+template<typename MeshType>
+class ActiveTileSet;
+
+#include "ActiveTileSets/Cartesian2DMesh.hpp"
+
+#endif
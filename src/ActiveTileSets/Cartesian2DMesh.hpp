@@ -0,0 +1,998 @@
+/***********************************************************************
+ * ActiveTileSets/Cartesian2DMesh.hpp
+ *
+ * Active tile set for a Cartesian mesh. The mesh is divided into
+ * square tiles of cells. A tile is "seeded" if any of its cells is wet
+ * (or has non-zero velocity) or is receiving a boundary inflow, and is
+ * active if it or any of its eight neighbours is seeded.
+ *
+ * Each tile carries two flags: bit 0 is set if the tile is active now
+ * and bit 1 if it was active before the last accepted step. Kernels run
+ * over every tile with either flag set, so a tile that has just become
+ * inactive is calculated for one more step. That step writes zero time
+ * derivatives, slopes and fluxes over the tile and leaves both copies
+ * of the solution state equal, so nothing stale is left behind when
+ * the tile is then skipped.
+ *
+ * The flags and the list of tiles to calculate are kept on the device,
+ * and the list is rebuilt there by a prefix sum over the flags, so
+ * that updating the tiles after each step does not wait for the
+ * device. Kernels are launched with a work-group for each tile of a
+ * bound on the length of the list, which the host reads back where it
+ * synchronises with the device anyway (see bound_launches()). Tiles
+ * become active only next to seeded ones, and a step can only seed a
+ * listed tile, so each update lengthens the list by at most a ring of
+ * tiles around it; the bound for several updates ahead is the number
+ * of tiles within that many tiles of one listed now. Work-groups
+ * beyond the end of the list return at once. Updates beyond those the
+ * bound was found for, and updates after the boundaries change, fall
+ * back to launching over every tile until the next bound.
+ *
+ * The spread of a disturbance within a single step is two cells per
+ * Runge-Kutta stage, so the tile size must be at least twice the
+ * number of stages for the one-tile halo to contain it.
+ *
+ * For local time stepping (see TemporalSchemes/LocalTimestep.hpp)
+ * each tile is also given a time step level, and a list of the tiles
+ * to be calculated is kept for each sub-step of a cycle. The lists are
+ * built on the device by the same scan as the list of active tiles,
+ * and as each is part of that list, kernels over them are launched
+ * with the same bound. The levels of adjacent wet tiles differ by at
+ * most one, so that the step changes gradually across the flow. A
+ * tile with no wet cells is left out of that and takes the longest
+ * step, so a disturbance cannot cross it within a cycle and the
+ * one-tile halo still contains it.
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef ActiveTileSets_Cartesian2DMesh_hpp
+#define ActiveTileSets_Cartesian2DMesh_hpp
+
+#include "../Meshes/Cartesian2DMesh.hpp"
+#include "../StepClock.hpp"
+
+// Device-side view of the list of tiles to be calculated. Kernels are
+// launched with one work-group per slot of the list (see
+// ActiveTileSet::get_range()); each work-item finds its cell from its
+// group and local ids.
+class Cartesian2DMeshActiveTileMap
+{
+public:
+
+  using ListAccessor =
+    DataArray<uint32_t>::Accessor<sycl::access::mode::read>;
+
+private:
+
+  ListAccessor list_ro_;
+  ListAccessor counts_ro_;
+  size_t count_index_;
+  size_t offset_;
+  size_t tile_size_;
+  size_t nx_;
+  size_t ny_;
+
+public:
+
+  // The list is the pairs starting at pair offset, and their number is
+  // element count_index of counts
+  Cartesian2DMeshActiveTileMap(const ListAccessor& list_ro,
+			       const ListAccessor& counts_ro,
+			       const size_t& count_index,
+			       const size_t& offset,
+			       const size_t& tile_size,
+			       const size_t& nx,
+			       const size_t& ny)
+    : list_ro_(list_ro),
+      counts_ro_(counts_ro),
+      count_index_(count_index),
+      offset_(offset),
+      tile_size_(tile_size),
+      nx_(nx), ny_(ny)
+  {}
+
+  size_t nx(void) const
+  {
+    return nx_;
+  }
+
+  size_t ny(void) const
+  {
+    return ny_;
+  }
+
+  // Get the (x, y) index of the cell for this work-item. Returns false
+  // if the work-item is beyond the end of the list or the edge of the
+  // mesh.
+  bool get_cell(const sycl::nd_item<2>& item, size_t& i, size_t& j) const
+  {
+    size_t slot = item.get_group(0);
+    if (slot >= counts_ro_[count_index_]) return false;
+    slot += offset_;
+    i = list_ro_[2 * slot] * tile_size_ + item.get_local_id(1);
+    j = list_ro_[2 * slot + 1] * tile_size_ + item.get_local_id(0);
+    return (i < nx_ and j < ny_);
+  }
+
+};
+
+// Run a cell kernel, providing calculate(i, j), over the active tiles
+template<typename Kernel>
+class ActiveTileCellKernel
+{
+private:
+
+  Cartesian2DMeshActiveTileMap map_;
+  Kernel kernel_;
+
+public:
+
+  ActiveTileCellKernel(const Cartesian2DMeshActiveTileMap& map,
+		       const Kernel& kernel)
+    : map_(map), kernel_(kernel)
+  {}
+
+  void operator()(sycl::nd_item<2> item) const
+  {
+    size_t i, j;
+    if (map_.get_cell(item, i, j)) {
+      kernel_.calculate(i, j);
+    }
+  }
+
+};
+
+// Run a kernel for the faces normal to the D-direction, providing
+// calculate(i, j) for the face with (x, y) index (i, j), over the
+// active tiles. Each cell calculates the face on its upstream side;
+// the cells at the far edge of the mesh also calculate the edge face.
+template<typename Kernel, int D>
+class ActiveTileFaceKernel
+{
+private:
+
+  Cartesian2DMeshActiveTileMap map_;
+  Kernel kernel_;
+
+public:
+
+  ActiveTileFaceKernel(const Cartesian2DMeshActiveTileMap& map,
+		       const Kernel& kernel)
+    : map_(map), kernel_(kernel)
+  {}
+
+  void operator()(sycl::nd_item<2> item) const
+  {
+    size_t i, j;
+    if (map_.get_cell(item, i, j)) {
+      kernel_.calculate(i, j);
+      if (D == 0 and i + 1 == map_.nx()) {
+	kernel_.calculate(i + 1, j);
+      } else if (D == 1 and j + 1 == map_.ny()) {
+	kernel_.calculate(i, j + 1);
+      }
+    }
+  }
+
+};
+
+// Run an elementwise kernel, called with the id of a cell, over the
+// active tiles
+template<typename Kernel>
+class ActiveTileElementKernel
+{
+private:
+
+  Cartesian2DMeshActiveTileMap map_;
+  Kernel kernel_;
+
+public:
+
+  ActiveTileElementKernel(const Cartesian2DMeshActiveTileMap& map,
+			  const Kernel& kernel)
+    : map_(map), kernel_(kernel)
+  {}
+
+  void operator()(sycl::nd_item<2> item) const
+  {
+    size_t i, j;
+    if (map_.get_cell(item, i, j)) {
+      kernel_(sycl::id<1>(j * map_.nx() + i));
+    }
+  }
+
+};
+
+// As ActiveTileElementKernel, for a kernel that also combines a value
+// into a reduction
+template<typename Kernel>
+class ActiveTileElementReductionKernel
+{
+private:
+
+  Cartesian2DMeshActiveTileMap map_;
+  Kernel kernel_;
+
+public:
+
+  ActiveTileElementReductionKernel(const Cartesian2DMeshActiveTileMap& map,
+				   const Kernel& kernel)
+    : map_(map), kernel_(kernel)
+  {}
+
+  template<typename Reducer>
+  void operator()(sycl::nd_item<2> item, Reducer& reducer) const
+  {
+    size_t i, j;
+    if (map_.get_cell(item, i, j)) {
+      kernel_(sycl::id<1>(j * map_.nx() + i), reducer);
+    }
+  }
+
+};
+
+// Device-side view of the time step level of each tile
+class Cartesian2DMeshTileLevelMap
+{
+public:
+
+  using LevelAccessor =
+    DataArray<uint32_t>::Accessor<sycl::access::mode::read>;
+
+private:
+
+  LevelAccessor levels_ro_;
+  size_t tile_size_;
+  size_t ntx_;
+
+public:
+
+  Cartesian2DMeshTileLevelMap(const LevelAccessor& levels_ro,
+			      const size_t& tile_size,
+			      const size_t& ntx)
+    : levels_ro_(levels_ro),
+      tile_size_(tile_size),
+      ntx_(ntx)
+  {}
+
+  // Level of the cell with (x, y) index (i, j)
+  uint32_t level(const size_t& i, const size_t& j) const
+  {
+    return levels_ro_[(j / tile_size_) * ntx_ + (i / tile_size_)];
+  }
+
+};
+
+template<>
+class ActiveTileSet<Cartesian2DMesh>
+{
+public:
+
+  using MeshType = Cartesian2DMesh;
+  using MapType = Cartesian2DMeshActiveTileMap;
+  using LevelMapType = Cartesian2DMeshTileLevelMap;
+
+private:
+
+  std::shared_ptr<sycl::queue> queue_;
+  size_t tile_size_;
+  size_t nx_;
+  size_t ny_;
+  size_t ntx_;
+  size_t nty_;
+
+  // Number of tiles scanned by each work-group of compact(), and the
+  // number of those work-groups
+  size_t scan_block_;
+  size_t scan_blocks_;
+
+  // Per-tile activity flags and seeds
+  DataArray<uint32_t> flags_;
+  DataArray<uint32_t> seeds_;
+
+  // Place of each active tile in the list among those of its scan
+  // block, and the number of active tiles in each block (then, once
+  // scanned, the place in the list of the first of them)
+  DataArray<uint32_t> offsets_;
+  DataArray<uint32_t> block_sums_;
+
+  // (x, y) indices of the tiles to be calculated. Only as many pairs
+  // as the single element of count_ are valid.
+  DataArray<uint32_t> list_;
+  DataArray<uint32_t> count_;
+
+  // Tiles within a given distance of a listed tile along rows, then in
+  // both directions, and the number of the latter (see bound_launches())
+  DataArray<uint32_t> row_reach_;
+  DataArray<uint32_t> reach_;
+  DataArray<uint32_t> reach_count_;
+
+  // Number of work-groups kernels over the list of active tiles are
+  // launched with, and the number of further updates it covers
+  size_t launch_count_;
+  size_t launch_updates_;
+
+  // Time step level of each tile for local time stepping, and the
+  // largest control number per unit time step of its cells (zero for a
+  // tile with no wet cells), which are kept while the levels are
+  // smoothed in levels_smoothed_
+  DataArray<uint32_t> levels_;
+  DataArray<uint32_t> levels_smoothed_;
+  DataArray<float> tile_rates_;
+  size_t max_level_;
+
+  // Lists of the tiles to be calculated at each sub-step of a local
+  // time stepping cycle, each of tile_count() pairs (see
+  // level_list_index()), and the number of tiles in each. The marks,
+  // offsets and block sums are those of scan_marks() for each list.
+  // Allocated on first use.
+  std::shared_ptr<DataArray<uint32_t>> level_lists_;
+  std::shared_ptr<DataArray<uint32_t>> level_counts_;
+  std::shared_ptr<DataArray<uint32_t>> level_marks_;
+  std::shared_ptr<DataArray<uint32_t>> level_offsets_;
+  std::shared_ptr<DataArray<uint32_t>> level_sums_;
+
+  // Index of the level list kernels are launched over, or -1 for the
+  // list of active tiles
+  int selected_list_;
+
+  // The host backend has no barriers for the block scan, so each block
+  // there is a single tile and the single task scans them all
+  static size_t scan_block_size(const sycl::queue& queue)
+  {
+#ifdef MORGFLOW_HOST_BACKEND
+    return 1;
+#else
+    return std::min((size_t) 256, queue.get_device().get_info<sycl::info::device::max_work_group_size>());
+#endif
+  }
+
+  // Place the marked tiles of each of the lists segments of marks,
+  // which has tile_count() marks per list, in a list in row order on
+  // the device. Each work-group scans the marks of a block of tiles in
+  // local memory to place its marked tiles within the block, and a
+  // single task then scans the block totals to place the blocks. The
+  // place of marked tile t of list s is then
+  // sums[s * scan_blocks_ + t / scan_block_] + offsets[s * tile_count() + t],
+  // and element s of counts is the number of them.
+  void scan_marks(const DataArray<uint32_t>& marks,
+		  const size_t& lists,
+		  DataArray<uint32_t>& offsets,
+		  DataArray<uint32_t>& sums,
+		  DataArray<uint32_t>& counts)
+  {
+    size_t ntiles = tile_count();
+    size_t block = scan_block_;
+    size_t nblocks = scan_blocks_;
+
+    queue_->submit([&] (sycl::handler& cgh) {
+      auto marks_ro = marks.get_read_accessor(cgh);
+      auto offsets_wo = offsets.get_write_accessor(cgh);
+      auto sums_wo = sums.get_write_accessor(cgh);
+      sycl::accessor<uint32_t, 1, sycl::access::mode::read_write,
+		     sycl::access::target::local> scan(sycl::range<1>(block),
+						       cgh);
+
+      cgh.parallel_for(sycl::nd_range<1>(sycl::range<1>(lists * nblocks * block),
+				         sycl::range<1>(block)),
+		       [=](sycl::nd_item<1> item) {
+	size_t group = item.get_group(0);
+	size_t l = item.get_local_id(0);
+	size_t t = (group % nblocks) * block + l;
+	size_t m = (group / nblocks) * ntiles + t;
+	uint32_t active = (t < ntiles and marks_ro[m] != 0 ? 1 : 0);
+
+	// Inclusive scan of the block
+	scan[l] = active;
+	for (size_t d = 1; d < block; d *= 2) {
+	  item.barrier(sycl::access::fence_space::local_space);
+	  uint32_t x = (l >= d ? scan[l - d] : 0);
+	  item.barrier(sycl::access::fence_space::local_space);
+	  scan[l] += x;
+	}
+
+	if (t < ntiles) {
+	  offsets_wo[m] = scan[l] - active;
+	}
+	if (l + 1 == block) {
+	  sums_wo[group] = scan[l];
+	}
+      });
+    });
+
+    queue_->submit([&] (sycl::handler& cgh) {
+      auto sums_rw = sums.get_read_write_accessor(cgh);
+      auto counts_wo = counts.get_write_accessor(cgh);
+
+      cgh.single_task([=]() {
+	for (size_t s = 0; s < lists; ++s) {
+	  uint32_t total = 0;
+	  for (size_t b = s * nblocks; b < (s + 1) * nblocks; ++b) {
+	    uint32_t sum = sums_rw[b];
+	    sums_rw[b] = total;
+	    total += sum;
+	  }
+	  counts_wo[s] = total;
+	}
+      });
+    });
+  }
+
+  // Rebuild the tile list from the flags on the device, keeping the
+  // tiles in row order. Each active tile writes its index to the place
+  // scan_marks() gives it.
+  void compact(void)
+  {
+    size_t ntiles = tile_count();
+    size_t ntx = ntx_;
+    size_t block = scan_block_;
+
+    scan_marks(flags_, 1, offsets_, block_sums_, count_);
+
+    queue_->submit([&] (sycl::handler& cgh) {
+      auto flags_ro = flags_.get_read_accessor(cgh);
+      auto offsets_ro = offsets_.get_read_accessor(cgh);
+      auto sums_ro = block_sums_.get_read_accessor(cgh);
+      auto list_wo = list_.get_write_accessor(cgh);
+
+      cgh.parallel_for(sycl::range<1>(ntiles), [=](sycl::id<1> id) {
+	size_t t = id[0];
+	if (flags_ro[t] == 0) return;
+	size_t slot = sums_ro[t / block] + offsets_ro[t];
+	list_wo[2 * slot] = t % ntx;
+	list_wo[2 * slot + 1] = t / ntx;
+      });
+    });
+  }
+
+  // Set the flags of each tile from the seeds of it and its
+  // neighbours. new_step(), called in the kernel, says whether a step
+  // has been accepted since the last update.
+  template<typename NewStep>
+  void update_flags(sycl::handler& cgh, const NewStep& new_step)
+  {
+    auto seeds_ro = seeds_.get_read_accessor(cgh);
+    auto flags_rw = flags_.get_read_write_accessor(cgh);
+    size_t ntx = ntx_;
+    size_t nty = nty_;
+
+    cgh.parallel_for(sycl::range<2>(nty_, ntx_), [=](sycl::item<2> item) {
+      size_t ty = item.get_id(0);
+      size_t tx = item.get_id(1);
+      size_t y0 = (ty > 0 ? ty - 1 : 0);
+      size_t y1 = (ty + 1 < nty ? ty + 1 : ty);
+      size_t x0 = (tx > 0 ? tx - 1 : 0);
+      size_t x1 = (tx + 1 < ntx ? tx + 1 : tx);
+
+      uint32_t active = 0;
+      for (size_t y = y0; y <= y1; ++y) {
+	for (size_t x = x0; x <= x1; ++x) {
+	  active |= seeds_ro[y * ntx + x];
+	}
+      }
+
+      size_t t = item.get_linear_id();
+      uint32_t flags = flags_rw[t];
+      if (new_step()) {
+	flags = (flags & 1u) << 1;
+      }
+      flags_rw[t] = flags | active;
+    });
+  }
+
+  // Find the seeded tiles from the solution state and the boundary
+  // inflows
+  template<typename StateVector, typename BoundaryVector>
+  void update_seeds(const StateVector& U,
+		    const BoundaryVector& Q_in,
+		    const BoundaryVector& h_in)
+  {
+    queue_->submit([&] (sycl::handler& cgh) {
+      auto U_ro = U.get_read_accessor(cgh);
+      auto Q_ro = Q_in.get_reader(cgh);
+      auto h_ro = h_in.get_reader(cgh);
+      auto seeds_wo = seeds_.get_write_accessor(cgh);
+      size_t tile_size = tile_size_;
+      size_t nx = nx_;
+      size_t ny = ny_;
+
+      cgh.parallel_for(sycl::range<2>(nty_, ntx_), [=](sycl::item<2> item) {
+	size_t j0 = item.get_id(0) * tile_size;
+	size_t i0 = item.get_id(1) * tile_size;
+	size_t j1 = (j0 + tile_size < ny ? j0 + tile_size : ny);
+	size_t i1 = (i0 + tile_size < nx ? i0 + tile_size : nx);
+
+	// Non-zero and not NaN
+	auto nonzero = [](const auto& x) { return (x > 0 or x < 0); };
+
+	uint32_t seed = 0;
+	for (size_t j = j0; j < j1 and seed == 0; ++j) {
+	  for (size_t i = i0; i < i1 and seed == 0; ++i) {
+	    size_t c = j * nx + i;
+	    if (nonzero(U_ro[0][c]) or nonzero(U_ro[1][c]) or
+		nonzero(U_ro[2][c]) or
+		nonzero(Q_ro[0][c]) or nonzero(Q_ro[1][c]) or
+		h_ro[0][c] >= 0.0f or h_ro[1][c] >= 0.0f) {
+	      seed = 1;
+	    }
+	  }
+	}
+	seeds_wo[item.get_linear_id()] = seed;
+      });
+    });
+  }
+
+  // Use up one of the updates the launch bound covers, or launch over
+  // every tile if none are left
+  void count_update(void)
+  {
+    if (launch_updates_ > 0) {
+      launch_updates_--;
+    } else {
+      launch_count_ = tile_count();
+    }
+  }
+
+  // Rebuild the tile lists for each sub-step from the flags and levels
+  // on the device
+  void build_level_lists(const size_t& max_level)
+  {
+    size_t ntiles = tile_count();
+    size_t nlists = 2 * max_level + 1;
+    if (not level_lists_ or max_level != max_level_) {
+      level_lists_ = std::make_shared<DataArray<uint32_t>>
+	(queue_, 2 * nlists * ntiles, true, 0u);
+      level_counts_ = std::make_shared<DataArray<uint32_t>>
+	(queue_, nlists, true, 0u);
+      level_marks_ = std::make_shared<DataArray<uint32_t>>
+	(queue_, nlists * ntiles, true, 0u);
+      level_offsets_ = std::make_shared<DataArray<uint32_t>>
+	(queue_, nlists * ntiles, true, 0u);
+      level_sums_ = std::make_shared<DataArray<uint32_t>>
+	(queue_, nlists * scan_blocks_, true, 0u);
+      max_level_ = max_level;
+    }
+
+    size_t ntx = ntx_;
+    size_t nty = nty_;
+    size_t block = scan_block_;
+    size_t nblocks = scan_blocks_;
+    uint32_t max_lvl = max_level;
+    
+    queue_->submit([&] (sycl::handler& cgh) {
+      auto flags_ro = flags_.get_read_accessor(cgh);
+      auto levels_ro = levels_.get_read_accessor(cgh);
+      auto marks_wo = level_marks_->get_write_accessor(cgh);
+
+      cgh.parallel_for(sycl::range<2>(nlists, ntiles), [=](sycl::item<2> item) {
+	uint32_t l = item.get_id(0);
+	size_t t = item.get_id(1);
+	size_t tx = t % ntx;
+	size_t ty = t / ntx;
+	uint32_t listed = 0;
+	if (flags_ro[t] != 0) {
+	  // The level of a face is the lower of the levels of the cells
+	  // either side, so find the lowest level of the tile and its
+	  // four neighbours
+	  uint32_t level = levels_ro[t];
+	  uint32_t min_level = level;
+	  if (tx > 0) min_level = sycl::min(min_level, levels_ro[t - 1]);
+	  if (tx + 1 < ntx) min_level = sycl::min(min_level, levels_ro[t + 1]);
+	  if (ty > 0) min_level = sycl::min(min_level, levels_ro[t - ntx]);
+	  if (ty + 1 < nty) min_level = sycl::min(min_level, levels_ro[t + ntx]);
+
+	  if (l <= max_lvl) {
+	    // Even sub-steps: faces of level up to l start a step
+	    listed = (min_level <= l ? 1 : 0);
+	  } else {
+	    // Odd sub-steps: faces of level zero start a step and cells
+	    // of level up to l - max_level finish one
+	    listed = (min_level == 0 or level <= l - max_lvl ? 1 : 0);
+	  }
+	}
+	marks_wo[item.get_linear_id()] = listed;
+      });
+    });
+
+    scan_marks(*level_marks_, nlists, *level_offsets_, *level_sums_,
+	       *level_counts_);
+
+    queue_->submit([&] (sycl::handler& cgh) {
+      auto marks_ro = level_marks_->get_read_accessor(cgh);
+      auto offsets_ro = level_offsets_->get_read_accessor(cgh);
+      auto sums_ro = level_sums_->get_read_accessor(cgh);
+      auto lists_wo = level_lists_->get_write_accessor(cgh);
+
+      cgh.parallel_for(sycl::range<2>(nlists, ntiles), [=](sycl::item<2> item) {
+	size_t l = item.get_id(0);
+	size_t t = item.get_id(1);
+	size_t m = item.get_linear_id();
+	if (marks_ro[m] == 0) return;
+	size_t slot = l * ntiles + sums_ro[l * nblocks + t / block] + offsets_ro[m];
+	lists_wo[2 * slot] = t % ntx;
+	lists_wo[2 * slot + 1] = t / ntx;
+      });
+    });
+  }
+
+  // Lower the level of each wet tile to at most one more than that of
+  // any wet tile beside it. Each pass lowers levels by at most one, so
+  // max_level passes are enough. The passes alternate between levels_
+  // and levels_smoothed_, and an even number of them leaves the levels
+  // in levels_.
+  void smooth_levels(const size_t& max_level)
+  {
+    size_t ntx = ntx_;
+    size_t nty = nty_;
+    size_t npasses = max_level + max_level % 2;
+
+    for (size_t pass = 0; pass < npasses; ++pass) {
+      DataArray<uint32_t>& from = (pass % 2 == 0 ? levels_ : levels_smoothed_);
+      DataArray<uint32_t>& to = (pass % 2 == 0 ? levels_smoothed_ : levels_);
+
+      queue_->submit([&] (sycl::handler& cgh) {
+	auto rates_ro = tile_rates_.get_read_accessor(cgh);
+	auto from_ro = from.get_read_accessor(cgh);
+	auto to_wo = to.get_write_accessor(cgh);
+
+	cgh.parallel_for(sycl::range<2>(nty_, ntx_), [=](sycl::item<2> item) {
+	  size_t ty = item.get_id(0);
+	  size_t tx = item.get_id(1);
+	  size_t t = item.get_linear_id();
+	  uint32_t level = from_ro[t];
+	  if (rates_ro[t] > 0.0f) {
+	    auto lower = [&](const size_t& n) {
+	      if (rates_ro[n] > 0.0f) {
+		level = sycl::min(level, from_ro[n] + 1);
+	      }
+	    };
+	    if (tx > 0) lower(t - 1);
+	    if (tx + 1 < ntx) lower(t + 1);
+	    if (ty > 0) lower(t - ntx);
+	    if (ty + 1 < nty) lower(t + ntx);
+	  }
+	  to_wo[t] = level;
+	});
+      });
+    }
+  }
+
+public:
+
+  ActiveTileSet(const std::shared_ptr<sycl::queue>& queue,
+		const std::shared_ptr<MeshType>& mesh,
+		const size_t& tile_size)
+    : queue_(queue),
+      tile_size_(tile_size),
+      nx_(mesh->get_cell_index_size()[0]),
+      ny_(mesh->get_cell_index_size()[1]),
+      ntx_((nx_ + tile_size - 1) / tile_size),
+      nty_((ny_ + tile_size - 1) / tile_size),
+      scan_block_(scan_block_size(*queue)),
+      scan_blocks_((ntx_ * nty_ + scan_block_ - 1) / scan_block_),
+      flags_(queue, ntx_ * nty_, true, 3u),
+      seeds_(queue, ntx_ * nty_, true, 0u),
+      offsets_(queue, ntx_ * nty_, true, 0u),
+      block_sums_(queue, scan_blocks_, true, 0u),
+      list_(queue, 2 * ntx_ * nty_, true, 0u),
+      count_(queue, 1, true, 0u),
+      row_reach_(queue, ntx_ * nty_, true, 0u),
+      reach_(queue, ntx_ * nty_, true, 0u),
+      reach_count_(queue, 1, true, 0u),
+      launch_count_(ntx_ * nty_),
+      launch_updates_(0),
+      levels_(queue, ntx_ * nty_, true, 0u),
+      levels_smoothed_(queue, ntx_ * nty_, true, 0u),
+      tile_rates_(queue, ntx_ * nty_, true, 0.0f),
+      max_level_(0),
+      level_lists_(),
+      level_counts_(),
+      level_marks_(),
+      level_offsets_(),
+      level_sums_(),
+      selected_list_(-1)
+  {
+    // Every tile is calculated until the first update
+    compact();
+    std::cout << "Divided mesh into " << ntx_ << " x " << nty_
+	      << " active tiles of " << tile_size_ << " x " << tile_size_
+	      << " cells." << std::endl;
+  }
+
+  size_t tile_size(void) const
+  {
+    return tile_size_;
+  }
+
+  size_t tile_count(void) const
+  {
+    return ntx_ * nty_;
+  }
+
+  // Number of slots of the selected list that kernels are launched
+  // over. The number of active tiles is only known on the device, so
+  // this is the last bound found for the list of active tiles, which
+  // also bounds each level list.
+  size_t selected_count(void) const
+  {
+    return launch_count_;
+  }
+
+  // Launch kernels over the list of active tiles with enough
+  // work-groups for the list after up to the given number of further
+  // updates, and return that number of work-groups. This waits for
+  // the device, so should be called where the host synchronises with
+  // it anyway.
+  size_t bound_launches(const size_t& updates)
+  {
+    if (updates == 0) {
+      launch_count_ = count_.host_copy()[0];
+      launch_updates_ = 0;
+      return launch_count_;
+    }
+
+    size_t ntx = ntx_;
+    size_t nty = nty_;
+    size_t r = updates;
+
+    queue_->submit([&] (sycl::handler& cgh) {
+      auto flags_ro = flags_.get_read_accessor(cgh);
+      auto row_wo = row_reach_.get_write_accessor(cgh);
+
+      cgh.parallel_for(sycl::range<2>(nty_, ntx_), [=](sycl::item<2> item) {
+	size_t ty = item.get_id(0);
+	size_t tx = item.get_id(1);
+	size_t x0 = (tx > r ? tx - r : 0);
+	size_t x1 = (tx + r < ntx ? tx + r : ntx - 1);
+	uint32_t reached = 0;
+	for (size_t x = x0; x <= x1 and reached == 0; ++x) {
+	  reached = (flags_ro[ty * ntx + x] != 0 ? 1 : 0);
+	}
+	row_wo[item.get_linear_id()] = reached;
+      });
+    });
+
+    queue_->submit([&] (sycl::handler& cgh) {
+      auto row_ro = row_reach_.get_read_accessor(cgh);
+      auto reach_wo = reach_.get_write_accessor(cgh);
+
+      cgh.parallel_for(sycl::range<2>(nty_, ntx_), [=](sycl::item<2> item) {
+	size_t ty = item.get_id(0);
+	size_t tx = item.get_id(1);
+	size_t y0 = (ty > r ? ty - r : 0);
+	size_t y1 = (ty + r < nty ? ty + r : nty - 1);
+	uint32_t reached = 0;
+	for (size_t y = y0; y <= y1 and reached == 0; ++y) {
+	  reached = row_ro[y * ntx + tx];
+	}
+	reach_wo[item.get_linear_id()] = reached;
+      });
+    });
+
+    scan_marks(reach_, 1, offsets_, block_sums_, reach_count_);
+
+    launch_count_ = reach_count_.host_copy()[0];
+    launch_updates_ = updates;
+    return launch_count_;
+  }
+
+  MapType get_map(sycl::handler& cgh) const
+  {
+    if (selected_list_ < 0) {
+      return MapType(list_.get_read_accessor(cgh),
+		     count_.get_read_accessor(cgh), 0, 0,
+		     tile_size_, nx_, ny_);
+    }
+    return MapType(level_lists_->get_read_accessor(cgh),
+		   level_counts_->get_read_accessor(cgh), selected_list_,
+		   selected_list_ * tile_count(),
+		   tile_size_, nx_, ny_);
+  }
+
+  LevelMapType get_level_map(sycl::handler& cgh) const
+  {
+    return LevelMapType(levels_.get_read_accessor(cgh), tile_size_, ntx_);
+  }
+
+  // One work-group per slot of the selected list. There is always at
+  // least one work-group so that a launch with no tiles listed is still
+  // valid.
+  sycl::nd_range<2> get_range(void) const
+  {
+    size_t count = selected_count();
+    size_t groups = (count > 0 ? count : 1);
+    return sycl::nd_range<2>(sycl::range<2>(groups * tile_size_, tile_size_),
+			     sycl::range<2>(tile_size_, tile_size_));
+  }
+
+  template<typename Kernel>
+  void parallel_for_cells(sycl::handler& cgh, const Kernel& kernel) const
+  {
+    cgh.parallel_for(get_range(),
+		     ActiveTileCellKernel<Kernel>(get_map(cgh), kernel));
+  }
+
+  template<int D, typename Kernel>
+  void parallel_for_faces(sycl::handler& cgh, const Kernel& kernel) const
+  {
+    cgh.parallel_for(get_range(),
+		     ActiveTileFaceKernel<Kernel, D>(get_map(cgh), kernel));
+  }
+
+  template<typename Kernel>
+  void parallel_for_elements(sycl::handler& cgh, const Kernel& kernel) const
+  {
+    cgh.parallel_for(get_range(),
+		     ActiveTileElementKernel<Kernel>(get_map(cgh), kernel));
+  }
+
+  template<typename Reduction, typename Kernel>
+  void parallel_for_elements(sycl::handler& cgh,
+			     Reduction reduction,
+			     const Kernel& kernel) const
+  {
+    cgh.parallel_for(get_range(), reduction,
+		     ActiveTileElementReductionKernel<Kernel>(get_map(cgh),
+							      kernel));
+  }
+
+  // Recalculate the activity of each tile from the solution state and
+  // the boundary inflows. After an accepted step (new_step == true) the
+  // current flags are moved to the previous-step flags; otherwise
+  // (e.g. after updating boundaries) newly active tiles are added to
+  // the current flags, which may be anywhere.
+  template<typename StateVector, typename BoundaryVector>
+  void update(const StateVector& U,
+	      const BoundaryVector& Q_in,
+	      const BoundaryVector& h_in,
+	      bool new_step)
+  {
+    if (new_step) {
+      count_update();
+    } else {
+      launch_count_ = tile_count();
+      launch_updates_ = 0;
+    }
+    update_seeds(U, Q_in, h_in);
+    queue_->submit([&] (sycl::handler& cgh) {
+      update_flags(cgh, [=]() { return new_step; });
+    });
+    compact();
+  }
+
+  // As update(), after a step accepted or rejected on the device by
+  // the clock
+  template<typename StateVector, typename BoundaryVector, typename T>
+  void update(const StateVector& U,
+	      const BoundaryVector& Q_in,
+	      const BoundaryVector& h_in,
+	      const StepClock<T>& clock)
+  {
+    count_update();
+    update_seeds(U, Q_in, h_in);
+    queue_->submit([&] (sycl::handler& cgh) {
+      auto times = clock.get_times(cgh);
+      update_flags(cgh, [=]() { return times.step_accepted(); });
+    });
+    compact();
+  }
+
+  // Index of the level list for a sub-step of a local time stepping
+  // cycle. The tiles to calculate at sub-step s are those with a face
+  // starting a step at s or a cell finishing one at s, which depends
+  // only on the powers of two dividing s and s + 1. One of those is
+  // always odd, so there are 2 * max_level + 1 distinct lists.
+  static size_t level_list_index(size_t substep, const size_t& max_level)
+  {
+    auto trailing_zeros = [&](size_t n) {
+      size_t z = 0;
+      while (z < max_level and n % 2 == 0) {
+	n /= 2;
+	z++;
+      }
+      return z;
+    };
+    if (substep % 2 == 0) {
+      return trailing_zeros(substep);
+    } else {
+      return max_level + trailing_zeros(substep + 1);
+    }
+  }
+
+  // Launch kernels over the tiles to calculate at a sub-step of the
+  // current local time stepping cycle
+  void select_substep(const size_t& substep)
+  {
+    selected_list_ = level_list_index(substep, max_level_);
+  }
+
+  // Launch kernels over all the active tiles
+  void select_active(void)
+  {
+    selected_list_ = -1;
+  }
+
+  // Choose the time step level of each active tile for a local time
+  // stepping cycle of the length held by the clock, which is divided
+  // into 2^max_level sub-steps. A tile at level k takes steps of 2^k
+  // sub-steps: the longest for which the control number of each of
+  // its cells stays within courant_target, then lowered so that it is
+  // at most one more than that of a wet neighbour. The control number
+  // of each tile at its own step, per unit cycle length, is reduced
+  // into the clock's rate. The lists of tiles for each sub-step are
+  // then rebuilt.
+  template<typename StateVector, typename CellControlNumber>
+  void update_levels(const StateVector& U,
+		     const CellControlNumber& cell_cn,
+		     const StepClock<typename StateVector::ValueType>& clock,
+		     const double& courant_target,
+		     const size_t& max_level)
+  {
+    using ValueType = typename StateVector::ValueType;
+    
+    queue_->submit([&] (sycl::handler& cgh) {
+      auto U_ro = U.get_read_accessor(cgh);
+      auto flags_ro = flags_.get_read_accessor(cgh);
+      auto levels_wo = levels_.get_write_accessor(cgh);
+      auto rates_wo = tile_rates_.get_write_accessor(cgh);
+      auto times = clock.get_times(cgh);
+      size_t tile_size = tile_size_;
+      size_t nx = nx_;
+      size_t ny = ny_;
+      size_t ntx = ntx_;
+      uint32_t max_lvl = max_level;
+      double target = courant_target;
+
+      cgh.parallel_for(sycl::range<1>(ntx_ * nty_), [=](sycl::id<1> id) {
+	size_t t = id[0];
+	if (flags_ro[t] == 0) {
+	  levels_wo[t] = max_lvl;
+	  rates_wo[t] = 0.0f;
+	  return;
+	}
+	
+	size_t j0 = (t / ntx) * tile_size;
+	size_t i0 = (t % ntx) * tile_size;
+	size_t j1 = (j0 + tile_size < ny ? j0 + tile_size : ny);
+	size_t i1 = (i0 + tile_size < nx ? i0 + tile_size : nx);
+
+	ValueType r = 0.0f;
+	for (size_t j = j0; j < j1; ++j) {
+	  for (size_t i = i0; i < i1; ++i) {
+	    r = sycl::fmax(r, cell_cn(U_ro, j * nx + i));
+	  }
+	}
+
+	double dt_fine = times.timestep() / (1u << max_lvl);
+	uint32_t k = 0;
+	while (k < max_lvl and r * dt_fine * (2u << k) <= target) {
+	  k++;
+	}
+	levels_wo[t] = k;
+	rates_wo[t] = r;
+      });
+    });
+
+    smooth_levels(max_level);
+
+    queue_->submit([&] (sycl::handler& cgh) {
+      auto levels_ro = levels_.get_read_accessor(cgh);
+      auto rates_ro = tile_rates_.get_read_accessor(cgh);
+      auto rate = clock.get_rate_reduction(cgh);
+      uint32_t max_lvl = max_level;
+
+      cgh.parallel_for(sycl::range<1>(ntx_ * nty_), rate,
+		       [=](sycl::id<1> id, auto& max) {
+	size_t t = id[0];
+	max.combine((ValueType) rates_ro[t] * (ValueType) (1u << levels_ro[t])
+		    / (ValueType) (1u << max_lvl));
+      });
+    });
+
+    build_level_lists(max_level);
+  }
+
+};
+
+#endif
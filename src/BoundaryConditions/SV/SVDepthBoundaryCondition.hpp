@@ -7,13 +7,13 @@
 #ifndef BoundaryConditions_SV_SVDepthBoundaryCondition_hpp
 #define BoundaryConditions_SV_SVDepthBoundaryCondition_hpp
 
-template<typename FuncType>
-class DepthSVBoundaryCondition : public BoundaryCondition<SVSolver>
+template<typename Solver, typename FuncType>
+class DepthSVBoundaryCondition : public BoundaryCondition<Solver>
 {
 public:
 
-  using MeshType = typename SVSolver::MeshType;
-  using ValueType = typename SVSolver::ValueType;
+  using MeshType = typename Solver::MeshType;
+  using ValueType = typename Solver::ValueType;
 
 protected:
 
@@ -33,7 +33,7 @@ public:
   DepthSVBoundaryCondition(const std::string& name,
 			   const MeshSelection<MeshType, FieldMapping::Cell>& sel,
 			   const FieldFunctorType& value_functor)
-    : BoundaryCondition<SVSolver>(name),
+    : BoundaryCondition<Solver>(name),
       modifier_(name, sel, 0.0f, 1.0f,
 		std::numeric_limits<ValueType>::lowest(),
 		std::numeric_limits<ValueType>::max(),
@@ -41,12 +41,12 @@ public:
       functor_(value_functor)
   {}
   
-  virtual typename BoundaryCondition<SVSolver>::Variable get_variable(void) const
+  virtual typename BoundaryCondition<Solver>::Variable get_variable(void) const
   {
-    return BoundaryCondition<SVSolver>::Variable::h;
+    return BoundaryCondition<Solver>::Variable::h;
   }
   
-  virtual void update(TemporalScheme<SVSolver>& ts,
+  virtual void update(TemporalScheme<Solver>& ts,
 		      const double& t0, const double& t1) const
   {
     // Get the depth boundary field
@@ -47,14 +47,14 @@ create_boundary_condition(std::shared_ptr<SVSolver>& solver,
 }
 */
 
-template<typename Functor>
-std::shared_ptr<BoundaryCondition<SVSolver>>
-create_sv_boundary_condition(std::shared_ptr<SVSolver>& solver,
+template<typename Functor, FieldStorage SS, typename CT, typename P>
+std::shared_ptr<BoundaryCondition<SVSolver<SS,CT,P>>>
+create_sv_boundary_condition(std::shared_ptr<SVSolver<SS,CT,P>>& solver,
 			     const Config& conf)
 {
-  using MeshType = typename SVSolver::MeshType;
-  using ValueType = typename SVSolver::ValueType;
-  const FieldMapping MappingType = SVSolver::BCFieldMappingType;
+  using Solver = SVSolver<SS,CT,P>;
+  using MeshType = typename Solver::MeshType;
+  const FieldMapping MappingType = Solver::BCFieldMappingType;
 
   std::string bc_type_name = conf.get_value<std::string>();
   std::string bc_name = conf.get<std::string>("name");
@@ -64,21 +64,22 @@ create_sv_boundary_condition(std::shared_ptr<SVSolver>& solver,
   Functor func(solver->queue_ptr(), conf.get_child("values"));
   
   if (bc_type_name == "source") {
-    return std::make_shared<SourceSVBoundaryCondition<Functor>>(bc_name, sel, func);
+    return std::make_shared<SourceSVBoundaryCondition<Solver,Functor>>(bc_name, sel, func);
   } else if (bc_type_name == "depth") {
-    return std::make_shared<DepthSVBoundaryCondition<Functor>>(bc_name, sel, func);    
+    return std::make_shared<DepthSVBoundaryCondition<Solver,Functor>>(bc_name, sel, func);    
   } else {
     std::cerr << "Unknown boundary type: " << bc_type_name << std::endl;
     throw std::runtime_error("Unknown boundary type.");
   }
 }
 
-std::shared_ptr<BoundaryCondition<SVSolver>>
-create_sv_boundary_condition(std::shared_ptr<SVSolver>& solver,
+template<FieldStorage SS, typename CT, typename P>
+std::shared_ptr<BoundaryCondition<SVSolver<SS,CT,P>>>
+create_sv_boundary_condition(std::shared_ptr<SVSolver<SS,CT,P>>& solver,
 			     const Config& conf)
 {
-  using CoordType = typename SVSolver::MeshType::CoordType;
-  using ValueType = typename SVSolver::ValueType;
+  using CoordType = typename SVSolver<SS,CT,P>::MeshType::CoordType;
+  using ValueType = typename SVSolver<SS,CT,P>::ValueType;
   using boost::algorithm::to_lower_copy;
   
   const Config& value_conf = conf.get_child("values");
@@ -103,11 +104,11 @@ create_sv_boundary_condition(std::shared_ptr<SVSolver>& solver,
   }
 }
 
-template<>
-std::vector<std::shared_ptr<BoundaryCondition<SVSolver>>>
-create_boundary_conditions(std::shared_ptr<SVSolver>& solver)
+template<FieldStorage SS, typename CT, typename P>
+std::vector<std::shared_ptr<BoundaryCondition<SVSolver<SS,CT,P>>>>
+create_boundary_conditions(std::shared_ptr<SVSolver<SS,CT,P>>& solver)
 {
-  std::vector<std::shared_ptr<BoundaryCondition<SVSolver>>> bc;
+  std::vector<std::shared_ptr<BoundaryCondition<SVSolver<SS,CT,P>>>> bc;
 
   std::cout << "Initialising boundary conditions..." << std::endl;
   const Config& config = GlobalConfig::instance().configuration();
@@ -12,8 +12,8 @@
 #include "../TemporalScheme.hpp"
 #include "../SVSolver.hpp"
 
-template<>
-class BoundaryCondition<SVSolver>
+template<FieldStorage SS, typename CT, typename P>
+class BoundaryCondition<SVSolver<SS,CT,P>>
 {
 protected:
 
@@ -21,22 +21,23 @@ protected:
   
 public:
 
-  using MeshType = typename SVSolver::MeshType;
-  using ValueType = typename SVSolver::ValueType;
+  using SolverType = SVSolver<SS,CT,P>;
+  using MeshType = typename SolverType::MeshType;
+  using ValueType = typename SolverType::ValueType;
 
   enum class Variable {
     Q, h
   };
 
-  BoundaryCondition<SVSolver>(const std::string& name)
+  BoundaryCondition(const std::string& name)
     : name_(name)
   {}
 
-  virtual ~BoundaryCondition<SVSolver>(void) {}
+  virtual ~BoundaryCondition(void) {}
 
   const std::string& name(void) { return name_; }
 
-  virtual void update(TemporalScheme<SVSolver>& ts,
+  virtual void update(TemporalScheme<SolverType>& ts,
 		      const double& t0, const double& t1) const = 0;
   
   virtual Variable get_variable(void) const = 0;
@@ -53,8 +54,8 @@ create_boundary_condition(std::shared_ptr<SVSolver>& solver,
 			  const Config& conf);
 */
 
-template<>
-std::vector<std::shared_ptr<BoundaryCondition<SVSolver>>>
-create_boundary_conditions(std::shared_ptr<SVSolver>& solver);
+template<FieldStorage SS, typename CT, typename P>
+std::vector<std::shared_ptr<BoundaryCondition<SVSolver<SS,CT,P>>>>
+create_boundary_conditions(std::shared_ptr<SVSolver<SS,CT,P>>& solver);
 
 #endif
@@ -12,7 +12,8 @@
 template<typename T,
 	 typename MeshType,
 	 FieldMapping FM,
-	 size_t N>
+	 size_t N,
+	 FieldStorage FS = FieldStorage::Separate>
 class ControlNumber
 {
 public:
@@ -23,7 +24,7 @@ public:
   virtual ~ControlNumber(void)
   {}
 
-  virtual T calculate(const FieldVector<T,MeshType,FM,N>& U,
+  virtual T calculate(const FieldVector<T,MeshType,FM,N,FS>& U,
 		      const double& timestep) const = 0;
 };
 
@@ -7,9 +7,11 @@
 #ifndef ControlNumbers_SV_Cartesian2DMeshCell_hpp
 #define ControlNumbers_SV_Cartesian2DMeshCell_hpp
 
-template<typename T>
-class SVControlNumber<T, Cartesian2DMesh, FieldMapping::Cell, 3>
-  : public ControlNumber<T, Cartesian2DMesh, FieldMapping::Cell, 3>
+#include "Kernels/SVCellControlNumber.hpp"
+
+template<typename T, FieldStorage FS>
+class SVControlNumber<T, Cartesian2DMesh, FieldMapping::Cell, 3, FS>
+  : public ControlNumber<T, Cartesian2DMesh, FieldMapping::Cell, 3, FS>
 {
 public:
 
@@ -17,37 +19,51 @@ public:
   static const FieldMapping FM = FieldMapping::Cell;
   static const size_t N = 3;
 
-  SVControlNumber(void)
-    : ControlNumber<T, MeshType, FM, N>()
+private:
+
+  // Tiles to calculate; null to calculate the whole mesh. Cells outside
+  // the active tiles are dry and at rest, so have no control number.
+  std::shared_ptr<ActiveTileSet<MeshType>> active_tiles_;
+
+public:
+
+  SVControlNumber(const std::shared_ptr<ActiveTileSet<MeshType>>& active_tiles = nullptr)
+    : ControlNumber<T, MeshType, FM, N, FS>(),
+      active_tiles_(active_tiles)
   {}
 
   virtual ~SVControlNumber(void)
   {}
 
-  virtual T calculate(const FieldVector<T,MeshType,FM,N>& U,
+  virtual T calculate(const FieldVector<T,MeshType,FM,N,FS>& U,
 		      const double& timestep) const
   {
     T mcn = 0.0;
     sycl::buffer<T> maxCN_buf(&mcn, 1);
     
-    U.at(0).queue().submit([&] (sycl::handler& cgh) {
+    U.queue().submit([&] (sycl::handler& cgh) {
       auto U_ro = U.get_read_accessor(cgh);
 
       auto maxCN = sycl::reduction(maxCN_buf.get_access(cgh), sycl::maximum<T>());
 
       typename MeshType::CoordType cs = U.mesh_definition()->cell_size();
-      T dx = cs[0];
-      T dy = cs[1];
-
-      cgh.parallel_for(U.get_range(), maxCN,
-		       [=](sycl::id<1> id, auto& max) {
-			 T h = sycl::fmax(U_ro[0][id], 0.0f);
-			 T u = sycl::fabs(U_ro[1][id]);
-			 T v = sycl::fabs(U_ro[2][id]);
-			 T c = sycl::sqrt(9.81f * h);
-			 T cn = timestep * (((u+c) / dx) + ((v+c) / dy));
-			 max.combine(cn);
-		       });
+      SVCellControlNumber<T> cell_cn(cs[0], cs[1], timestep);
+
+      if (active_tiles_) {
+	auto map = active_tiles_->get_map(cgh);
+	cgh.parallel_for(active_tiles_->get_range(), maxCN,
+			 [=](sycl::nd_item<2> item, auto& max) {
+			   size_t i, j;
+			   if (map.get_cell(item, i, j)) {
+			     max.combine(cell_cn(U_ro, j * map.nx() + i));
+			   }
+			 });
+      } else {
+	cgh.parallel_for(U.get_range(), maxCN,
+			 [=](sycl::id<1> id, auto& max) {
+			   max.combine(cell_cn(U_ro, id[0]));
+			 });
+      }
     });
     return maxCN_buf.get_host_access()[0];
   }
@@ -0,0 +1,56 @@
+/***********************************************************************
+ * ControlNumbers/SV/Kernels/SVCellControlNumber.hpp
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef ControlNumbers_SV_Kernels_SVCellControlNumber_hpp
+#define ControlNumbers_SV_Kernels_SVCellControlNumber_hpp
+
+// Courant number of a single cell of size dx by dy for a given time
+// step. Can be copied into a kernel and applied to the state accessor
+// of any kernel that reads U.
+template<typename T>
+class SVCellControlNumber
+{
+public:
+
+  using ValueType = T;
+
+private:
+
+  ValueType dx_;
+  ValueType dy_;
+  ValueType timestep_;
+
+public:
+
+  SVCellControlNumber(const ValueType& dx,
+		      const ValueType& dy,
+		      const ValueType& timestep)
+    : dx_(dx), dy_(dy), timestep_(timestep)
+  {}
+
+  static ValueType calculate(const ValueType& h_in,
+			     const ValueType& u_in,
+			     const ValueType& v_in,
+			     const ValueType& dx,
+			     const ValueType& dy,
+			     const ValueType& timestep)
+  {
+    ValueType h = sycl::fmax(h_in, (ValueType) 0.0f);
+    ValueType u = sycl::fabs(u_in);
+    ValueType v = sycl::fabs(v_in);
+    ValueType c = sycl::sqrt(9.81f * h);
+    return timestep * (((u+c) / dx) + ((v+c) / dy));
+  }
+
+  template<typename StateAccessor>
+  ValueType operator()(const StateAccessor& U, const size_t& id) const
+  {
+    return calculate(U[0][id], U[1][id], U[2][id], dx_, dy_, timestep_);
+  }
+
+};
+
+#endif
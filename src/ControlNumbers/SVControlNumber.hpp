@@ -8,24 +8,26 @@
 #define ControlNumbers_SVControlNumber_hpp
 
 #include "../ControlNumber.hpp"
+#include "../ActiveTileSet.hpp"
 
 template<typename T,
 	 typename MeshType,
 	 FieldMapping FM,
-	 size_t N>
+	 size_t N,
+	 FieldStorage FS = FieldStorage::Separate>
 class SVControlNumber
-  : public ControlNumber<T, MeshType, FM, N>
+  : public ControlNumber<T, MeshType, FM, N, FS>
 {
 public:
 
-  SVControlNumber(void)
-    : ControlNumber<T,MeshType,FM,N>()
+  SVControlNumber(const std::shared_ptr<ActiveTileSet<MeshType>>& active_tiles = nullptr)
+    : ControlNumber<T,MeshType,FM,N,FS>()
   {}
 
   virtual ~SVControlNumber(void)
   {}
 
-  virtual T calculate(const FieldVector<T,MeshType,FM,N>& U,
+  virtual T calculate(const FieldVector<T,MeshType,FM,N,FS>& U,
 		      const double& timestep) const
   {
     throw std::logic_error("This control number calculation is not implemented.");
@@ -4,6 +4,13 @@
  * Class representing a generic multi-dimensional array that can be
  * accessed from both host and device
  *
+ * The device data is a SYCL buffer, unless the build defines
+ * MORGFLOW_USM. It is then a USM allocation, of the kind given by the
+ * "usm allocation" device parameter, and its accessors are plain
+ * pointers, so submitting a command group does no dependency
+ * analysis. USM builds run on an in-order queue, which orders the
+ * commands instead (see GlobalConfig::DeviceParameters).
+ *
  * Copyright (C) Gerald C J Morgan 2020
  ***********************************************************************/
 
@@ -14,6 +21,61 @@
 #include <memory>
 
 #include "sycl.hpp"
+#include "GlobalConfig.hpp"
+
+#ifdef MORGFLOW_USM
+// Accessor to the USM allocation of a DataArray
+template<typename T, sycl::access::mode Mode>
+class DataArrayUSMAccessor
+{
+public:
+
+  using value_type = T;
+  using reference = std::conditional_t<Mode == sycl::access::mode::read,
+				       const T&, T&>;
+
+private:
+
+  T* data_;
+  size_t count_;
+
+public:
+
+  DataArrayUSMAccessor(void)
+    : data_(nullptr), count_(0)
+  {}
+
+  DataArrayUSMAccessor(T* data, const size_t& count)
+    : data_(data), count_(count)
+  {}
+
+  reference operator[](const size_t& i) const
+  {
+    return data_[i];
+  }
+
+  reference operator[](const sycl::id<1>& id) const
+  {
+    return data_[id[0]];
+  }
+
+  reference operator[](const sycl::item<1>& item) const
+  {
+    return data_[item.get_linear_id()];
+  }
+
+  size_t get_count(void) const
+  {
+    return count_;
+  }
+
+  size_t size(void) const
+  {
+    return count_;
+  }
+
+};
+#endif
 
 template<typename T>
 class DataArray
@@ -22,54 +84,116 @@ protected:
 
   std::shared_ptr< sycl::queue > queue_;
   std::shared_ptr< std::vector<T> > host_data_;
+#ifdef MORGFLOW_USM
+  std::shared_ptr<T> device_data_;
+  size_t device_count_ = 0;
+#else
   std::shared_ptr< sycl::buffer<T,1> > device_data_;
+#endif
 
 public:
   
   using AccessMode = sycl::access::mode;
   using AccessTarget = sycl::access::target;
   using AccessPlaceholder = sycl::access::placeholder;
-  
+
+#ifdef MORGFLOW_USM
+  template<AccessMode Mode,
+	   AccessTarget Target = AccessTarget::global_buffer,
+	   AccessPlaceholder IsPlaceholder = AccessPlaceholder::false_t>
+  using Accessor = DataArrayUSMAccessor<T, Mode>;
+
+  template<AccessMode Mode, AccessTarget Target = AccessTarget::global_buffer>
+  Accessor<Mode, Target> get_accessor(sycl::handler& cgh) const
+  {
+    return Accessor<Mode, Target>(device_data_.get(), device_count_);
+  }
+#else
   template<AccessMode Mode,
 	   AccessTarget Target = AccessTarget::global_buffer,
 	   AccessPlaceholder IsPlaceholder = AccessPlaceholder::false_t>
   using Accessor = sycl::accessor<T, 1, Mode, Target, IsPlaceholder>;
 
-  template<AccessMode Mode, AccessTarget Target>
+  template<AccessMode Mode, AccessTarget Target = AccessTarget::global_buffer>
   Accessor<Mode, Target> get_accessor(sycl::handler& cgh) const
   {
     return device_data_->template get_access<Mode, Target>(cgh);
   }
+#endif
 
   Accessor<sycl::access::mode::read>
   get_read_accessor(sycl::handler& cgh) const
   {
-    return device_data_->template get_access<sycl::access::mode::read>(cgh);
+    return get_accessor<sycl::access::mode::read>(cgh);
   }
   
   Accessor<sycl::access::mode::write>
   get_write_accessor(sycl::handler& cgh) const
   {
-    return device_data_->template get_access<sycl::access::mode::write>(cgh);
+    return get_accessor<sycl::access::mode::write>(cgh);
   }
   
   Accessor<sycl::access::mode::discard_write>
   get_discard_write_accessor(sycl::handler& cgh) const
   {
-    return device_data_->template get_access<sycl::access::mode::discard_write>(cgh);
+    return get_accessor<sycl::access::mode::discard_write>(cgh);
   }
   
   Accessor<sycl::access::mode::read_write>
   get_read_write_accessor(sycl::handler& cgh) const
   {
-    return device_data_->template get_access<sycl::access::mode::read_write>(cgh);
+    return get_accessor<sycl::access::mode::read_write>(cgh);
   }
   
   template<AccessMode Mode, AccessTarget Target>
   Accessor<Mode, Target, AccessPlaceholder::true_t> get_placeholder_accessor(void) const
   {
     assert((bool)device_data_);
+#ifdef MORGFLOW_USM
+    return Accessor<Mode, Target, AccessPlaceholder::true_t>(device_data_.get(), device_count_);
+#else
     return Accessor<Mode, Target, AccessPlaceholder::true_t>(*device_data_);
+#endif
+  }
+
+  // Bind a placeholder accessor to a command group
+  template<typename PlaceholderAccessor>
+  static void require(sycl::handler& cgh, PlaceholderAccessor& acc)
+  {
+#ifndef MORGFLOW_USM
+    cgh.require(acc);
+#endif
+  }
+
+private:
+
+  // Allocate count elements of device data, uninitialised
+  void allocate_device_data(const size_t& count)
+  {
+#ifdef MORGFLOW_USM
+    T* data;
+    if (GlobalConfig::instance().get_device_parameters().usm_allocation
+	== sycl::usm::alloc::shared) {
+      data = sycl::malloc_shared<T>(count, *queue_);
+    } else {
+      data = sycl::malloc_device<T>(count, *queue_);
+    }
+    if (data == nullptr) {
+      std::cerr << "Could not allocate " << count * sizeof(T)
+		<< " bytes on the device." << std::endl;
+      throw std::runtime_error("Device allocation failed");
+    }
+
+    // Commands still queued may use the data
+    std::shared_ptr<sycl::queue> queue = queue_;
+    device_data_ = std::shared_ptr<T>(data, [queue](T* p) {
+      queue->wait();
+      sycl::free(p, *queue);
+    });
+    device_count_ = count;
+#else
+    device_data_ = std::make_shared<sycl::buffer<T,1>>(sycl::range<1>(count));
+#endif
   }
 
 public:
@@ -107,11 +231,8 @@ public:
   {
     if (on_device) {
       //assert(value == T());
-      device_data_ = std::make_shared<sycl::buffer<T,1>>(sycl::range<1>(size));
-      queue_->submit([&](sycl::handler& cgh)
-      {
-	cgh.fill(this->get_discard_write_accessor(cgh), value);
-      });
+      allocate_device_data(size);
+      fill(value);
       //      device_data_->set_final_data(host_data_->begin());
     } else {
       host_data_ = std::make_shared<std::vector<T>>(size,value);
@@ -130,13 +251,18 @@ public:
       if (host_data_) {
 	move_to_device();
       } else {
-	device_data_ = std::make_shared<sycl::buffer<T,1>>(sycl::range<1>(da.size()));
+	allocate_device_data(da.size());
       }
+#ifdef MORGFLOW_USM
+      queue_->memcpy(device_data_.get(), da.device_data_.get(),
+		     da.size() * sizeof(T));
+#else
       da.queue_->submit([&](sycl::handler& cgh)
       {
 	cgh.copy(da.get_read_accessor(cgh),
 		 this->get_discard_write_accessor(cgh));
       });
+#endif
     }
   }
 
@@ -144,7 +270,9 @@ public:
 
   ~DataArray(void)
   {
+#ifndef MORGFLOW_USM
     if (device_data_) device_data_->set_final_data();
+#endif
   }
 
   size_t size(void) const
@@ -152,7 +280,11 @@ public:
     if (host_data_) {
       return host_data_->size();
     } else if (device_data_) {
+#ifdef MORGFLOW_USM
+      return device_count_;
+#else
       return device_data_->get_count();
+#endif
     } else {
       throw std::logic_error("Data array has neither host nor device data.");
     }
@@ -189,6 +321,19 @@ public:
       return;
     }
 
+#ifdef MORGFLOW_USM
+    // The host data is kept, as it is with a buffer, but is only
+    // brought up to date by move_to_host()
+    if (not host_data_) {
+      host_data_ = std::make_shared<std::vector<T>>();
+    }
+    allocate_device_data(std::max(host_data_->size(), (size_t) 1));
+    device_count_ = host_data_->size();
+    if (host_data_->size() > 0) {
+      queue_->memcpy(device_data_.get(), host_data_->data(),
+		     host_data_->size() * sizeof(T)).wait();
+    }
+#else
     if (host_data_ && host_data_->size() > 0) {
       // Create the SYCL buffer object
       device_data_ =
@@ -204,25 +349,66 @@ public:
 
       host_data_->pop_back();
     }
+#endif
   }
 
   void move_to_host(void)
   {
+#ifdef MORGFLOW_USM
+    if (not host_data_) {
+      host_data_ = std::make_shared<std::vector<T>>(device_count_);
+    }
+    if (device_count_ > 0) {
+      queue_->memcpy(host_data_->data(), device_data_.get(),
+		     device_count_ * sizeof(T)).wait();
+    }
+#else
     if (not host_data_) {
       host_data_ = std::make_shared<std::vector<T>>(device_data_->get_count());
       device_data_->set_final_data(host_data_->begin());
     }
+#endif
     device_data_.reset();
   }
 
-  bool is_on_device(void) const
+  // Set every element of the device data to value
+  void fill(const T& value)
   {
-    return (bool) device_data_;
+#ifdef MORGFLOW_USM
+    queue_->fill(device_data_.get(), value, device_count_);
+#else
+    queue_->submit([&](sycl::handler& cgh)
+    {
+      cgh.fill(this->get_discard_write_accessor(cgh), value);
+    });
+#endif
   }
 
-  sycl::buffer<T,1>& get_buffer(void)
+  // A copy of the data on the host. Unlike move_to_host(), the device
+  // data is left where it is, so nothing has to be copied back to the
+  // device afterwards.
+  std::vector<T> host_copy(void) const
   {
-    return *device_data_;
+    if (not device_data_) return *host_data_;
+#ifdef MORGFLOW_USM
+    std::vector<T> data(device_count_);
+    if (data.size() > 0) {
+      queue_->memcpy(data.data(), device_data_.get(),
+		     data.size() * sizeof(T)).wait();
+    }
+#else
+    std::vector<T> data(device_data_->get_count());
+    queue_->submit([&](sycl::handler& cgh)
+    {
+      cgh.copy(this->get_read_accessor(cgh), data.data());
+    }).wait();
+#endif
+    return data;
+  }
+
+  bool is_on_device(void) const
+  {
+    return (bool) device_data_;
   }
   
 };
@@ -22,7 +22,8 @@ public:
 private:
 
   struct LocatedTimeSeries {
-    TimeSeriesAccessor<T> ts;
+    // Time series are read and stored in single precision
+    TimeSeriesAccessor<float> ts;
     CoordType loc;
 
     LocatedTimeSeries(const std::shared_ptr<sycl::queue>& queue,
@@ -70,9 +71,9 @@ public:
     T weighted_value = 0.0;
     double total_weight = 0.0;
     for (auto&& lts : lts_) {
-      const TimeSeriesAccessor<T>& tsa = lts.ts;
+      const TimeSeriesAccessor<float>& tsa = lts.ts;
       const CoordType& loc = lts.loc;
-      T value = tsa(time, nodata);
+      T value = tsa(time, (float) nodata);
 
       double xdist = coord[0] - loc[0];
       double ydist = coord[1] - loc[1];
@@ -21,7 +21,8 @@ public:
   
 private:
 
-  TimeSeriesAccessor<T> ts_;
+  // Time series are read and stored in single precision
+  TimeSeriesAccessor<float> ts_;
 
 public:
 
@@ -47,7 +48,7 @@ public:
 	       const CoordType& coord,
 	       const T& nodata) const
   {
-    return ts_(time, nodata);
+    return ts_(time, (float) nodata);
     (void) coord;
   }
   
@@ -56,7 +57,7 @@ public:
 	       const std::array<double,2>& box_size,
 	       const T& nodata) const
   {
-    return ts_(time, nodata);
+    return ts_(time, (float) nodata);
   }
   
 };
@@ -9,7 +9,17 @@
 
 #include "Field.hpp"
 
-template<typename T, typename MeshDefn, FieldMapping FM, size_t N>
+// How the components of a field vector are laid out in memory.
+//   Separate: each component is an independent Field.
+//   Interleaved: all components share one allocation, interleaved in
+//                fixed-width blocks of objects.
+enum class FieldStorage {
+  Separate,
+  Interleaved
+};
+
+template<typename T, typename MeshDefn, FieldMapping FM, size_t N,
+	 FieldStorage FS = FieldStorage::Separate>
 class FieldVector : public std::vector< Field<T, MeshDefn, FM> >
 {
 public:
@@ -18,6 +28,7 @@ public:
   using MeshType = MeshDefn;
   using FieldType = Field<T,MeshDefn,FM>;
   static const FieldMapping FieldMappingType = FieldType::FieldMappingType;
+  static const FieldStorage StorageType = FieldStorage::Separate;
   
 private:
 
@@ -87,6 +98,21 @@ public:
     return this->at(0).mesh_definition();
   }
 
+  const std::shared_ptr<sycl::queue>& queue_ptr(void) const
+  {
+    return this->at(0).queue_ptr();
+  }
+
+  sycl::queue& queue(void) const
+  {
+    return this->at(0).queue();
+  }
+
+  const FieldType& component(const size_t& i) const
+  {
+    return this->at(i);
+  }
+
   using AccessMode = sycl::access::mode;
   using AccessTarget = sycl::access::target;
   using AccessPlaceholder = sycl::access::placeholder;
@@ -157,20 +183,27 @@ public:
   
 };
 
+#include "FieldVectors/InterleavedFieldVector.hpp"
+
 template<typename T,
 	 typename MeshDefn,
-	 size_t N>
-using CellFieldVector = FieldVector<T, MeshDefn, FieldMapping::Cell, N>;
+	 size_t N,
+	 FieldStorage FS = FieldStorage::Separate>
+using CellFieldVector = FieldVector<T, MeshDefn, FieldMapping::Cell, N, FS>;
 
 template<typename T,
 	 typename MeshDefn,
-	 size_t N>
-using FaceFieldVector = FieldVector<T, MeshDefn, FieldMapping::Face, N>;
+	 size_t N,
+	 FieldStorage FS = FieldStorage::Separate>
+using FaceFieldVector = FieldVector<T, MeshDefn, FieldMapping::Face, N, FS>;
 
 template<typename T,
 	 typename MeshDefn,
-	 size_t N>
-using VertexFieldVector = FieldVector<T, MeshDefn, FieldMapping::Vertex, N>;
+	 size_t N,
+	 FieldStorage FS = FieldStorage::Separate>
+using VertexFieldVector = FieldVector<T, MeshDefn, FieldMapping::Vertex, N, FS>;
+
+#include "FieldVectors/FoldableFieldVector.hpp"
 
 
 #endif
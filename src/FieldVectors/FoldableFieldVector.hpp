@@ -0,0 +1,197 @@
+/***********************************************************************
+ * FieldVectors/FoldableFieldVector.hpp
+ *
+ * Field vector that can be folded into one value per component when
+ * each component is the same throughout the mesh, as Manning's n
+ * usually is and as the boundary inflows are where there are no
+ * boundaries of their kind. A folded vector holds no fields; kernels
+ * read its values, passed as kernel arguments, instead of N arrays.
+ * The fields are allocated again, holding the folded values, when
+ * they are next asked for.
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef FieldVectors_FoldableFieldVector_hpp
+#define FieldVectors_FoldableFieldVector_hpp
+
+#include <algorithm>
+#include <utility>
+
+// Reads one component of a foldable field vector in a kernel. Indexed
+// by object id, exactly like the accessor to a single Field. Every
+// work-item takes the same branch.
+template<typename T, typename DataAccessor>
+class FoldableComponentReader
+{
+private:
+
+  DataAccessor acc_;
+  T value_;
+  bool folded_;
+
+public:
+
+  FoldableComponentReader(const DataAccessor& acc,
+			  const T& value,
+			  bool folded)
+    : acc_(acc),
+      value_(value),
+      folded_(folded)
+  {}
+
+  T operator[](const size_t& i) const
+  {
+    return (folded_ ? value_ : acc_[i]);
+  }
+
+  T operator[](const sycl::id<1>& id) const
+  {
+    return (*this)[id[0]];
+  }
+
+};
+
+template<typename T, typename MeshDefn, FieldMapping FM, size_t N>
+class FoldableFieldVector
+{
+public:
+
+  using ValueType = T;
+  using MeshType = MeshDefn;
+  using FieldVectorType = FieldVector<T,MeshDefn,FM,N>;
+  using FieldAccessorType =
+    typename FieldVectorType::template FieldAccessorType<sycl::access::mode::read>;
+  using ComponentReader = FoldableComponentReader<T,FieldAccessorType>;
+
+  // Indexing gives the reader for a single component, so r[j][i]
+  // reads object i of component j as for a std::array of accessors
+  using Reader = std::array<ComponentReader,N>;
+
+private:
+
+  std::shared_ptr<sycl::queue> queue_;
+  std::array<std::string,N> names_;
+  std::shared_ptr<MeshDefn> meshdefn_p_;
+
+  // Null while folded
+  std::shared_ptr<FieldVectorType> fields_;
+  std::array<T,N> values_;
+
+  // Bound in place of the fields while folded, as the kernels need an
+  // accessor of the right type either way
+  DataArray<T> placeholder_;
+
+  ComponentReader get_component_reader(sycl::handler& cgh,
+				       const size_t& i) const
+  {
+    if (fields_) {
+      return ComponentReader(fields_->at(i).get_read_accessor(cgh),
+			     values_[i], false);
+    } else {
+      return ComponentReader(placeholder_.get_read_accessor(cgh),
+			     values_[i], true);
+    }
+  }
+
+  template<size_t... I>
+  Reader get_reader(sycl::handler& cgh, std::index_sequence<I...>) const
+  {
+    return {{ get_component_reader(cgh, I)... }};
+  }
+
+public:
+
+  // Create the vector folded, with every component set to init_value
+  FoldableFieldVector(const std::shared_ptr<sycl::queue>& queue,
+		      const std::array<std::string,N>& names,
+		      const std::shared_ptr<MeshDefn>& meshdefn_p,
+		      const T& init_value = T())
+    : queue_(queue),
+      names_(names),
+      meshdefn_p_(meshdefn_p),
+      fields_(),
+      values_(),
+      placeholder_(queue, 1, true, init_value)
+  {
+    values_.fill(init_value);
+  }
+
+  bool is_folded(void) const
+  {
+    return not fields_;
+  }
+
+  // The value of each component. Only meaningful while folded.
+  const std::array<T,N>& values(void) const
+  {
+    return values_;
+  }
+
+  const std::shared_ptr<MeshDefn>& mesh_definition(void) const
+  {
+    return meshdefn_p_;
+  }
+
+  // The fields, allocated from the folded values if necessary. The
+  // vector stays unfolded until fold() is called again.
+  FieldVectorType& fields(void)
+  {
+    if (not fields_) {
+      fields_ = std::make_shared<FieldVectorType>(queue_, names_,
+						  meshdefn_p_, true);
+      for (size_t i = 0; i < N; ++i) {
+	fields_->at(i).fill(values_[i]);
+      }
+    }
+    return *fields_;
+  }
+
+  // A copy of the fields that leaves the vector as it is
+  FieldVectorType expanded(void) const
+  {
+    if (fields_) return *fields_;
+    FoldableFieldVector<T,MeshDefn,FM,N> copy(*this);
+    return copy.fields();
+  }
+
+  // Fold the vector if each of its components is uniform, freeing the
+  // fields. Returns whether the vector is folded.
+  bool fold(void)
+  {
+    if (not fields_) return true;
+
+    std::array<T,N> values;
+    for (size_t i = 0; i < N; ++i) {
+      std::vector<T> data = fields_->at(i).host_copy();
+      // NaNs compare unequal, so a field containing them is not folded
+      bool uniform =
+	std::all_of(data.begin(), data.end(),
+		    [&](const T& x) { return (x == data.front()); });
+      if (data.empty() or not uniform) return false;
+      values[i] = data.front();
+    }
+
+    values_ = values;
+    fields_.reset();
+    std::cout << "Folded uniform fields";
+    for (size_t i = 0; i < N; ++i) {
+      std::cout << (i > 0 ? ", \"" : " \"") << names_[i] << "\"";
+    }
+    std::cout << " into kernel arguments." << std::endl;
+    return true;
+  }
+
+  Reader get_reader(sycl::handler& cgh) const
+  {
+    return get_reader(cgh, std::make_index_sequence<N>());
+  }
+
+};
+
+template<typename T,
+	 typename MeshDefn,
+	 size_t N>
+using CellFoldableFieldVector = FoldableFieldVector<T, MeshDefn, FieldMapping::Cell, N>;
+
+#endif
@@ -0,0 +1,357 @@
+/***********************************************************************
+ * FieldVectors/InterleavedFieldVector.hpp
+ *
+ * Field vector storing all of its components in a single allocation
+ * ("array of structures of arrays"). Objects are grouped into blocks
+ * of BlockWidth; within a block each component is stored
+ * contiguously, so object i of component j lives at
+ *
+ *   (i / W) * N * W  +  j * W  +  i % W
+ *
+ * A work-group reading all N components of neighbouring objects
+ * therefore touches a handful of adjacent cache lines rather than N
+ * unrelated streams.
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef FieldVectors_InterleavedFieldVector_hpp
+#define FieldVectors_InterleavedFieldVector_hpp
+
+// Accessor to one component of an interleaved field vector. Indexed
+// by object id, exactly like the accessor to a single Field.
+template<typename DataAccessor,
+	 size_t Stride,
+	 size_t W>
+class InterleavedComponentAccessor
+{
+private:
+
+  DataAccessor acc_;
+  size_t offset_;
+
+public:
+
+  InterleavedComponentAccessor(const DataAccessor& acc,
+			       const size_t& component)
+    : acc_(acc),
+      offset_(component * W)
+  {}
+
+  decltype(auto) operator[](const size_t& i) const
+  {
+    return acc_[(i / W) * (Stride * W) + offset_ + (i % W)];
+  }
+
+  decltype(auto) operator[](const sycl::id<1>& id) const
+  {
+    return (*this)[id[0]];
+  }
+
+  decltype(auto) operator[](const sycl::item<1>& item) const
+  {
+    return (*this)[item.get_linear_id()];
+  }
+
+};
+
+// Accessor to Count components (starting at first_) of an interleaved
+// field vector holding Stride components. Indexing gives the accessor
+// for a single component, so acc[j][i] reads object i of component j
+// as it does for a std::array of field accessors.
+template<typename T,
+	 size_t Stride,
+	 size_t Count,
+	 size_t W,
+	 sycl::access::mode Mode,
+	 sycl::access::target Target,
+	 sycl::access::placeholder IsPlaceholder>
+class InterleavedFieldVectorAccessor
+{
+public:
+
+  using DataAccessor = typename DataArray<T>::
+    template Accessor<Mode, Target, IsPlaceholder>;
+  using ComponentAccessor = InterleavedComponentAccessor<DataAccessor,
+							 Stride, W>;
+
+private:
+
+  DataAccessor acc_;
+  size_t first_;
+
+public:
+
+  InterleavedFieldVectorAccessor(void)
+    : acc_(), first_(0)
+  {}
+
+  InterleavedFieldVectorAccessor(const DataAccessor& acc,
+				 const size_t& first = 0)
+    : acc_(acc), first_(first)
+  {}
+
+  ComponentAccessor operator[](const size_t& j) const
+  {
+    return ComponentAccessor(acc_, first_ + j);
+  }
+
+  static constexpr size_t size(void)
+  {
+    return Count;
+  }
+
+};
+
+template<typename T, typename MeshDefn, FieldMapping FM, size_t N>
+class FieldVector<T, MeshDefn, FM, N, FieldStorage::Interleaved>
+{
+public:
+
+  using ValueType = T;
+  using MeshType = MeshDefn;
+  using FieldType = Field<T,MeshDefn,FM>;
+  static const FieldMapping FieldMappingType = FM;
+  static const FieldStorage StorageType = FieldStorage::Interleaved;
+
+  // Number of objects of one component stored contiguously.
+  static const size_t BlockWidth = 16;
+
+private:
+
+  std::array<std::string,N> names_;
+  std::shared_ptr<MeshDefn> meshdefn_p_;
+  size_t object_count_;
+  std::shared_ptr<DataArray<T>> data_;
+
+  static size_t storage_size(const size_t& object_count)
+  {
+    size_t block_count = (object_count + BlockWidth - 1) / BlockWidth;
+    return block_count * N * BlockWidth;
+  }
+
+  static size_t storage_index(const size_t& i, const size_t& j)
+  {
+    return (i / BlockWidth) * N * BlockWidth
+      + j * BlockWidth + (i % BlockWidth);
+  }
+
+public:
+
+  FieldVector(const std::shared_ptr<sycl::queue>& queue,
+	      const std::array<std::string,N>& names,
+	      const std::shared_ptr<MeshDefn>& meshdefn_p,
+	      bool on_device,
+	      const T& init_value = T())
+    : names_(names),
+      meshdefn_p_(meshdefn_p),
+      object_count_(meshdefn_p->template object_count<FM>()),
+      data_(std::make_shared<DataArray<T>>(queue,
+					   storage_size(object_count_),
+					   on_device, init_value))
+  {
+    std::cout << "Created interleaved field vector on "
+	      << (on_device ? "device" : "host") << " \"";
+    for (size_t j = 0; j < N; ++j) {
+      std::cout << (j > 0 ? ", " : "") << names_[j];
+    }
+    std::cout << "\"" << std::endl;
+  }
+
+  // Pack a vector of separately-stored fields
+  FieldVector(const FieldVector<T,MeshDefn,FM,N,FieldStorage::Separate>& fv)
+    : names_(),
+      meshdefn_p_(fv.mesh_definition()),
+      object_count_(meshdefn_p_->template object_count<FM>()),
+      data_(std::make_shared<DataArray<T>>(fv.queue_ptr(),
+					   storage_size(object_count_),
+					   true, T()))
+  {
+    for (size_t j = 0; j < N; ++j) {
+      names_[j] = fv.at(j).name();
+      set_component(j, fv.at(j));
+    }
+  }
+
+  FieldVector(const std::string& prefix,
+	      const FieldVector<T,MeshDefn,FM,N,FieldStorage::Interleaved>& fv,
+	      const std::string& suffix)
+    : names_(),
+      meshdefn_p_(fv.meshdefn_p_),
+      object_count_(fv.object_count_),
+      data_(std::make_shared<DataArray<T>>(*fv.data_))
+  {
+    for (size_t j = 0; j < N; ++j) {
+      names_[j] = prefix + fv.names_[j] + suffix;
+    }
+  }
+
+  FieldVector(const FieldVector<T,MeshDefn,FM,N,FieldStorage::Interleaved>& fv)
+    : names_(fv.names_),
+      meshdefn_p_(fv.meshdefn_p_),
+      object_count_(fv.object_count_),
+      data_(std::make_shared<DataArray<T>>(*fv.data_))
+  {}
+
+  FieldVector(FieldVector<T,MeshDefn,FM,N,FieldStorage::Interleaved>&& fv) = default;
+
+  FieldVector<T,MeshDefn,FM,N,FieldStorage::Interleaved>&
+  operator=(FieldVector<T,MeshDefn,FM,N,FieldStorage::Interleaved>&& fv) = default;
+
+  constexpr size_t size(void) const
+  {
+    return N;
+  }
+
+  const std::string& name(const size_t& j) const
+  {
+    return names_.at(j);
+  }
+
+  void move_to_device(void)
+  {
+    data_->move_to_device();
+  }
+
+  void move_to_host(void)
+  {
+    data_->move_to_host();
+  }
+
+  bool is_on_device(void) const
+  {
+    return data_->is_on_device();
+  }
+
+  std::shared_ptr<MeshType> mesh_definition(void) const
+  {
+    return meshdefn_p_;
+  }
+
+  const std::shared_ptr<sycl::queue>& queue_ptr(void) const
+  {
+    return data_->queue_ptr();
+  }
+
+  sycl::queue& queue(void) const
+  {
+    return data_->queue();
+  }
+
+  using AccessMode = sycl::access::mode;
+  using AccessTarget = sycl::access::target;
+  using AccessPlaceholder = sycl::access::placeholder;
+
+  template<AccessMode Mode,
+	   AccessTarget Target = AccessTarget::global_buffer,
+	   AccessPlaceholder IsPlaceholder = AccessPlaceholder::false_t>
+  using Accessor = InterleavedFieldVectorAccessor<T, N, N, BlockWidth,
+						  Mode, Target,
+						  IsPlaceholder>;
+
+  template<AccessMode Mode,
+	   AccessTarget Target = AccessTarget::global_buffer>
+  Accessor<Mode, Target> get_accessor(sycl::handler& cgh) const
+  {
+    return Accessor<Mode, Target>
+      (data_->template get_accessor<Mode, Target>(cgh));
+  }
+
+  Accessor<sycl::access::mode::read>
+  get_read_accessor(sycl::handler& cgh) const
+  {
+    return get_accessor<sycl::access::mode::read>(cgh);
+  }
+
+  Accessor<sycl::access::mode::write>
+  get_write_accessor(sycl::handler& cgh) const
+  {
+    return get_accessor<sycl::access::mode::write>(cgh);
+  }
+
+  Accessor<sycl::access::mode::read_write>
+  get_read_write_accessor(sycl::handler& cgh) const
+  {
+    return get_accessor<sycl::access::mode::read_write>(cgh);
+  }
+
+  template<size_t Count,
+	   AccessMode Mode,
+	   AccessTarget Target = AccessTarget::global_buffer,
+	   AccessPlaceholder IsPlaceholder = AccessPlaceholder::false_t>
+  using SliceAccessor = InterleavedFieldVectorAccessor<T, N, Count,
+						       BlockWidth,
+						       Mode, Target,
+						       IsPlaceholder>;
+
+  template<size_t From, size_t Count,
+	   AccessMode Mode,
+	   AccessTarget Target = AccessTarget::global_buffer>
+  SliceAccessor<Count, Mode, Target> get_slice_accessor(sycl::handler& cgh) const
+  {
+    static_assert(From + Count <= N, "Slice extends beyond field vector");
+    return SliceAccessor<Count, Mode, Target>
+      (data_->template get_accessor<Mode, Target>(cgh), From);
+  }
+
+  sycl::range<1> get_range(void) const
+  {
+    return sycl::range<1>(object_count_);
+  }
+
+  // Unpack component j into a separately-stored field
+  FieldType component(const size_t& j) const
+  {
+    if (not data_->is_on_device()) {
+      FieldType f(data_->queue_ptr(), names_.at(j), meshdefn_p_, false);
+      const std::vector<T>& src = data_->host_vector();
+      std::vector<T>& dst = f.host_vector();
+      for (size_t i = 0; i < object_count_; ++i) {
+	dst[i] = src[storage_index(i, j)];
+      }
+      return f;
+    }
+
+    FieldType f(data_->queue_ptr(), names_.at(j), meshdefn_p_, true);
+    data_->queue().submit([&](sycl::handler& cgh)
+    {
+      auto src = this->get_read_accessor(cgh)[j];
+      auto dst = f.get_discard_write_accessor(cgh);
+      cgh.parallel_for(this->get_range(), [=](sycl::id<1> id) {
+	dst[id] = src[id];
+      });
+    });
+    return f;
+  }
+
+  // Copy a separately-stored field into component j
+  void set_component(const size_t& j, const FieldType& f)
+  {
+    if (f.size() != object_count_) {
+      throw std::logic_error("Field size must match field vector size "
+			     "when setting a component");
+    }
+    if (not data_->is_on_device()) {
+      throw std::logic_error("Interleaved field vector must be on the "
+			     "device when setting a component");
+    }
+    if (not f.is_on_device()) {
+      FieldType fd(f);
+      fd.move_to_device();
+      set_component(j, fd);
+      return;
+    }
+
+    data_->queue().submit([&](sycl::handler& cgh)
+    {
+      auto src = f.get_read_accessor(cgh);
+      auto dst = this->get_write_accessor(cgh)[j];
+      cgh.parallel_for(this->get_range(), [=](sycl::id<1> id) {
+	dst[id] = src[id];
+      });
+    });
+  }
+
+};
+
+#endif
@@ -14,7 +14,10 @@ template<typename T,
 	 FieldMapping FromFM,
 	 FieldMapping ToFM,
 	 size_t FromN,
-	 size_t ToN>
+	 size_t ToN,
+	 FieldStorage FS = FieldStorage::Separate,
+	 typename CT = T,
+	 typename BT = T>
 class FluxFunction
 {
 public:
@@ -25,12 +28,18 @@ public:
   virtual ~FluxFunction(void)
   {}
 
-  virtual void calculate(const FieldVector<T,MeshType,FromFM,FromN>& U,
-			 const FieldVector<T,MeshType,FromFM,3>& zb,
-			 const FieldVector<T,MeshType,FromFM,4>& n,
-			 const FieldVector<T,MeshType,FromFM,FromN>& dUdx,
-			 const FieldVector<T,MeshType,FromFM,FromN>& dUdy,
-			 FieldVector<T,MeshType,ToFM,ToN>& F) const = 0;
+  // Calculate the bed at the faces (zf) from the bed levels (zb) and
+  // slopes (dzb) of the cells. It depends only on the bed, so is
+  // calculated once and passed to calculate().
+  virtual void calculate_face_bed(const FieldVector<BT,MeshType,FromFM,1>& zb,
+				  const FieldVector<CT,MeshType,FromFM,2>& dzb,
+				  FieldVector<BT,MeshType,ToFM,3>& zf) const = 0;
+
+  virtual void calculate(const FieldVector<T,MeshType,FromFM,FromN,FS>& U,
+			 const FieldVector<BT,MeshType,ToFM,3>& zf,
+			 const FieldVector<T,MeshType,FromFM,FromN,FS>& dUdx,
+			 const FieldVector<T,MeshType,FromFM,FromN,FS>& dUdy,
+			 FieldVector<T,MeshType,ToFM,ToN,FS>& F) const = 0;
 
 };
 
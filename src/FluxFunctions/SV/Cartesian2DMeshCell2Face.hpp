@@ -7,13 +7,16 @@
 #ifndef FluxFunctions_SV_Cartesian2DMeshCell2Face_hpp
 #define FluxFunctions_SV_Cartesian2DMeshCell2Face_hpp
 
+#include "Kernels/Cartesian2DMeshFaceBedKernel.hpp"
 #include "Kernels/Cartesian2DMeshCell2FaceKernel.hpp"
+#include "Kernels/Cartesian2DMeshCell2FaceTiledKernel.hpp"
+#include "Kernels/Cartesian2DMeshCell2FaceRowKernel.hpp"
 
-template<typename T>
+template<typename T, FieldStorage FS, typename CT, typename BT>
 class SVFluxFunction<T, Cartesian2DMesh,
-		     FieldMapping::Cell, FieldMapping::Face, 3, 4>
+		     FieldMapping::Cell, FieldMapping::Face, 3, 3, FS, CT, BT>
   : public FluxFunction<T, Cartesian2DMesh,
-			FieldMapping::Cell, FieldMapping::Face, 3, 4>
+			FieldMapping::Cell, FieldMapping::Face, 3, 3, FS, CT, BT>
 {
 public:
 
@@ -21,29 +24,149 @@ public:
   static const FieldMapping FromFM = FieldMapping::Cell;
   static const FieldMapping ToFM = FieldMapping::Face;
   static const size_t FromN = 3;
-  static const size_t ToN = 4;
+  static const size_t ToN = 3;
+
+private:
+
+  // Work-group tile size (x, y) for the tiled kernels; zero to use the
+  // untiled kernels.
+  std::array<size_t,2> tile_size_;
+
+  // Tiles to calculate; null to calculate the whole mesh.
+  std::shared_ptr<ActiveTileSet<MeshType>> active_tiles_;
+
+  // Use FastMath rather than ExactMath (see MathProfile.hpp)
+  bool fast_math_;
+
+  // Use the row kernels, which calculate runs of faces in SIMD lanes,
+  // in place of the untiled kernels (for CPU devices)
+  bool row_kernel_;
   
 public:
   
-  SVFluxFunction(void)
-    : FluxFunction<T, MeshType, FromFM, ToFM, FromN, ToN>()
+  SVFluxFunction(const std::array<size_t,2>& tile_size = { 0, 0 },
+		 const std::shared_ptr<ActiveTileSet<MeshType>>& active_tiles = nullptr,
+		 bool fast_math = false,
+		 bool row_kernel = false)
+    : FluxFunction<T, MeshType, FromFM, ToFM, FromN, ToN, FS, CT, BT>(),
+      tile_size_(tile_size),
+      active_tiles_(active_tiles),
+      fast_math_(fast_math),
+      row_kernel_(row_kernel)
   {}
 
   virtual ~SVFluxFunction(void)
   {}
 
-  virtual void calculate(const FieldVector<T,MeshType,FromFM,FromN>& U,
-			 const FieldVector<T,MeshType,FromFM,3>& zb,
-			 const FieldVector<T,MeshType,FromFM,4>& n,
-			 const FieldVector<T,MeshType,FromFM,FromN>& dUdx,
-			 const FieldVector<T,MeshType,FromFM,FromN>& dUdy,
-			 FieldVector<T,MeshType,ToFM,ToN>& F) const
+  virtual void calculate_face_bed(const FieldVector<BT,MeshType,FromFM,1>& zb,
+				  const FieldVector<CT,MeshType,FromFM,2>& dzb,
+				  FieldVector<BT,MeshType,ToFM,3>& zf) const
+  {
+    zb.queue().submit([&] (sycl::handler& cgh) {
+      using Kernel = SVCartesian2DMeshFaceBedKernel<T,0,CT,BT>;
+      auto kernel = Kernel(cgh, zb, dzb, zf);
+
+      cgh.parallel_for(Kernel::get_range(*(zb.mesh_definition())), kernel);
+    });
+
+    zb.queue().submit([&] (sycl::handler& cgh) {
+      using Kernel = SVCartesian2DMeshFaceBedKernel<T,1,CT,BT>;
+      auto kernel = Kernel(cgh, zb, dzb, zf);
+
+      cgh.parallel_for(Kernel::get_range(*(zb.mesh_definition())), kernel);
+    });
+  }
+
+  virtual void calculate(const FieldVector<T,MeshType,FromFM,FromN,FS>& U,
+			 const FieldVector<BT,MeshType,ToFM,3>& zf,
+			 const FieldVector<T,MeshType,FromFM,FromN,FS>& dUdx,
+			 const FieldVector<T,MeshType,FromFM,FromN,FS>& dUdy,
+			 FieldVector<T,MeshType,ToFM,ToN,FS>& F) const
+  {
+    if (fast_math_) {
+      calculate_with<FastMath>(U, zf, dUdx, dUdy, F);
+    } else {
+      calculate_with<ExactMath>(U, zf, dUdx, dUdy, F);
+    }
+  }
+
+private:
+
+  // Launch the kernels with math profile M
+  template<typename M>
+  void calculate_with(const FieldVector<T,MeshType,FromFM,FromN,FS>& U,
+		      const FieldVector<BT,MeshType,ToFM,3>& zf,
+		      const FieldVector<T,MeshType,FromFM,FromN,FS>& dUdx,
+		      const FieldVector<T,MeshType,FromFM,FromN,FS>& dUdy,
+		      FieldVector<T,MeshType,ToFM,ToN,FS>& F) const
   {
-    // Update dU/dx and dU/dy
-    U.at(0).queue().submit([&] (sycl::handler& cgh) {
-      auto kernel = SVCartesian2DMeshCell2FaceFluxFunctionKernel<T>(cgh, U, zb, n, dUdx, dUdy, F);
+    // The x- and y-faces are calculated by separate kernels, each
+    // launched over its own block of faces
+    if (active_tiles_) {
+      U.queue().submit([&] (sycl::handler& cgh) {
+	using Kernel = SVCartesian2DMeshCell2FaceFluxFunctionKernel<T,0,FS,BT,M>;
+	auto kernel = Kernel(cgh, U, zf, dUdx, F);
+
+	active_tiles_->template parallel_for_faces<0>(cgh, kernel);
+      });
+
+      U.queue().submit([&] (sycl::handler& cgh) {
+	using Kernel = SVCartesian2DMeshCell2FaceFluxFunctionKernel<T,1,FS,BT,M>;
+	auto kernel = Kernel(cgh, U, zf, dUdy, F);
+
+	active_tiles_->template parallel_for_faces<1>(cgh, kernel);
+      });
+      return;
+    }
+
+    if (tile_size_[0] > 0 and tile_size_[1] > 0) {
+      U.queue().submit([&] (sycl::handler& cgh) {
+	using Kernel = SVCartesian2DMeshCell2FaceTiledFluxFunctionKernel<T,0,FS,BT,M>;
+	auto kernel = Kernel(cgh, U, zf, dUdx, F, tile_size_);
+
+	cgh.parallel_for(Kernel::get_range(*(U.mesh_definition()), tile_size_),
+			 kernel);
+      });
+
+      U.queue().submit([&] (sycl::handler& cgh) {
+	using Kernel = SVCartesian2DMeshCell2FaceTiledFluxFunctionKernel<T,1,FS,BT,M>;
+	auto kernel = Kernel(cgh, U, zf, dUdy, F, tile_size_);
+
+	cgh.parallel_for(Kernel::get_range(*(U.mesh_definition()), tile_size_),
+			 kernel);
+      });
+      return;
+    }
+
+    if (row_kernel_) {
+      U.queue().submit([&] (sycl::handler& cgh) {
+	using Kernel = SVCartesian2DMeshCell2FaceRowFluxFunctionKernel<T,0,FS,BT,M>;
+	auto kernel = Kernel(cgh, U, zf, dUdx, F);
+
+	cgh.parallel_for(Kernel::get_range(*(U.mesh_definition())), kernel);
+      });
+
+      U.queue().submit([&] (sycl::handler& cgh) {
+	using Kernel = SVCartesian2DMeshCell2FaceRowFluxFunctionKernel<T,1,FS,BT,M>;
+	auto kernel = Kernel(cgh, U, zf, dUdy, F);
+
+	cgh.parallel_for(Kernel::get_range(*(U.mesh_definition())), kernel);
+      });
+      return;
+    }
+    
+    U.queue().submit([&] (sycl::handler& cgh) {
+      using Kernel = SVCartesian2DMeshCell2FaceFluxFunctionKernel<T,0,FS,BT,M>;
+      auto kernel = Kernel(cgh, U, zf, dUdx, F);
+      
+      cgh.parallel_for(Kernel::get_range(*(U.mesh_definition())), kernel);
+    });
+    
+    U.queue().submit([&] (sycl::handler& cgh) {
+      using Kernel = SVCartesian2DMeshCell2FaceFluxFunctionKernel<T,1,FS,BT,M>;
+      auto kernel = Kernel(cgh, U, zf, dUdy, F);
       
-      cgh.parallel_for(F.get_range(), kernel);
+      cgh.parallel_for(Kernel::get_range(*(U.mesh_definition())), kernel);
     });
   }
 };
@@ -0,0 +1,144 @@
+/***********************************************************************
+ * FluxFunctions/SV/Kernels/Cartesian2DMeshCell2FaceRowKernel.hpp
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef FluxFunctions_SV_Kernels_Cartesian2DMeshCell2FaceRowKernel_hpp
+#define FluxFunctions_SV_Kernels_Cartesian2DMeshCell2FaceRowKernel_hpp
+
+#include "Cartesian2DMeshCell2FaceKernel.hpp"
+
+// Version of the flux kernel for CPU devices. Each item calculates a
+// run of Lanes consecutive faces along a row, so that the compiler can
+// calculate them together in SIMD lanes. The branches of the face flux
+// (submerged, dry or partially submerged) and of the walls would stop
+// that, so the run is calculated by SVFaceFlux::calculate_blended()
+// with the walls also chosen by selects. A short run at the end of a
+// row is calculated one face at a time.
+//
+// The kernel is launched over a 2D range whose dimension 0 is the row
+// (y-index) of the faces and dimension 1 the run along it.
+template<typename T,
+	 int D,
+	 FieldStorage FS = FieldStorage::Separate,
+	 typename BT = T,
+	 typename M = ExactMath,
+	 size_t Lanes = 64 / sizeof(T)>
+class SVCartesian2DMeshCell2FaceRowFluxFunctionKernel
+  : public SVCartesian2DMeshCell2FaceFluxFunctionKernel<T,D,FS,BT,M>
+{
+protected:
+
+  using Base = SVCartesian2DMeshCell2FaceFluxFunctionKernel<T,D,FS,BT,M>;
+  using typename Base::ValueType;
+  using typename Base::MeshType;
+  using typename Base::SideType;
+  using typename Base::FaceFluxType;
+  using typename Base::FaceBedType;
+
+  template<size_t N>
+  using FaceBedVector = typename Base::template FaceBedVector<N>;
+
+  template<size_t N>
+  using CellStateVector = typename Base::template CellStateVector<N>;
+
+  template<size_t N>
+  using FaceStateVector = typename Base::template FaceStateVector<N>;
+
+  // Calculate the fluxes across the K faces from (x, y) index (i, j)
+  template<size_t K>
+  void calculate_run(const size_t& i, const size_t& j) const
+  {
+    size_t row_faces = this->nx_ + (D == 0 ? 1 : 0);
+
+    std::array<size_t,K> fid;
+    std::array<BT,K> z_m, z_p;
+    std::array<bool,K> no_flow;
+    std::array<SideType,K> L, R;
+
+    for (size_t k = 0; k < K; ++k) {
+      size_t local_id = j * row_faces + i + k;
+
+      // Get the IDs of the adjacent cells as in the base kernel
+      size_t lhs_id, rhs_id;
+      if (D == 0) {
+	fid[k] = local_id;
+	rhs_id = local_id - j;
+	lhs_id = rhs_id - 1;
+      } else {
+	fid[k] = this->x_face_count_ + local_id;
+	rhs_id = local_id;
+	lhs_id = local_id - this->nx_;
+      }
+
+      // The side of a wall that is fake reads the real cell instead,
+      // and a face with neither side real reads cell 0, which always
+      // exists, so that every lane reads from the same place
+      z_m[k] = this->zf_ro_[0][fid[k]];
+      z_p[k] = this->zf_ro_[1][fid[k]];
+      bool fake_m = (z_m[k] != z_m[k]);
+      bool fake_p = (z_p[k] != z_p[k]);
+      no_flow[k] = (fake_m and fake_p);
+      size_t l_id = (no_flow[k] ? 0 : (fake_m ? rhs_id : lhs_id));
+      size_t r_id = (no_flow[k] ? 0 : (fake_p ? lhs_id : rhs_id));
+
+      SideType l = this->get_side(l_id);
+      SideType r = this->get_side(r_id);
+
+      // Replace a fake side with a wall
+      BT z_w = this->zf_ro_[2][fid[k]];
+      L[k] = (fake_m ? FaceFluxType::wall(r) : l);
+      R[k] = (fake_p ? FaceFluxType::wall(l) : r);
+      z_m[k] = (fake_m ? FaceBedType::wall_level(z_w, r.h) : z_m[k]);
+      z_p[k] = (fake_p ? FaceBedType::wall_level(z_w, l.h) : z_p[k]);
+    }
+
+    std::array<std::array<ValueType,3>,K> F;
+    for (size_t k = 0; k < K; ++k) {
+      FaceFluxType::template calculate_blended<D>(z_m[k], z_p[k],
+						  L[k], R[k],
+						  this->ds_, F[k]);
+    }
+
+    for (size_t k = 0; k < K; ++k) {
+      this->F_wo_[0][fid[k]] = (no_flow[k] ? (ValueType) 0.0f : F[k][0]);
+      this->F_wo_[1][fid[k]] = (no_flow[k] ? (ValueType) 0.0f : F[k][1]);
+      this->F_wo_[2][fid[k]] = (no_flow[k] ? (ValueType) 0.0f : F[k][2]);
+    }
+  }
+
+public:
+
+  // dU is the slope of the solution in the D-direction
+  SVCartesian2DMeshCell2FaceRowFluxFunctionKernel(sycl::handler& cgh,
+						  const CellStateVector<3>& U,
+						  const FaceBedVector<3>& zf,
+						  const CellStateVector<3>& dU,
+						  FaceStateVector<3>& F)
+    : Base(cgh, U, zf, dU, F)
+  {}
+
+  static sycl::range<2> get_range(const MeshType& mesh)
+  {
+    auto nfaces = mesh.get_face_index_size(D);
+    return sycl::range<2>(nfaces[1], (nfaces[0] + Lanes - 1) / Lanes);
+  }
+
+  void operator()(sycl::item<2> item) const
+  {
+    size_t row_faces = this->nx_ + (D == 0 ? 1 : 0);
+    size_t i = item.get_id(1) * Lanes;
+    size_t j = item.get_id(0);
+
+    if (i + Lanes <= row_faces) {
+      calculate_run<Lanes>(i, j);
+    } else {
+      for (; i < row_faces; ++i) {
+	calculate_run<1>(i, j);
+      }
+    }
+  }
+};
+
+#endif
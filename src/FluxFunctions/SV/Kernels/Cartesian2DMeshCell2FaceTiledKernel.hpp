@@ -0,0 +1,224 @@
+/***********************************************************************
+ * FluxFunctions/SV/Kernels/Cartesian2DMeshCell2FaceTiledKernel.hpp
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef FluxFunctions_SV_Kernels_Cartesian2DMeshCell2FaceTiledKernel_hpp
+#define FluxFunctions_SV_Kernels_Cartesian2DMeshCell2FaceTiledKernel_hpp
+
+#include "SVFaceFlux.hpp"
+#include "SVFaceBed.hpp"
+
+// Work-group tiled version of the flux kernel for the faces normal to
+// the D-direction. Each work-group covers a tile of faces and first
+// copies the data for the cells either side of them (the tile of cells
+// plus one extra row or column on the upstream side) into local
+// memory, so that each cell is read from global memory once rather
+// than once for each of its faces.
+//
+// The kernel is launched over an nd_range whose dimension 0 is the row
+// (y-index) and dimension 1 the column (x-index) of the face. The
+// global range is rounded up to a whole number of tiles; items beyond
+// the edge of the face block help to fill the tile but write nothing.
+template<typename T,
+	 int D,
+	 FieldStorage FS = FieldStorage::Separate,
+	 typename BT = T,
+	 typename M = ExactMath>
+class SVCartesian2DMeshCell2FaceTiledFluxFunctionKernel
+{
+protected:
+
+  using ValueType = T;
+  using MeshType = Cartesian2DMesh;
+
+  template<size_t N>
+  using FaceBedVector = FieldVector<BT,MeshType,FieldMapping::Face,N>;
+
+  template<size_t N>
+  using CellStateVector = FieldVector<T,MeshType,FieldMapping::Cell,N,FS>;
+
+  template<size_t N>
+  using FaceStateVector = FieldVector<T,MeshType,FieldMapping::Face,N,FS>;
+
+  template<size_t N>
+  using ReadFaceBedAccessor =
+    typename FaceBedVector<N>::template Accessor<sycl::access::mode::read>;
+
+  template<size_t N>
+  using ReadStateAccessor =
+    typename CellStateVector<N>::template Accessor<sycl::access::mode::read>;
+
+  template<size_t N>
+  using WriteAccessor =
+    typename FaceStateVector<N>::template Accessor<sycl::access::mode::write>;
+
+  using LocalAccessor = sycl::accessor<T, 1,
+				       sycl::access::mode::read_write,
+				       sycl::access::target::local>;
+
+  // Values held in local memory for each cell: h, u, v and the slopes
+  // of h, u and v normal to the face. The bed at each face is read
+  // directly (see SVFaceBed.hpp).
+  static const size_t TileValues = 6;
+
+  ReadStateAccessor<3> U_ro_;
+  ReadFaceBedAccessor<3> zf_ro_;
+  ReadStateAccessor<3> dU_ro_;
+  WriteAccessor<3> F_wo_;
+
+  size_t nx_;
+  size_t ny_;
+  size_t x_face_count_;
+  ValueType ds_;
+
+  // Tile size (in faces) in the x- and y-directions and the size of
+  // the tile of cells either side of those faces
+  size_t tx_;
+  size_t ty_;
+  size_t cx_;
+  size_t cy_;
+
+  LocalAccessor cell_tile_;
+
+  using SideType = SVFaceSide<T,BT>;
+  using FaceFluxType = SVFaceFlux<T,BT,M>;
+  using FaceBedType = SVFaceBed<BT>;
+
+  // The bed is given by the bed at the face instead
+  SideType get_side(const size_t& k) const
+  {
+    size_t count = cx_ * cy_;
+    return { 0.0f, 0.0f,
+	     cell_tile_[k], cell_tile_[3 * count + k],
+	     cell_tile_[(1 + D) * count + k], cell_tile_[(4 + D) * count + k],
+	     cell_tile_[(2 - D) * count + k], cell_tile_[(5 - D) * count + k] };
+  }
+
+public:
+
+  // dU is the slope of the solution in the D-direction
+  SVCartesian2DMeshCell2FaceTiledFluxFunctionKernel(sycl::handler& cgh,
+						    const CellStateVector<3>& U,
+						    const FaceBedVector<3>& zf,
+						    const CellStateVector<3>& dU,
+						    FaceStateVector<3>& F,
+						    const std::array<size_t,2>& tile_size)
+    : U_ro_(U.get_read_accessor(cgh)),
+      zf_ro_(zf.get_read_accessor(cgh)),
+      dU_ro_(dU.get_read_accessor(cgh)),
+      F_wo_(F.get_write_accessor(cgh)),
+      nx_(U.mesh_definition()->get_cell_index_size()[0]),
+      ny_(U.mesh_definition()->get_cell_index_size()[1]),
+      x_face_count_(U.mesh_definition()->x_face_count()),
+      ds_(U.mesh_definition()->cell_size()[D]),
+      tx_(tile_size[0]),
+      ty_(tile_size[1]),
+      cx_(tile_size[0] + (D == 0 ? 1 : 0)),
+      cy_(tile_size[1] + (D == 1 ? 1 : 0)),
+      cell_tile_(sycl::range<1>(TileValues *
+				(tile_size[0] + (D == 0 ? 1 : 0)) *
+				(tile_size[1] + (D == 1 ? 1 : 0))), cgh)
+  {}
+
+  static sycl::nd_range<2> get_range(const MeshType& mesh,
+				     const std::array<size_t,2>& tile_size)
+  {
+    auto nfaces = mesh.get_face_index_size(D);
+    size_t gx = ((nfaces[0] + tile_size[0] - 1) / tile_size[0]) * tile_size[0];
+    size_t gy = ((nfaces[1] + tile_size[1] - 1) / tile_size[1]) * tile_size[1];
+    return sycl::nd_range<2>(sycl::range<2>(gy, gx),
+			     sycl::range<2>(tile_size[1], tile_size[0]));
+  }
+
+  void operator()(sycl::nd_item<2> item) const
+  {
+    size_t lj = item.get_local_id(0);
+    size_t li = item.get_local_id(1);
+    size_t j0 = item.get_group(0) * ty_;
+    size_t i0 = item.get_group(1) * tx_;
+
+    // Fill the tile of cells. The extra row or column is on the
+    // upstream side, so local cell (r, c) is global cell (j0 + r - 1,
+    // i0 + c) for y-faces and (j0 + r, i0 + c - 1) for x-faces. Cells
+    // off the edge of the mesh are clamped to the edge; they are only
+    // ever used on the wall side of an edge face, which is replaced
+    // below.
+    size_t count = cx_ * cy_;
+    for (size_t k = lj * tx_ + li; k < count; k += tx_ * ty_) {
+      size_t r = k / cx_;
+      size_t c = k % cx_;
+      size_t gj = sycl::min(sycl::max(j0 + r + (D == 0 ? 1 : 0),
+				      (size_t) 1), ny_) - 1;
+      size_t gi = sycl::min(sycl::max(i0 + c + (D == 1 ? 1 : 0),
+				      (size_t) 1), nx_) - 1;
+      size_t gid = gj * nx_ + gi;
+      cell_tile_[k] = U_ro_[0][gid];
+      cell_tile_[count + k] = U_ro_[1][gid];
+      cell_tile_[2 * count + k] = U_ro_[2][gid];
+      cell_tile_[3 * count + k] = dU_ro_[0][gid];
+      cell_tile_[4 * count + k] = dU_ro_[1][gid];
+      cell_tile_[5 * count + k] = dU_ro_[2][gid];
+    }
+
+    item.barrier(sycl::access::fence_space::local_space);
+
+    size_t j = j0 + lj;
+    size_t i = i0 + li;
+    size_t fid;
+    if (D == 0) {
+      if (j >= ny_ or i > nx_) return;
+      fid = j * (nx_ + 1) + i;
+    } else {
+      if (j > ny_ or i >= nx_) return;
+      fid = x_face_count_ + j * nx_ + i;
+    }
+
+    // Local ids of the cells either side of the face
+    size_t lhs_k = lj * cx_ + li;
+    size_t rhs_k = lhs_k + (D == 0 ? 1 : cx_);
+
+    // The bed level on the fake side of a wall (mesh edge or inactive
+    // cell) is NaN. If both sides are fake, just return zero flux.
+    BT z_m = zf_ro_[0][fid];
+    BT z_p = zf_ro_[1][fid];
+    if (z_m != z_m and z_p != z_p) {
+      F_wo_[0][fid] = 0.0f;
+      F_wo_[1][fid] = 0.0f;
+      F_wo_[2][fid] = 0.0f;
+      return;
+    }
+
+    int edge = 0; // -1 if the LHS cell is fake, 1 if the RHS cell is
+		  // fake
+    if (z_m != z_m) {
+      lhs_k = rhs_k;
+      edge = -1;
+    } else if (z_p != z_p) {
+      rhs_k = lhs_k;
+      edge = 1;
+    }
+
+    SideType L = get_side(lhs_k);
+    SideType R = get_side(rhs_k);
+
+    // If one of the cells is fake, replace it with a wall
+    if (edge < 0) {
+      L = FaceFluxType::wall(R);
+      z_m = FaceBedType::wall_level(zf_ro_[2][fid], R.h);
+    } else if (edge > 0) {
+      R = FaceFluxType::wall(L);
+      z_p = FaceBedType::wall_level(zf_ro_[2][fid], L.h);
+    }
+
+    std::array<ValueType,3> F;
+    FaceFluxType::template calculate<D>(z_m, z_p, L, R, ds_, F);
+
+    F_wo_[0][fid] = F[0];
+    F_wo_[1][fid] = F[1];
+    F_wo_[2][fid] = F[2];
+  }
+};
+
+#endif
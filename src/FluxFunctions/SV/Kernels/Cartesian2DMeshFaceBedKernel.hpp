@@ -0,0 +1,131 @@
+/***********************************************************************
+ * FluxFunctions/SV/Kernels/Cartesian2DMeshFaceBedKernel.hpp
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef FluxFunctions_SV_Kernels_Cartesian2DMeshFaceBedKernel_hpp
+#define FluxFunctions_SV_Kernels_Cartesian2DMeshFaceBedKernel_hpp
+
+#include "SVFaceBed.hpp"
+
+// Calculates the bed at the faces normal to the D-direction (0: x,
+// 1: y) (see SVFaceBed.hpp). Launched, like the flux kernel, over the
+// 2D block of those faces.
+template<typename T,
+	 int D,
+	 typename CT = T,
+	 typename BT = T>
+class SVCartesian2DMeshFaceBedKernel
+{
+protected:
+
+  using ValueType = T;
+  using MeshType = Cartesian2DMesh;
+
+  template<size_t N>
+  using CellBedVector = FieldVector<BT,MeshType,FieldMapping::Cell,N>;
+
+  template<size_t N>
+  using CellConstantVector = FieldVector<CT,MeshType,FieldMapping::Cell,N>;
+
+  template<size_t N>
+  using FaceBedVector = FieldVector<BT,MeshType,FieldMapping::Face,N>;
+
+  template<size_t N>
+  using ReadBedAccessor =
+    typename CellBedVector<N>::template Accessor<sycl::access::mode::read>;
+
+  template<size_t N>
+  using ReadConstantAccessor =
+    typename CellConstantVector<N>::template Accessor<sycl::access::mode::read>;
+
+  template<size_t N>
+  using WriteAccessor =
+    typename FaceBedVector<N>::template Accessor<sycl::access::mode::write>;
+
+  ReadBedAccessor<1> zb_ro_;
+  ReadConstantAccessor<2> dzb_ro_;
+  WriteAccessor<3> zf_wo_;
+
+  size_t nx_;
+  size_t ny_;
+  size_t x_face_count_;
+  ValueType ds_;
+
+public:
+
+  SVCartesian2DMeshFaceBedKernel(sycl::handler& cgh,
+				 const CellBedVector<1>& zb,
+				 const CellConstantVector<2>& dzb,
+				 FaceBedVector<3>& zf)
+    : zb_ro_(zb.get_read_accessor(cgh)),
+      dzb_ro_(dzb.get_read_accessor(cgh)),
+      zf_wo_(zf.get_write_accessor(cgh)),
+      nx_(zb.mesh_definition()->get_cell_index_size()[0]),
+      ny_(zb.mesh_definition()->get_cell_index_size()[1]),
+      x_face_count_(zb.mesh_definition()->x_face_count()),
+      ds_(zb.mesh_definition()->cell_size()[D])
+  {}
+
+  static sycl::range<2> get_range(const MeshType& mesh)
+  {
+    auto nfaces = mesh.get_face_index_size(D);
+    return sycl::range<2>(nfaces[1], nfaces[0]);
+  }
+
+  void operator()(sycl::item<2> item) const
+  {
+    calculate(item.get_id(1), item.get_id(0));
+  }
+
+  // Calculate the bed at the face with (x, y) index (i, j)
+  void calculate(const size_t& i, const size_t& j) const
+  {
+    size_t local_id = j * (nx_ + (D == 0 ? 1 : 0)) + i;
+
+    size_t fid, lhs_id, rhs_id;
+    bool has_lhs, has_rhs;
+    if (D == 0) {
+      fid = local_id;
+      rhs_id = local_id - j;
+      lhs_id = rhs_id - 1;
+      has_lhs = (i > 0);
+      has_rhs = (i < nx_);
+    } else {
+      fid = x_face_count_ + local_id;
+      rhs_id = local_id;
+      lhs_id = local_id - nx_;
+      has_lhs = (j > 0);
+      has_rhs = (j < ny_);
+    }
+
+    // A cell off the edge of the mesh is treated as inactive
+    BT nan = std::numeric_limits<BT>::quiet_NaN();
+    BT zb_L = (has_lhs ? zb_ro_[0][lhs_id] : nan);
+    BT zb_R = (has_rhs ? zb_ro_[0][rhs_id] : nan);
+
+    // Project central estimates of bed level from each cell to the
+    // face
+    BT z_m = nan;
+    BT z_p = nan;
+    if (zb_L == zb_L) {
+      z_m = zb_L + 0.5f * ds_ * static_cast<ValueType>(dzb_ro_[D][lhs_id]);
+    }
+    if (zb_R == zb_R) {
+      z_p = zb_R - 0.5f * ds_ * static_cast<ValueType>(dzb_ro_[D][rhs_id]);
+    }
+
+    zf_wo_[0][fid] = z_m;
+    zf_wo_[1][fid] = z_p;
+    if (z_m != z_m and z_p == z_p) {
+      zf_wo_[2][fid] = zb_R;
+    } else if (z_p != z_p and z_m == z_m) {
+      zf_wo_[2][fid] = zb_L;
+    } else {
+      zf_wo_[2][fid] = nan;
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,58 @@
+/***********************************************************************
+ * FluxFunctions/SV/Kernels/SVFaceBed.hpp
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef FluxFunctions_SV_Kernels_SVFaceBed_hpp
+#define FluxFunctions_SV_Kernels_SVFaceBed_hpp
+
+// The bed at a face, which depends only on the bed levels and slopes
+// of the cells either side and so is calculated once. It is stored as
+// a face field vector with the components
+//
+//   z_m: bed level projected from the upstream (-) cell to the face
+//   z_p: bed level projected from the downstream (+) cell to the face
+//   z_w: on a wall, the bed level at the centre of the real cell
+//
+// A wall is a face on the edge of the mesh or next to an inactive
+// cell. The level on its fake side is NaN and is formed, as by
+// SVFaceFlux::wall(), from z_w and the depth in the real cell. All
+// three are NaN if neither cell is real, and z_w is NaN if both are.
+template<typename BT>
+class SVFaceBed
+{
+public:
+
+  using BedType = BT;
+
+  // Bed level on the fake side of a wall, given the depth in the real
+  // cell
+  template<typename T>
+  static BedType wall_level(const BedType& z_w, const T& h)
+  {
+    return z_w + h * 1.1f;
+  }
+
+  // Height of the step in bed level (z_p - z_m) at face fid, given the
+  // depth in the real cell if the face is a wall. zf is the accessor
+  // to the face bed vector; z_w is only read on walls.
+  template<typename T, typename Accessor>
+  static T step(const Accessor& zf, const size_t& fid, const T& h)
+  {
+    BedType z_m = zf[0][fid];
+    BedType z_p = zf[1][fid];
+    if (z_m == z_m and z_p == z_p) return (T) (z_p - z_m);
+    if (z_m != z_m and z_p != z_p) return 0.0f;
+
+    BedType z_wall = wall_level(zf[2][fid], h);
+    if (z_m != z_m) {
+      return (T) (z_p - z_wall);
+    } else {
+      return (T) (z_wall - z_m);
+    }
+  }
+
+};
+
+#endif
@@ -0,0 +1,234 @@
+/***********************************************************************
+ * FluxFunctions/SV/Kernels/SVFaceFlux.hpp
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef FluxFunctions_SV_Kernels_SVFaceFlux_hpp
+#define FluxFunctions_SV_Kernels_SVFaceFlux_hpp
+
+#include "../../../MathProfile.hpp"
+
+// Cell-centred values and their slopes normal to a face for the cell
+// on one side of that face. Velocities are stored as the components
+// normal (n) and tangential (t) to the face. The bed level has type BT,
+// which may be wider than T.
+template<typename T, typename BT = T>
+struct SVFaceSide
+{
+  BT zb;
+  T dzb;
+  T h, dh;
+  T un, dun;
+  T ut, dut;
+};
+
+// The bed and water levels at the face are formed in BT; the depths,
+// velocities and fluxes are in T. M is the math profile (see
+// MathProfile.hpp).
+template<typename T, typename BT = T, typename M = ExactMath>
+class SVFaceFlux
+{
+public:
+
+  using ValueType = T;
+  using BedType = BT;
+  using SideType = SVFaceSide<T,BT>;
+
+  // Construct the "fake" cell on the far side of a wall (mesh edge or
+  // inactive cell) from the real cell on the near side. The fake cell
+  // is dry, has its bed level above the water level of the real cell
+  // and carries no flow normal to the face.
+  static SideType wall(const SideType& real)
+  {
+    return { real.zb + real.h * 1.1f, 0.0f,
+	     0.0f, 0.0f,
+	     0.0f, 0.0f,
+	     real.ut, real.dut };
+  }
+
+  // Calculate the mass and momentum fluxes across a face normal to
+  // the D-direction (0: x, 1: y) of size ds in that direction, and
+  // the height of the step in bed level at the face.
+  //
+  // F receives { h-flux, u-flux, v-flux, Δz }.
+  template<int D>
+  static void calculate(const SideType& L,
+			const SideType& R,
+			const ValueType& ds,
+			std::array<ValueType,4>& F)
+  {
+    // Project central estimates of bed level from each cell to the
+    // upstream (m,-) and downstream (p,+) sides of each face
+    BedType z_m = L.zb + 0.5f * ds * L.dzb;
+    BedType z_p = R.zb - 0.5f * ds * R.dzb;
+
+    std::array<ValueType,3> H;
+    calculate<D>(z_m, z_p, L, R, ds, H);
+
+    F[0] = H[0];
+    F[1] = H[1];
+    F[2] = H[2];
+    F[3] = (ValueType) (z_p - z_m);
+  }
+
+  // As above, with the bed levels on the upstream (z_m) and downstream
+  // (z_p) sides of the face already known (see SVFaceBed.hpp). The
+  // bed levels and slopes of L and R are not used.
+  //
+  // F receives { h-flux, u-flux, v-flux }.
+  template<int D>
+  static void calculate(const BedType& z_m,
+			const BedType& z_p,
+			const SideType& L,
+			const SideType& R,
+			const ValueType& ds,
+			std::array<ValueType,3>& F)
+  {
+    ValueType h_m = L.h + 0.5f * ds * L.dh;
+    ValueType h_p = R.h - 0.5f * ds * R.dh;
+
+    ValueType un_m = L.un + 0.5f * ds * L.dun;
+    ValueType un_p = R.un - 0.5f * ds * R.dun;
+
+    ValueType ut_m = L.ut + 0.5f * ds * L.dut;
+    ValueType ut_p = R.ut - 0.5f * ds * R.dut;
+
+    BedType z_f = sycl::fmax(z_m, z_p);
+
+    // Limit the depths at the face.
+    h_m = sycl::fmax(h_m, (ValueType) 0.0f);
+    h_p = sycl::fmax(h_p, (ValueType) 0.0f);
+
+    // Calculate water levels at the face
+    BedType y_m = z_m + h_m;
+    BedType y_p = z_p + h_p;
+
+    // Calculate the wave speed, c = √(gh)
+    ValueType c_m = M::sqrt(9.81f * h_m);
+    ValueType c_p = M::sqrt(9.81f * h_p);
+
+    // Calculate the face fluxes
+    ValueType Hh, Hn, Ht;
+
+    if (y_m > z_f or y_p > z_f) {
+      // Fully submerged case
+      ValueType Fh_m = h_m * un_m;
+      ValueType Fh_p = h_p * un_p;
+      ValueType Fn_m = un_m * (0.5f * un_m) + 9.81f * h_m;
+      ValueType Fn_p = un_p * (0.5f * un_p) + 9.81f * h_p;
+      ValueType Ft_m = ut_m * un_m;
+      ValueType Ft_p = ut_p * un_p;
+
+      ValueType a = sycl::fmax(sycl::fabs(un_p + sycl::sign(un_p) * c_p),
+			       sycl::fabs(un_m + sycl::sign(un_m) * c_m));
+
+      Hh = 0.5f * (Fh_p + Fh_m) - 0.5f * a * (h_p - h_m);
+      Hn = 0.5f * (Fn_p + Fn_m) - 0.5f * a * (un_p - un_m);
+      Ht = 0.5f * (Ft_p + Ft_m) - 0.5f * a * (ut_p - ut_m);
+    } else if (h_m <= 0.0f and h_p <= 0.0f) {
+      // Fully dry case
+      Hh = Hn = Ht = 0.0f;
+    } else {
+      // Partially submerged step
+      if (z_m > z_p) {
+	ValueType Fh = h_m * un_m;
+	ValueType Fn = un_m * (0.5f * un_m) + 9.81f * h_m;
+	ValueType Ft = ut_m * (0.5f * un_m);
+
+	ValueType a = sycl::fabs(un_m + sycl::sign(un_m) * c_m);
+
+	Hh = Fh - 0.5f * a * -h_m;
+	Hn = Fn - 0.5f * a * -un_m;
+	Ht = Ft - 0.5f * a * -ut_m;
+      } else {
+	ValueType Fh = h_p * un_p;
+	ValueType Fn = un_p * (0.5f * un_p) + 9.81f * h_p;
+	ValueType Ft = ut_p * (0.5f * un_p);
+
+	ValueType a = sycl::fabs(un_p + sycl::sign(un_p) * c_p);
+
+	Hh = Fh - 0.5f * a * h_p;
+	Hn = Fn - 0.5f * a * un_p;
+	Ht = Ft - 0.5f * a * ut_p;
+      }
+    }
+
+    F[0] = Hh;
+    F[1 + D] = Hn;
+    F[2 - D] = Ht;
+  }
+
+  // As above, but without branches: the submerged flux and the flux
+  // over a partially submerged step are both found and the result
+  // chosen from them (and zero for the dry case) by selects. The
+  // result is the same; the work is greater per face but lets the
+  // compiler calculate several faces at once in SIMD lanes (see
+  // Cartesian2DMeshCell2FaceRowKernel.hpp).
+  template<int D>
+  static void calculate_blended(const BedType& z_m,
+				const BedType& z_p,
+				const SideType& L,
+				const SideType& R,
+				const ValueType& ds,
+				std::array<ValueType,3>& F)
+  {
+    ValueType h_m = L.h + 0.5f * ds * L.dh;
+    ValueType h_p = R.h - 0.5f * ds * R.dh;
+
+    ValueType un_m = L.un + 0.5f * ds * L.dun;
+    ValueType un_p = R.un - 0.5f * ds * R.dun;
+
+    ValueType ut_m = L.ut + 0.5f * ds * L.dut;
+    ValueType ut_p = R.ut - 0.5f * ds * R.dut;
+
+    BedType z_f = sycl::fmax(z_m, z_p);
+
+    h_m = sycl::fmax(h_m, (ValueType) 0.0f);
+    h_p = sycl::fmax(h_p, (ValueType) 0.0f);
+
+    BedType y_m = z_m + h_m;
+    BedType y_p = z_p + h_p;
+
+    ValueType c_m = M::sqrt(9.81f * h_m);
+    ValueType c_p = M::sqrt(9.81f * h_p);
+
+    ValueType a_m = sycl::fabs(un_m + sycl::sign(un_m) * c_m);
+    ValueType a_p = sycl::fabs(un_p + sycl::sign(un_p) * c_p);
+
+    ValueType Fh_m = h_m * un_m;
+    ValueType Fh_p = h_p * un_p;
+    ValueType Fn_m = un_m * (0.5f * un_m) + 9.81f * h_m;
+    ValueType Fn_p = un_p * (0.5f * un_p) + 9.81f * h_p;
+
+    // Fully submerged case
+    ValueType a = sycl::fmax(a_p, a_m);
+    ValueType Hh = 0.5f * (Fh_p + Fh_m) - 0.5f * a * (h_p - h_m);
+    ValueType Hn = 0.5f * (Fn_p + Fn_m) - 0.5f * a * (un_p - un_m);
+    ValueType Ht = (0.5f * (ut_p * un_p + ut_m * un_m)
+		    - 0.5f * a * (ut_p - ut_m));
+
+    // Partially submerged step, from the higher side. The jumps
+    // across the face are to or from zero on the lower side.
+    bool from_m = (z_m > z_p);
+    ValueType a_s = (from_m ? a_m : a_p);
+    ValueType un_s = (from_m ? un_m : un_p);
+    ValueType ut_s = (from_m ? ut_m : ut_p);
+    ValueType Ph = ((from_m ? Fh_m : Fh_p)
+		    - 0.5f * a_s * (from_m ? -h_m : h_p));
+    ValueType Pn = ((from_m ? Fn_m : Fn_p)
+		    - 0.5f * a_s * (from_m ? -un_m : un_p));
+    ValueType Pt = (ut_s * (0.5f * un_s)
+		    - 0.5f * a_s * (from_m ? -ut_m : ut_p));
+
+    bool submerged = (y_m > z_f or y_p > z_f);
+    bool dry = (h_m <= 0.0f and h_p <= 0.0f);
+
+    F[0] = (submerged ? Hh : (dry ? (ValueType) 0.0f : Ph));
+    F[1 + D] = (submerged ? Hn : (dry ? (ValueType) 0.0f : Pn));
+    F[2 - D] = (submerged ? Ht : (dry ? (ValueType) 0.0f : Pt));
+  }
+
+};
+
+#endif
@@ -8,31 +8,42 @@
 #define FluxFunctions_SVFluxFunction_hpp
 
 #include "../FluxFunction.hpp"
+#include "../ActiveTileSet.hpp"
 
 template<typename T,
 	 typename MeshType,
 	 FieldMapping FromFM,
 	 FieldMapping ToFM,
 	 size_t FromN,
-	 size_t ToN>
+	 size_t ToN,
+	 FieldStorage FS = FieldStorage::Separate,
+	 typename CT = T,
+	 typename BT = T>
 class SVFluxFunction
-  : public FluxFunction<T, MeshType, FromFM, ToFM, FromN, ToN>
+  : public FluxFunction<T, MeshType, FromFM, ToFM, FromN, ToN, FS, CT, BT>
 {
 public:
   
-  SVFluxFunction(void)
-    : FluxFunction<T, MeshType, FromFM, ToFM, FromN, ToN>()
+  SVFluxFunction(const std::array<size_t,2>& tile_size = { 0, 0 },
+		 const std::shared_ptr<ActiveTileSet<MeshType>>& active_tiles = nullptr)
+    : FluxFunction<T, MeshType, FromFM, ToFM, FromN, ToN, FS, CT, BT>()
   {}
 
   virtual ~SVFluxFunction(void)
   {}
 
-  virtual void calculate(const FieldVector<T,MeshType,FromFM,FromN>& U,
-			 const FieldVector<T,MeshType,FromFM,3>& zb,
-			 const FieldVector<T,MeshType,FromFM,4>& n,
-			 const FieldVector<T,MeshType,FromFM,FromN>& dUdx,
-			 const FieldVector<T,MeshType,FromFM,FromN>& dUdy,
-			 FieldVector<T,MeshType,ToFM,ToN>& F) const
+  virtual void calculate_face_bed(const FieldVector<BT,MeshType,FromFM,1>& zb,
+				  const FieldVector<CT,MeshType,FromFM,2>& dzb,
+				  FieldVector<BT,MeshType,ToFM,3>& zf) const
+  {
+    throw std::logic_error("This type of flux function is not implemented.");
+  }
+
+  virtual void calculate(const FieldVector<T,MeshType,FromFM,FromN,FS>& U,
+			 const FieldVector<BT,MeshType,ToFM,3>& zf,
+			 const FieldVector<T,MeshType,FromFM,FromN,FS>& dUdx,
+			 const FieldVector<T,MeshType,FromFM,FromN,FS>& dUdy,
+			 FieldVector<T,MeshType,ToFM,ToN,FS>& F) const
   {
     throw std::logic_error("This type of flux function is not implemented.");
   }
@@ -8,6 +8,7 @@
 
 #include "TimeSeries.hpp"
 #include "RasterField.hpp"
+#include "StepGraph.hpp"
 
 #include "RasterFormats/GDAL.hpp"
 #include "RasterFormats/NIMROD.hpp"
@@ -124,7 +125,13 @@ load_raster_field<double>(const std::shared_ptr<sycl::queue>& queue,
 
 GlobalConfig::DeviceParameters::DeviceParameters(GlobalConfig* gconf)
   : platform_id(0),
-    device_id(0)
+    device_id(0),
+#ifdef MORGFLOW_USM
+    in_order_queue(true),
+    usm_allocation(sycl::usm::alloc::device)
+#else
+    in_order_queue(false)
+#endif
 {
   using boost::algorithm::to_lower_copy;
   const Config& conf = gconf->configuration().get_child("device parameters");
@@ -138,7 +145,7 @@ GlobalConfig::DeviceParameters::DeviceParameters(GlobalConfig* gconf)
     platform_name = "ID = " + std::to_string(platform_id);
   } else {
     std::string requested_platform_list =
-      conf.get<std::string>("platforms", "show,cuda,hip,omp");
+      conf.get<std::string>("platforms", "show,cuda,hip,omp,host");
     std::vector<std::string> requested_platforms =
       split_string<std::string>(requested_platform_list);
 	
@@ -239,6 +246,38 @@ GlobalConfig::DeviceParameters::DeviceParameters(GlobalConfig* gconf)
     std::cerr << "Device " << device_name << " not found." << std::endl;
     throw std::runtime_error("Device not available.");
   }
+
+  in_order_queue = conf.get<bool>("in order queue", in_order_queue);
+#ifdef MORGFLOW_USM
+  if (not in_order_queue) {
+    std::cerr << "Data arrays in USM builds are accessed through pointers, "
+	      << "which give the commands no dependencies, so the queue "
+	      << "must run them in order." << std::endl;
+    throw std::runtime_error("USM build needs an in-order queue");
+  }
+
+  std::string usm_name =
+    to_lower_copy(conf.get<std::string>("usm allocation", "device"));
+  if (usm_name == "device") {
+    usm_allocation = sycl::usm::alloc::device;
+  } else if (usm_name == "shared") {
+    usm_allocation = sycl::usm::alloc::shared;
+  } else {
+    std::cerr << "Unknown USM allocation: " << usm_name
+	      << " (expected device or shared)" << std::endl;
+    throw std::runtime_error("Unknown USM allocation");
+  }
+  std::cout << "Using " << usm_name << " USM allocations." << std::endl;
+#else
+  if (conf.count("usm allocation") > 0) {
+    std::cerr << "USM allocations need a build with MORGFLOW_USM defined."
+	      << std::endl;
+    throw std::runtime_error("USM allocation in buffer build");
+  }
+#endif
+  if (in_order_queue) {
+    std::cout << "Using an in-order queue." << std::endl;
+  }
 }
 
 GlobalConfig::RunParameters::RunParameters(GlobalConfig* gconf)
@@ -285,7 +324,11 @@ GlobalConfig::TimestepParameters::TimestepParameters(GlobalConfig* gconf)
   : dt_type(DtType::undefined),
     time_step(1.0),
     max_time_step(9999.0),
-    courant_target(0.999)
+    courant_target(0.999),
+    steps_per_sync(0),
+    record_steps(false),
+    courant_check_interval(100),
+    courant_exceeded(CourantExceeded::adaptive)
 {
   using boost::algorithm::to_lower_copy;
   const Config& conf = gconf->configuration().get_child("timestep parameters");
@@ -301,6 +344,37 @@ GlobalConfig::TimestepParameters::TimestepParameters(GlobalConfig* gconf)
   time_step = conf.get<double>("time step", time_step);
   max_time_step = conf.get<double>("max time step", max_time_step);
   courant_target = conf.get<double>("courant target", courant_target);
+  steps_per_sync = conf.get<size_t>("steps per sync", steps_per_sync);
+  record_steps = conf.get<bool>("record steps", record_steps);
+  if (record_steps and steps_per_sync == 0) {
+    std::cerr << "Steps can only be recorded with the time step "
+	      << "controlled on the device (steps per sync)." << std::endl;
+    throw std::runtime_error("Step recording without steps per sync");
+  }
+  if (record_steps and not StepGraph::available) {
+    std::cerr << "Steps cannot be recorded: this build does not have "
+	      << "the SYCL command graph extension." << std::endl;
+    throw std::runtime_error("Step recording not available");
+  }
+  courant_check_interval = conf.get<size_t>("courant check interval",
+					    courant_check_interval);
+  if (courant_check_interval == 0) {
+    std::cerr << "Courant check interval must be at least one step."
+	      << std::endl;
+    throw std::runtime_error("Invalid Courant check interval");
+  }
+
+  std::string exceeded =
+    to_lower_copy(conf.get<std::string>("courant exceeded", "adaptive"));
+  if (exceeded == "abort") {
+    courant_exceeded = CourantExceeded::abort;
+  } else if (exceeded == "adaptive") {
+    courant_exceeded = CourantExceeded::adaptive;
+  } else {
+    std::cerr << "Action when the Courant target is exceeded ('"
+	      << exceeded << "') not known." << std::endl;
+    throw std::runtime_error("Unknown Courant exceeded action");
+  }
 
   if (conf.count("ddt scheme") > 0) {
     ddt_scheme_config = conf.get_child("ddt scheme");
@@ -327,6 +401,206 @@ GlobalConfig::TimestepParameters::TimestepParameters(GlobalConfig* gconf)
 			"Δtₘₐₓ", std::to_string(9999.0), std::to_string(max_time_step));
   params.write_data_row("Courant Number Target",
 			"Coₘₐₓ", std::to_string(0.999), std::to_string(courant_target));
+  params.write_data_row("Steps per host synchronization",
+			"", std::to_string(0), std::to_string(steps_per_sync));
+  if (steps_per_sync > 0) {
+    params.write_data_row("Record and replay steps",
+			  "", "false", (record_steps ? "true" : "false"));
+  }
+  if (dt_type == DtType::fixed) {
+    params.write_data_row("Steps per Courant check",
+			  "", std::to_string(100),
+			  std::to_string(courant_check_interval));
+    params.write_data_row("On exceeding Courant target",
+			  "", "adaptive", exceeded);
+  }
+  params.write_bot_rule();
+}
+
+GlobalConfig::SolverParameters::SolverParameters(GlobalConfig* gconf)
+  : fused_kernel(false),
+    tile_size({ 0, 0 }),
+    active_tile_size(0),
+    cpu_flux_kernel(false),
+    autotune(false),
+    state_storage(StateStorage::separate),
+    constant_storage(ConstantStorage::full),
+    precision(Precision::single_precision),
+    math_profile(MathProfile::exact),
+    compare_math_profiles(false),
+    math_profile_tolerance(0.01),
+    friction(Friction::explicit_friction)
+{
+  using boost::algorithm::to_lower_copy;
+  Config empty;
+  const Config& conf =
+    gconf->configuration().get_child("solver parameters", empty);
+
+  fused_kernel = conf.get<bool>("fused kernel", fused_kernel);
+
+  bool tiled_kernels = conf.get<bool>("tiled kernels", false);
+  if (tiled_kernels) {
+    tile_size[0] = conf.get<size_t>("tile size x", 16);
+    tile_size[1] = conf.get<size_t>("tile size y", 16);
+    if (tile_size[0] == 0 or tile_size[1] == 0) {
+      std::cerr << "Tile size (" << tile_size[0] << " x " << tile_size[1]
+		<< ") must be non-zero." << std::endl;
+      throw std::runtime_error("Invalid tile size");
+    }
+#ifdef MORGFLOW_HOST_BACKEND
+    std::cerr << "The tiled stencil kernels synchronise their work-groups, "
+	      << "which the host backend cannot do." << std::endl;
+    throw std::runtime_error("Tiled kernels not available");
+#endif
+  }
+
+  // Active tiles must be at least twice as wide as the number of
+  // Runge-Kutta stages (at most four, other than for the low-storage
+  // schemes, which check their own) so that a disturbance cannot cross
+  // more than one tile in a step.
+  bool active_tiles = conf.get<bool>("active tiles", false);
+  if (active_tiles) {
+    active_tile_size = conf.get<size_t>("active tile size", 16);
+    if (active_tile_size < 8) {
+      std::cerr << "Active tile size (" << active_tile_size
+		<< ") must be at least 8." << std::endl;
+      throw std::runtime_error("Invalid active tile size");
+    }
+    if (tiled_kernels) {
+      std::cerr << "Active tiles cannot be combined with the tiled "
+		<< "stencil kernels." << std::endl;
+      throw std::runtime_error("Incompatible solver parameters");
+    }
+  }
+
+  cpu_flux_kernel = conf.get<bool>("cpu flux kernel", cpu_flux_kernel);
+
+  autotune = conf.get<bool>("autotune kernels", autotune);
+  if (autotune and active_tiles) {
+    std::cerr << "Kernels cannot be autotuned with active tiles."
+	      << std::endl;
+    throw std::runtime_error("Incompatible solver parameters");
+  }
+
+  std::string storage =
+    to_lower_copy(conf.get<std::string>("state storage", "separate"));
+  if (storage == "separate") {
+    state_storage = StateStorage::separate;
+  } else if (storage == "interleaved") {
+#ifndef MORGFLOW_INTERLEAVED_STATE
+    std::cerr << "Interleaved state storage needs a build with "
+	      << "MORGFLOW_INTERLEAVED_STATE defined." << std::endl;
+    throw std::runtime_error("Interleaved state storage not built");
+#endif
+    state_storage = StateStorage::interleaved;
+  } else {
+    std::cerr << "State storage type ('" << storage
+	      << "') not known." << std::endl;
+    throw std::runtime_error("Unknown state storage type");
+  }
+
+  std::string cstorage =
+    to_lower_copy(conf.get<std::string>("constant storage", "full"));
+  if (cstorage == "full") {
+    constant_storage = ConstantStorage::full;
+  } else if (cstorage == "half") {
+#ifndef MORGFLOW_HALF_CONSTANTS
+    std::cerr << "Half-precision constant storage needs a build with "
+	      << "MORGFLOW_HALF_CONSTANTS defined." << std::endl;
+    throw std::runtime_error("Half-precision constant storage not built");
+#endif
+    constant_storage = ConstantStorage::half;
+  } else {
+    std::cerr << "Constant storage type ('" << cstorage
+	      << "') not known." << std::endl;
+    throw std::runtime_error("Unknown constant storage type");
+  }
+
+  std::string prec =
+    to_lower_copy(conf.get<std::string>("precision", "single"));
+  if (prec == "single" or prec == "float") {
+    precision = Precision::single_precision;
+  } else if (prec == "double") {
+    precision = Precision::double_precision;
+  } else if (prec == "mixed") {
+    precision = Precision::mixed_precision;
+  } else {
+    std::cerr << "Precision ('" << prec << "') not known." << std::endl;
+    throw std::runtime_error("Unknown precision");
+  }
+
+  std::string mprofile =
+    to_lower_copy(conf.get<std::string>("math profile", "exact"));
+  if (mprofile == "exact") {
+    math_profile = MathProfile::exact;
+  } else if (mprofile == "fast") {
+    math_profile = MathProfile::fast;
+  } else if (mprofile == "compare") {
+    compare_math_profiles = true;
+  } else {
+    std::cerr << "Math profile ('" << mprofile << "') not known."
+	      << std::endl;
+    throw std::runtime_error("Unknown math profile");
+  }
+  math_profile_tolerance =
+    conf.get<double>("math profile tolerance", math_profile_tolerance);
+
+  std::string fric =
+    to_lower_copy(conf.get<std::string>("friction", "explicit"));
+  if (fric == "explicit") {
+    friction = Friction::explicit_friction;
+  } else if (fric == "implicit") {
+    friction = Friction::implicit_friction;
+  } else {
+    std::cerr << "Friction treatment ('" << fric << "') not known."
+	      << std::endl;
+    throw std::runtime_error("Unknown friction treatment");
+  }
+
+  DisplayTable<std::string, std::string, std::string, std::string>
+    params({ {40, "Parameter", "%|s|"},
+	     {10, "Symbol", "%|s|"},
+	     {10, "Default", "%|s|"},
+	     {10, "Selected", "%|s|"} });
+  std::cout << "   Reading Solver Parameters:" << std::endl;
+  params.write_top_rule();
+  params.write_header_row();
+  params.write_mid_rule();
+  params.write_data_row("Fused single-pass kernel",
+			"", "false", (fused_kernel ? "true" : "false"));
+  params.write_data_row("Tiled stencil kernels",
+			"", "false", (tiled_kernels ? "true" : "false"));
+  if (tiled_kernels) {
+    params.write_data_row("Tile size",
+			  "", "16 x 16",
+			  std::to_string(tile_size[0]) + " x " +
+			  std::to_string(tile_size[1]));
+  }
+  params.write_data_row("Active tiles",
+			"", "false", (active_tiles ? "true" : "false"));
+  if (active_tiles) {
+    params.write_data_row("Active tile size",
+			  "", "16", std::to_string(active_tile_size));
+  }
+  params.write_data_row("SIMD flux kernel on CPU",
+			"", "false", (cpu_flux_kernel ? "true" : "false"));
+  params.write_data_row("Autotune kernels",
+			"", "false", (autotune ? "true" : "false"));
+  params.write_data_row("Solution state storage",
+			"", "separate", storage);
+  params.write_data_row("Bed slope and roughness storage",
+			"", "full", cstorage);
+  params.write_data_row("Precision",
+			"", "single", prec);
+  params.write_data_row("Math profile",
+			"", "exact", mprofile);
+  if (compare_math_profiles) {
+    params.write_data_row("Math profile depth tolerance",
+			  "", std::to_string(0.01),
+			  std::to_string(math_profile_tolerance));
+  }
+  params.write_data_row("Friction",
+			"", "explicit", fric);
   params.write_bot_rule();
 }
     
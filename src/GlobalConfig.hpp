@@ -45,6 +45,19 @@ public:
     sycl::platform platform;
     sycl::device device;
 
+    // Whether the queue runs its commands in the order they are
+    // submitted, which the solver's commands do anyway, rather than
+    // in the order found from the data they access. USM builds
+    // (MORGFLOW_USM) always do, as their data arrays are accessed
+    // through pointers that give no dependencies.
+    bool in_order_queue;
+
+#ifdef MORGFLOW_USM
+    // Kind of USM allocation holding the device data of data arrays:
+    // device memory, or shared memory migrated on demand
+    sycl::usm::alloc usm_allocation;
+#endif
+
     DeviceParameters(GlobalConfig* gconf);
   };
   
@@ -70,10 +83,98 @@ public:
     double max_time_step;
     double courant_target;
 
+    // Number of steps enqueued between reads of the time step state
+    // back from the device, which then accepts or rejects steps and
+    // chooses the time step itself. Zero to do that on the host after
+    // every step.
+    size_t steps_per_sync;
+
+    // Whether, with the time step controlled on the device, the
+    // commands of a step are recorded once per inner loop and replayed
+    // for each step (see StepGraph.hpp)
+    bool record_steps;
+
+    // With a fixed time step, the control number is only found on
+    // every courant_check_interval-th step and on the last step of
+    // each inner loop. If it then exceeds the Courant target the run
+    // either stops or carries on with an adaptive time step from the
+    // state at the previous check.
+    size_t courant_check_interval;
+    enum class CourantExceeded {
+      abort,
+      adaptive
+    } courant_exceeded;
+
     Config ddt_scheme_config;
 
     TimestepParameters(GlobalConfig* gconf);
   };
+
+  struct SolverParameters
+  {
+    bool fused_kernel;
+
+    // Work-group tile size (x, y) for the tiled stencil kernels. Zero
+    // if the untiled kernels are used.
+    std::array<size_t,2> tile_size;
+
+    // Size of the square tiles of cells used to skip dry areas of the
+    // mesh. Zero if every cell is calculated.
+    size_t active_tile_size;
+
+    // Whether, on a CPU device, the untiled flux kernels are replaced
+    // by ones that calculate runs of faces in SIMD lanes. Off unless
+    // asked for, as it calculates the fluxes by a different path.
+    bool cpu_flux_kernel;
+
+    // Whether the kernel variants above (fused, tiled and row flux
+    // kernels) are instead chosen by timing them at the start of the
+    // run, or taken from the tuning cache (see SVSolver::autotune())
+    bool autotune;
+
+    // Layout of the solution state. Interleaved storage is only built
+    // with MORGFLOW_INTERLEAVED_STATE defined.
+    enum class StateStorage {
+      separate,
+      interleaved
+    } state_storage;
+
+    // Storage of the bed slope and Manning's n fields. Half precision
+    // is only built with MORGFLOW_HALF_CONSTANTS defined.
+    enum class ConstantStorage {
+      full,
+      half
+    } constant_storage;
+
+    // Floating point types of the solver (see Precision.hpp)
+    enum class Precision {
+      single_precision,
+      double_precision,
+      mixed_precision
+    } precision;
+
+    // Elementary functions used by the SV kernels (see MathProfile.hpp)
+    enum class MathProfile {
+      exact,
+      fast
+    } math_profile;
+
+    // Run the simulation with each math profile in turn and compare
+    // the depths at the end, rather than running it once. The
+    // comparison fails if the depths differ anywhere by more than
+    // the tolerance.
+    bool compare_math_profiles;
+    double math_profile_tolerance;
+
+    // Treatment of the friction source term: explicit, limited so as
+    // not to reverse the flow, or point-implicit over the time step
+    enum class Friction {
+      explicit_friction,
+      implicit_friction
+    } friction;
+
+    SolverParameters(GlobalConfig* gconf);
+  };
   
 protected:
 
@@ -90,6 +191,7 @@ protected:
   std::shared_ptr<DeviceParameters> device_params_;
   std::shared_ptr<RunParameters> run_params_;
   std::shared_ptr<TimestepParameters> dt_params_;
+  std::shared_ptr<SolverParameters> solver_params_;
 
   std::map<std::string, std::shared_ptr<TimeSeries<float>>> time_series_;
   // std::map<std::string, std::shared_ptr<RasterField<float>>> raster_fields_;
@@ -199,6 +301,22 @@ public:
     return *dt_params_;
   }
 
+  const SolverParameters& get_solver_parameters(void)
+  {
+    if (!solver_params_) {
+      solver_params_ = std::make_shared<SolverParameters>(this);
+    }
+    return *solver_params_;
+  }
+
+  // Override the configured math profile for the solvers created from
+  // now on, as when comparing the profiles
+  void select_math_profile(const SolverParameters::MathProfile& profile)
+  {
+    get_solver_parameters();
+    solver_params_->math_profile = profile;
+  }
+
   const std::shared_ptr<TimeSeries<float>>
   get_time_series_ptr(const std::shared_ptr<sycl::queue>& queue,
 		      const std::string& name)
@@ -0,0 +1,750 @@
+/***********************************************************************
+ * HostBackend.hpp
+ *
+ * The part of SYCL that morgflow uses, implemented directly on host
+ * memory for builds with MORGFLOW_HOST_BACKEND defined (see sycl.hpp)
+ *
+ * There is no runtime underneath. A buffer is a block of host memory
+ * and an accessor is a pointer into it; USM allocations are host
+ * memory too. A command group is run as soon as it is submitted, so
+ * the queue is always in order and there are no dependencies to
+ * track. Kernels are called with each item of their range in turn,
+ * shared among OpenMP threads when the build uses OpenMP. The kernel
+ * functors themselves are the ones the SYCL build uses.
+ *
+ * Work-groups run their work-items one after another, so a kernel
+ * that synchronises its work-group on a barrier cannot run on the
+ * host. GlobalConfig refuses the tiled kernels in host builds.
+ ***********************************************************************/
+
+#ifndef HostBackend_hpp
+#define HostBackend_hpp
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace sycl
+{
+  using half = _Float16;
+
+  class exception : public std::runtime_error
+  {
+  public:
+    exception(const std::string& what) : std::runtime_error(what) {}
+  };
+
+  namespace access
+  {
+    enum class mode { read, write, read_write, discard_write,
+		      discard_read_write, atomic };
+    enum class target { global_buffer, constant_buffer, local,
+			host_buffer };
+    enum class placeholder { false_t, true_t };
+    enum class fence_space { local_space, global_space,
+			     global_and_local };
+  }
+
+  namespace detail
+  {
+    template<int D>
+    class Index
+    {
+    protected:
+
+      std::array<size_t, D> v_;
+
+    public:
+
+      Index(void) : v_{} {}
+
+      template<typename... I,
+	       typename = std::enable_if_t<sizeof...(I) == D>>
+      Index(I... i) : v_{{ static_cast<size_t>(i)... }} {}
+
+      size_t get(int d) const { return v_[d]; }
+      size_t operator[](int d) const { return v_[d]; }
+      size_t& operator[](int d) { return v_[d]; }
+    };
+  }
+
+  template<int D = 1>
+  class range : public detail::Index<D>
+  {
+  public:
+
+    using detail::Index<D>::Index;
+
+    size_t size(void) const
+    {
+      size_t n = 1;
+      for (int d = 0; d < D; ++d) n *= this->v_[d];
+      return n;
+    }
+  };
+
+  template<int D = 1>
+  class id : public detail::Index<D>
+  {
+  public:
+
+    using detail::Index<D>::Index;
+
+    template<int E = D, typename = std::enable_if_t<E == 1>>
+    operator size_t(void) const { return this->v_[0]; }
+  };
+
+  template<int D = 1>
+  class item
+  {
+  private:
+
+    id<D> id_;
+    range<D> range_;
+
+  public:
+
+    item(const id<D>& i, const range<D>& r) : id_(i), range_(r) {}
+
+    id<D> get_id(void) const { return id_; }
+    size_t get_id(int d) const { return id_[d]; }
+    size_t operator[](int d) const { return id_[d]; }
+    range<D> get_range(void) const { return range_; }
+    size_t get_range(int d) const { return range_[d]; }
+
+    size_t get_linear_id(void) const
+    {
+      size_t l = 0;
+      for (int d = 0; d < D; ++d) l = l * range_[d] + id_[d];
+      return l;
+    }
+
+    operator id<D>(void) const { return id_; }
+
+    template<int E = D, typename = std::enable_if_t<E == 1>>
+    operator size_t(void) const { return id_[0]; }
+  };
+
+  template<int D = 1>
+  class nd_range
+  {
+  private:
+
+    range<D> global_;
+    range<D> local_;
+
+  public:
+
+    nd_range(const range<D>& global, const range<D>& local)
+      : global_(global), local_(local)
+    {}
+
+    range<D> get_global_range(void) const { return global_; }
+    range<D> get_local_range(void) const { return local_; }
+
+    range<D> get_group_range(void) const
+    {
+      range<D> r;
+      for (int d = 0; d < D; ++d) r[d] = global_[d] / local_[d];
+      return r;
+    }
+  };
+
+  template<int D = 1>
+  class nd_item
+  {
+  private:
+
+    id<D> group_;
+    id<D> local_id_;
+    nd_range<D> range_;
+
+  public:
+
+    nd_item(const id<D>& group, const id<D>& local_id,
+	    const nd_range<D>& r)
+      : group_(group), local_id_(local_id), range_(r)
+    {}
+
+    size_t get_group(int d) const { return group_[d]; }
+    size_t get_local_id(int d) const { return local_id_[d]; }
+    size_t get_local_range(int d) const
+    {
+      return range_.get_local_range()[d];
+    }
+    size_t get_group_range(int d) const
+    {
+      return range_.get_group_range()[d];
+    }
+
+    size_t get_global_id(int d) const
+    {
+      return group_[d] * range_.get_local_range()[d] + local_id_[d];
+    }
+
+    size_t get_global_linear_id(void) const
+    {
+      size_t l = 0;
+      for (int d = 0; d < D; ++d) {
+	l = l * range_.get_global_range()[d] + get_global_id(d);
+      }
+      return l;
+    }
+
+    void barrier(access::fence_space = access::fence_space::global_and_local) const
+    {
+      std::cerr << "Work-group barriers are not available with the host backend"
+		<< std::endl;
+      std::abort();
+    }
+  };
+
+  class handler;
+
+  template<typename T, int D>
+  class buffer;
+
+  template<typename T, int D = 1,
+	   access::mode Mode = access::mode::read_write,
+	   access::target Target = access::target::global_buffer,
+	   access::placeholder IsPlaceholder = access::placeholder::false_t>
+  class accessor
+  {
+  public:
+
+    using value_type = T;
+    using reference = std::conditional_t<Mode == access::mode::read,
+					 const T&, T&>;
+
+  private:
+
+    T* data_;
+    size_t count_;
+
+    // Local memory belongs to the accessor rather than to a buffer
+    std::shared_ptr<T> local_;
+
+  public:
+
+    accessor(void) : data_(nullptr), count_(0), local_() {}
+
+    accessor(T* data, size_t count)
+      : data_(data), count_(count), local_()
+    {}
+
+    accessor(buffer<T,D>& b);
+
+    accessor(buffer<T,D>& b, handler&) : accessor(b) {}
+
+    accessor(const range<D>& r, handler&)
+      : data_(nullptr), count_(r.size()),
+	local_(new T[r.size()], std::default_delete<T[]>())
+    {
+      data_ = local_.get();
+    }
+
+    reference operator[](size_t i) const { return data_[i]; }
+
+    T* get_pointer(void) const { return data_; }
+    size_t get_count(void) const { return count_; }
+    size_t size(void) const { return count_; }
+    range<D> get_range(void) const { return range<D>(count_); }
+  };
+
+  template<typename T, int D = 1>
+  class buffer
+  {
+  private:
+
+    struct Storage
+    {
+      std::vector<T> data;
+      std::function<void(const std::vector<T>&)> write_back;
+
+      ~Storage(void)
+      {
+	if (write_back) write_back(data);
+      }
+    };
+
+    std::shared_ptr<Storage> storage_;
+
+  public:
+
+    buffer(const range<D>& r)
+      : storage_(std::make_shared<Storage>())
+    {
+      storage_->data.resize(r.size());
+    }
+
+    buffer(const T* host_data, const range<D>& r)
+      : storage_(std::make_shared<Storage>())
+    {
+      storage_->data.assign(host_data, host_data + r.size());
+    }
+
+    buffer(T* host_data, const range<D>& r)
+      : buffer(static_cast<const T*>(host_data), r)
+    {
+      set_final_data(host_data);
+    }
+
+    void set_final_data(std::nullptr_t = nullptr)
+    {
+      storage_->write_back = nullptr;
+    }
+
+    template<typename Iterator>
+    void set_final_data(Iterator out)
+    {
+      storage_->write_back = [out](const std::vector<T>& data) {
+	std::copy(data.begin(), data.end(), out);
+      };
+    }
+
+    size_t get_count(void) const { return storage_->data.size(); }
+    size_t size(void) const { return storage_->data.size(); }
+    range<D> get_range(void) const { return range<D>(get_count()); }
+
+    T* data(void) const { return storage_->data.data(); }
+
+    template<access::mode Mode = access::mode::read_write,
+	     access::target Target = access::target::global_buffer>
+    accessor<T, D, Mode, Target> get_access(handler&)
+    {
+      return accessor<T, D, Mode, Target>(data(), get_count());
+    }
+
+    template<access::mode Mode>
+    accessor<T, D, Mode, access::target::host_buffer> get_access(void)
+    {
+      return accessor<T, D, Mode, access::target::host_buffer>(data(),
+							     get_count());
+    }
+
+    accessor<T, D, access::mode::read_write, access::target::host_buffer>
+    get_host_access(void)
+    {
+      return get_access<access::mode::read_write>();
+    }
+  };
+
+  template<typename T, int D, access::mode Mode, access::target Target,
+	   access::placeholder IsPlaceholder>
+  accessor<T, D, Mode, Target, IsPlaceholder>::accessor(buffer<T,D>& b)
+    : data_(b.data()), count_(b.get_count()), local_()
+  {}
+
+  template<typename T = void>
+  struct maximum
+  {
+    static constexpr T identity = std::numeric_limits<T>::lowest();
+
+    T operator()(const T& a, const T& b) const { return (a < b) ? b : a; }
+  };
+
+  namespace detail
+  {
+    template<typename T, typename Op>
+    struct Reduction
+    {
+      T* result;
+      Op op;
+    };
+
+    template<typename T, typename Op>
+    class Reducer
+    {
+    private:
+
+      T value_;
+      Op op_;
+
+    public:
+
+      Reducer(const Op& op) : value_(Op::identity), op_(op) {}
+
+      void combine(const T& v) { value_ = op_(value_, v); }
+
+      const T& value(void) const { return value_; }
+    };
+  }
+
+  template<typename T, int D, access::mode Mode, access::target Target,
+	   access::placeholder IsPlaceholder, typename Op>
+  detail::Reduction<T, Op>
+  reduction(const accessor<T, D, Mode, Target, IsPlaceholder>& acc, Op op)
+  {
+    return detail::Reduction<T, Op>{ acc.get_pointer(), op };
+  }
+
+  class event
+  {
+  public:
+
+    void wait(void) {}
+  };
+
+  class handler
+  {
+  private:
+
+    template<typename Kernel, typename... Reducers>
+    static void for_each_item(const range<1>& r, const Kernel& kernel,
+			      Reducers&... reducers)
+    {
+#pragma omp for
+      for (size_t i = 0; i < r[0]; ++i) {
+	kernel(item<1>(id<1>(i), r), reducers...);
+      }
+    }
+
+    template<typename Kernel, typename... Reducers>
+    static void for_each_item(const range<2>& r, const Kernel& kernel,
+			      Reducers&... reducers)
+    {
+#pragma omp for collapse(2)
+      for (size_t j = 0; j < r[0]; ++j) {
+	for (size_t i = 0; i < r[1]; ++i) {
+	  kernel(item<2>(id<2>(j, i), r), reducers...);
+	}
+      }
+    }
+
+    template<typename Kernel, typename... Reducers>
+    static void for_each_item(const nd_range<1>& r, const Kernel& kernel,
+			      Reducers&... reducers)
+    {
+      range<1> groups = r.get_group_range();
+      range<1> local = r.get_local_range();
+#pragma omp for
+      for (size_t g = 0; g < groups[0]; ++g) {
+	for (size_t l = 0; l < local[0]; ++l) {
+	  kernel(nd_item<1>(id<1>(g), id<1>(l), r), reducers...);
+	}
+      }
+    }
+
+    template<typename Kernel, typename... Reducers>
+    static void for_each_item(const nd_range<2>& r, const Kernel& kernel,
+			      Reducers&... reducers)
+    {
+      range<2> groups = r.get_group_range();
+      range<2> local = r.get_local_range();
+#pragma omp for collapse(2)
+      for (size_t gj = 0; gj < groups[0]; ++gj) {
+	for (size_t gi = 0; gi < groups[1]; ++gi) {
+	  for (size_t lj = 0; lj < local[0]; ++lj) {
+	    for (size_t li = 0; li < local[1]; ++li) {
+	      kernel(nd_item<2>(id<2>(gj, gi), id<2>(lj, li), r),
+		     reducers...);
+	    }
+	  }
+	}
+      }
+    }
+
+  public:
+
+    template<typename Range, typename Kernel>
+    void parallel_for(const Range& r, const Kernel& kernel)
+    {
+#pragma omp parallel
+      for_each_item(r, kernel);
+    }
+
+    template<typename Range, typename T, typename Op, typename Kernel>
+    void parallel_for(const Range& r,
+		      const detail::Reduction<T, Op>& reduction,
+		      const Kernel& kernel)
+    {
+#pragma omp parallel
+      {
+	detail::Reducer<T, Op> reducer(reduction.op);
+	for_each_item(r, kernel, reducer);
+#pragma omp critical
+	*reduction.result = reduction.op(*reduction.result, reducer.value());
+      }
+    }
+
+    template<typename Kernel>
+    void single_task(const Kernel& kernel)
+    {
+      kernel();
+    }
+
+    template<typename T, int D, access::mode Mode, access::target Target,
+	     access::placeholder IsPlaceholder>
+    void fill(const accessor<T, D, Mode, Target, IsPlaceholder>& dest,
+	      const T& value)
+    {
+      std::fill(dest.get_pointer(), dest.get_pointer() + dest.get_count(),
+		value);
+    }
+
+    template<typename T, int D, access::mode Mode, access::target Target,
+	     access::placeholder IsPlaceholder>
+    void copy(const accessor<T, D, Mode, Target, IsPlaceholder>& src,
+	      T* dest)
+    {
+      std::copy(src.get_pointer(), src.get_pointer() + src.get_count(), dest);
+    }
+
+    template<typename T, int D, access::mode Mode, access::target Target,
+	     access::placeholder IsPlaceholder>
+    void copy(const T* src,
+	      const accessor<T, D, Mode, Target, IsPlaceholder>& dest)
+    {
+      std::copy(src, src + dest.get_count(), dest.get_pointer());
+    }
+
+    template<typename T, int D,
+	     access::mode SrcMode, access::target SrcTarget,
+	     access::placeholder SrcPlaceholder,
+	     access::mode DestMode, access::target DestTarget,
+	     access::placeholder DestPlaceholder>
+    void copy(const accessor<T, D, SrcMode, SrcTarget, SrcPlaceholder>& src,
+	      const accessor<T, D, DestMode, DestTarget, DestPlaceholder>& dest)
+    {
+      std::copy(src.get_pointer(), src.get_pointer() + src.get_count(),
+		dest.get_pointer());
+    }
+
+    template<typename Accessor>
+    void require(const Accessor&) {}
+
+    void depends_on(const event&) {}
+  };
+
+  namespace info
+  {
+    namespace device
+    {
+      struct name { using return_type = std::string; };
+      struct vendor { using return_type = std::string; };
+      struct max_work_group_size { using return_type = size_t; };
+    }
+
+    namespace platform
+    {
+      struct name { using return_type = std::string; };
+      struct vendor { using return_type = std::string; };
+    }
+  }
+
+  class platform;
+
+  class device
+  {
+  public:
+
+    template<typename Param>
+    typename Param::return_type get_info(void) const
+    {
+      if constexpr (std::is_same_v<Param, info::device::max_work_group_size>) {
+	return std::numeric_limits<size_t>::max();
+      } else if constexpr (std::is_same_v<Param, info::device::name>) {
+	return "Host";
+      } else {
+	return "morgflow";
+      }
+    }
+
+    bool is_cpu(void) const { return true; }
+    bool is_gpu(void) const { return false; }
+    bool is_accelerator(void) const { return false; }
+    bool is_host(void) const { return true; }
+
+    platform get_platform(void) const;
+  };
+
+  class platform
+  {
+  public:
+
+    static std::vector<platform> get_platforms(void)
+    {
+      return std::vector<platform>(1);
+    }
+
+    std::vector<device> get_devices(void) const
+    {
+      return std::vector<device>(1);
+    }
+
+    template<typename Param>
+    typename Param::return_type get_info(void) const
+    {
+      if constexpr (std::is_same_v<Param, info::platform::name>) {
+	return "Host";
+      } else {
+	return "morgflow";
+      }
+    }
+  };
+
+  inline platform device::get_platform(void) const
+  {
+    return platform();
+  }
+
+  namespace property
+  {
+    namespace queue
+    {
+      struct in_order {};
+    }
+  }
+
+  class property_list
+  {
+  public:
+
+    template<typename... Properties>
+    property_list(Properties...) {}
+  };
+
+  class queue
+  {
+  private:
+
+    device device_;
+
+    // Copies of a queue are the same queue
+    std::shared_ptr<int> identity_;
+
+  public:
+
+    queue(void) : device_(), identity_(std::make_shared<int>()) {}
+
+    queue(const device& d, const property_list& = property_list())
+      : device_(d), identity_(std::make_shared<int>())
+    {}
+
+    bool operator==(const queue& q) const { return identity_ == q.identity_; }
+    bool operator!=(const queue& q) const { return identity_ != q.identity_; }
+
+    template<typename CommandGroup>
+    event submit(const CommandGroup& command_group)
+    {
+      handler cgh;
+      command_group(cgh);
+      return event();
+    }
+
+    event memcpy(void* dest, const void* src, size_t bytes)
+    {
+      std::memcpy(dest, src, bytes);
+      return event();
+    }
+
+    template<typename T>
+    event fill(T* ptr, const T& value, size_t count)
+    {
+      std::fill(ptr, ptr + count, value);
+      return event();
+    }
+
+    void wait(void) {}
+    void wait_and_throw(void) {}
+
+    bool is_in_order(void) const { return true; }
+
+    device get_device(void) const { return device_; }
+  };
+
+  // USM allocations are all host memory
+  namespace usm
+  {
+    enum class alloc { host, device, shared, unknown };
+  }
+
+  template<typename T>
+  T* malloc_device(size_t count, const queue&)
+  {
+    return static_cast<T*>(std::malloc(std::max(count, (size_t) 1) * sizeof(T)));
+  }
+
+  template<typename T>
+  T* malloc_shared(size_t count, const queue& q)
+  {
+    return malloc_device<T>(count, q);
+  }
+
+  inline void free(void* ptr, const queue&)
+  {
+    std::free(ptr);
+  }
+
+  using std::fabs;
+  using std::fmax;
+  using std::fmin;
+  using std::sqrt;
+  using std::pow;
+  using std::log;
+  using std::cbrt;
+
+  template<typename T>
+  T min(const T& a, const T& b)
+  {
+    return (b < a) ? b : a;
+  }
+
+  template<typename T>
+  T max(const T& a, const T& b)
+  {
+    return (a < b) ? b : a;
+  }
+
+  template<typename T>
+  T sign(const T& x)
+  {
+    return (x > T(0)) ? T(1) : ((x < T(0)) ? T(-1) : T(0));
+  }
+
+  template<typename T>
+  T clamp(const T& x, const T& lo, const T& hi)
+  {
+    return fmin(fmax(x, lo), hi);
+  }
+
+  template<typename T>
+  T mix(const T& x, const T& y, const T& a)
+  {
+    return x + (y - x) * a;
+  }
+
+  template<typename T>
+  T smoothstep(const T& edge0, const T& edge1, const T& x)
+  {
+    T t = clamp((x - edge0) / (edge1 - edge0), T(0), T(1));
+    return t * t * (T(3) - T(2) * t);
+  }
+
+  namespace native
+  {
+    template<typename T>
+    T sqrt(const T& x)
+    {
+      return std::sqrt(x);
+    }
+
+    template<typename T>
+    T recip(const T& x)
+    {
+      return T(1) / x;
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,74 @@
+/***********************************************************************
+ * KernelTuningCache.hpp
+ *
+ * The kernel variants chosen by autotuning (see SVSolver::autotune()),
+ * kept in a file so that later runs on the same device and mesh can
+ * use them without tuning again. Each line of the file is a key, a
+ * tab and the choice for that key.
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef KernelTuningCache_hpp
+#define KernelTuningCache_hpp
+
+#include <map>
+#include <string>
+#include <fstream>
+#include <optional>
+
+#include "Config.hpp"
+
+class KernelTuningCache
+{
+private:
+
+  stdfs::path path_;
+  std::map<std::string,std::string> choices_;
+
+public:
+
+  // Read the cache from path, if it exists
+  KernelTuningCache(const stdfs::path& path)
+    : path_(path),
+      choices_()
+  {
+    std::ifstream in(path_.native());
+    std::string line;
+    while (std::getline(in, line)) {
+      size_t tab = line.find('\t');
+      if (tab == std::string::npos) continue;
+      choices_[line.substr(0, tab)] = line.substr(tab + 1);
+    }
+  }
+
+  std::optional<std::string> get(const std::string& key) const
+  {
+    auto it = choices_.find(key);
+    if (it == choices_.end()) return std::nullopt;
+    return it->second;
+  }
+
+  // Set the choice for key and write the cache, creating its
+  // directory if needed
+  void set(const std::string& key, const std::string& choice)
+  {
+    choices_[key] = choice;
+
+    if (path_.has_parent_path()) {
+      stdfs::create_directories(path_.parent_path());
+    }
+    std::ofstream out(path_.native());
+    if (not out) {
+      std::cerr << "Could not write kernel tuning cache: " << path_
+		<< std::endl;
+      throw std::runtime_error("Could not write kernel tuning cache");
+    }
+    for (auto&& kv : choices_) {
+      out << kv.first << '\t' << kv.second << std::endl;
+    }
+  }
+
+};
+
+#endif
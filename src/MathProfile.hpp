@@ -0,0 +1,116 @@
+/***********************************************************************
+ * MathProfile.hpp
+ *
+ * Elementary functions used in the innermost code of the SV kernels.
+ * ExactMath uses the full-precision built-in functions throughout.
+ * FastMath trades a few ulp for speed: sqrt() and division by a
+ * divisor use the native:: functions, whose accuracy is implementation
+ * defined, the 4/3 power of the friction term is formed as x∛x in
+ * place of pow(), and a Divisor holds the reciprocal of its value so
+ * that every division by it becomes a multiplication. The native::
+ * functions are only defined for float, so in double FastMath differs
+ * from ExactMath only in the latter two.
+ *
+ * The difference a profile makes to the results can be measured with
+ * the "compare" math profile (see mflow.cpp).
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef MathProfile_hpp
+#define MathProfile_hpp
+
+#include <type_traits>
+
+struct ExactMath
+{
+  // Divides by a value used repeatedly, such as a cell size
+  template<typename T>
+  class Divisor
+  {
+  private:
+
+    T d_;
+
+  public:
+
+    Divisor(const T& d) : d_(d) {}
+
+    T operator()(const T& x) const { return x / d_; }
+  };
+
+  template<typename T>
+  static T sqrt(const T& x)
+  {
+    return sycl::sqrt(x);
+  }
+
+  // x^(4/3), for x ≥ 0
+  template<typename T>
+  static T pow4_3(const T& x)
+  {
+    return sycl::pow(x, (T) 1.333333f);
+  }
+
+  // Whether a and b have the same sign, as given by sycl::sign()
+  template<typename T>
+  static bool same_sign(const T& a, const T& b)
+  {
+    return (sycl::sign(a) == sycl::sign(b));
+  }
+};
+
+struct FastMath
+{
+  template<typename T>
+  class Divisor
+  {
+  private:
+
+    T r_;
+
+  public:
+
+    Divisor(const T& d) : r_(recip(d)) {}
+
+    T operator()(const T& x) const { return x * r_; }
+  };
+
+  template<typename T>
+  static T recip(const T& x)
+  {
+    if constexpr (std::is_same<T,float>::value) {
+      return sycl::native::recip(x);
+    } else {
+      return (T) 1.0 / x;
+    }
+  }
+
+  template<typename T>
+  static T sqrt(const T& x)
+  {
+    if constexpr (std::is_same<T,float>::value) {
+      return sycl::native::sqrt(x);
+    } else {
+      return sycl::sqrt(x);
+    }
+  }
+
+  template<typename T>
+  static T pow4_3(const T& x)
+  {
+    return x * sycl::cbrt(x);
+  }
+
+  // As ExactMath::same_sign(), except that two zeros, or two values
+  // whose product underflows, are taken to differ in sign. Where used,
+  // that only leaves a friction term already zero, or negligible,
+  // unchanged.
+  template<typename T>
+  static bool same_sign(const T& a, const T& b)
+  {
+    return (a * b > (T) 0.0f);
+  }
+};
+
+#endif
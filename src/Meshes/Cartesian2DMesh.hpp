@@ -125,6 +125,22 @@ public:
   {
     return this->object_count<FieldMapping::Vertex>();
   }
+
+  // Faces normal to the x-direction are numbered first, row by row,
+  // followed by the faces normal to the y-direction.
+  inline size_t x_face_count(void) const
+  {
+    return (ncells_[0] + 1) * ncells_[1];
+  }
+
+  // Size of the (x, y) index block of the faces normal to the
+  // d-direction
+  IndexType get_face_index_size(const size_t& d) const
+  {
+    IndexType size = ncells_;
+    size[d] += 1;
+    return size;
+  }
   
   CoordType cell_centre(const IndexType& i) const
   {
@@ -0,0 +1,88 @@
+/***********************************************************************
+ * Meshes/Cartesian2DMeshRegion.hpp
+ *
+ * The part of the cells of a Cartesian mesh that a kernel is launched
+ * over. Kernels whose stencil reaches W cells from the centre must
+ * check for the edge of the mesh, but only within W cells of it. They
+ * can instead be launched twice: over the Interior, where every
+ * neighbour exists and the checks can be compiled out, and over the
+ * Perimeter, the ring W cells wide around the edge, which keeps them.
+ *
+ * The 2D range of a region is arranged so that operator() of a kernel
+ * can find its cell from the item without knowing which region it
+ * was launched over (see cell_index()).
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef Meshes_Cartesian2DMeshRegion_hpp
+#define Meshes_Cartesian2DMeshRegion_hpp
+
+#include "Cartesian2DMesh.hpp"
+
+enum class Cartesian2DMeshRegionType {
+  All,
+  Interior,
+  Perimeter
+};
+
+template<Cartesian2DMeshRegionType R = Cartesian2DMeshRegionType::All,
+	 size_t W = 1>
+struct Cartesian2DMeshRegion
+{
+  // Whether every cell within W cells of a cell in the region exists
+  static constexpr bool is_interior =
+    (R == Cartesian2DMeshRegionType::Interior);
+
+  // Whether the mesh is big enough to have an interior. If not, the
+  // whole mesh should be calculated as the All region instead.
+  static bool has_interior(const Cartesian2DMesh& mesh)
+  {
+    auto ncells = mesh.get_cell_index_size();
+    return (ncells[0] > 2 * W and ncells[1] > 2 * W);
+  }
+
+  // Dimension 0 is the row (y-index) and dimension 1 the column
+  // (x-index) of the cell, offset by W in the interior. The perimeter
+  // is a single row.
+  static sycl::range<2> get_range(const Cartesian2DMesh& mesh)
+  {
+    auto ncells = mesh.get_cell_index_size();
+    if constexpr (R == Cartesian2DMeshRegionType::Interior) {
+      return sycl::range<2>(ncells[1] - 2 * W, ncells[0] - 2 * W);
+    } else if constexpr (R == Cartesian2DMeshRegionType::Perimeter) {
+      return sycl::range<2>(1, 2 * W * (ncells[0] + ncells[1] - 2 * W));
+    } else {
+      return sycl::range<2>(ncells[1], ncells[0]);
+    }
+  }
+
+  // The (x, y) index of the cell of an item on a mesh of nx × ny cells
+  static std::array<size_t,2> cell_index(const sycl::item<2>& item,
+					 const size_t& nx,
+					 const size_t& ny)
+  {
+    if constexpr (R == Cartesian2DMeshRegionType::Interior) {
+      return { item.get_id(1) + W, item.get_id(0) + W };
+    } else if constexpr (R == Cartesian2DMeshRegionType::Perimeter) {
+      // The W rows at the bottom, the W rows at the top, then the
+      // W cells at each end of the rows in between
+      size_t k = item.get_id(1);
+      size_t edge_rows = W * nx;
+      if (k < edge_rows) {
+	return { k % nx, k / nx };
+      }
+      k -= edge_rows;
+      if (k < edge_rows) {
+	return { k % nx, ny - W + k / nx };
+      }
+      k -= edge_rows;
+      size_t c = k % (2 * W);
+      return { (c < W ? c : nx - 2 * W + c), W + k / (2 * W) };
+    } else {
+      return { item.get_id(1), item.get_id(0) };
+    }
+  }
+};
+
+#endif
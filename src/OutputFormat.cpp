@@ -48,3 +48,7 @@ create_output_format(const Config& config)
 template
 std::shared_ptr<OutputFormat<float,Cartesian2DMesh> >
 create_output_format(const Config& config);
+
+template
+std::shared_ptr<OutputFormat<double,Cartesian2DMesh> >
+create_output_format(const Config& config);
@@ -147,7 +147,8 @@ public:
 
 template<typename T,
   typename MeshDefn,
-  FieldMapping FM>
+  FieldMapping FM,
+  typename FT = T>
 class IsNaNOutputFunction : public FieldMappedOutputFunction<T,MeshDefn,FM>
 {
 public:
@@ -155,24 +156,22 @@ public:
   using ValueType = T;
   using MeshType = MeshDefn;
   static const FieldMapping FieldMappingType = FM;
-  using FieldType = Field<T,MeshDefn,FM>;
+  using FieldType = Field<FT,MeshDefn,FM>;
 
   std::string name_;
   FieldType* f_ptr_;
+  std::vector<FT> f_values_;
   
   IsNaNOutputFunction(const std::string& name,
 		      FieldType* f)
     : FieldMappedOutputFunction<ValueType, MeshType, FM>(),
       name_(name),
-      f_ptr_(f)
-  {
-    f_ptr_->move_to_host();
-  }
+      f_ptr_(f),
+      f_values_(f->host_copy())
+  {}
 
   virtual ~IsNaNOutputFunction(void)
-  {
-    f_ptr_->move_to_device();
-  }
+  {}
 
   virtual std::string name(void) const
   {
@@ -186,7 +185,7 @@ public:
   
   virtual std::vector<ValueType> output_values(size_t i) const
   {
-    return { ValueType(std::isnan(f_ptr_->host_vector().at(i)) ? 0 : 1) };
+    return { ValueType(std::isnan(f_values_.at(i)) ? 0 : 1) };
   }
   
 };
@@ -206,18 +205,26 @@ public:
   using FieldType = Field<T,MeshDefn,FM>;
 
   std::string name_;
-  std::array<FieldType,sizeof...(Ts)> fields_;
+  std::shared_ptr<MeshDefn> mesh_;
+
+  // The values of each field, copied to the host and cast to T
+  std::array<std::vector<T>,sizeof...(Ts)> values_;
+
+  template<typename S>
+  static std::vector<T> host_values(const Field<S,MeshDefn,FM>& f)
+  {
+    std::vector<S> src = f.host_copy();
+    return std::vector<T>(src.begin(), src.end());
+  }
 
   MultiFieldOutputFunction(const std::string& name,
 			   const Field<Ts,MeshDefn,FM>& ...args)
     : FieldMappedOutputFunction<ValueType,MeshType,FM>(),
       name_(name),
-      fields_({field_cast<Field<Ts,MeshDefn,FM>,
-	  Field<T,MeshDefn,FM>>(args.name(), args)...})
+      mesh_(),
+      values_({host_values(args)...})
   {
-    for (size_t i = 0; i < (sizeof...(Ts)); ++i) {
-      fields_.at(i).move_to_host();
-    }
+    ((mesh_ = args.mesh_definition()), ...);
   }
   
   virtual ~MultiFieldOutputFunction(void)
@@ -231,14 +238,14 @@ public:
   
   virtual const std::shared_ptr<MeshDefn> mesh_definition(void) const
   {
-    return fields_.at(0).mesh_definition();
+    return mesh_;
   }
   
   virtual std::vector<ValueType> output_values(size_t j) const
   {
     std::vector<ValueType> v;
     for (size_t i = 0; i < (sizeof...(Ts)); ++i) {
-      v.push_back(fields_.at(i).host_vector().at(j));
+      v.push_back(values_.at(i).at(j));
     }
     return v;
   }
@@ -258,14 +265,16 @@ public:
   static const FieldMapping FieldMappingType = FM;
   using FieldType = Field<T,MeshDefn,FM>;
 
-  std::shared_ptr<FieldType> f_ptr_;
+  std::string name_;
+  std::shared_ptr<MeshDefn> mesh_;
+  std::vector<T> values_;
   
   SingleFieldOutputFunction(const FieldType& f)
     : FieldMappedOutputFunction<ValueType, MeshType, FM>(),
-      f_ptr_(std::make_shared<FieldType>(f))
-  {
-    f_ptr_->move_to_host();
-  }
+      name_(f.name()),
+      mesh_(f.mesh_definition()),
+      values_(f.host_copy())
+  {}
 
   virtual ~SingleFieldOutputFunction(void)
   {
@@ -273,17 +282,17 @@ public:
 
   virtual std::string name(void) const
   {
-    return f_ptr_->name();
+    return name_;
   }
   
   virtual const std::shared_ptr<MeshDefn> mesh_definition(void) const
   {
-    return f_ptr_->mesh_definition();
+    return mesh_;
   }
   
   virtual std::vector<ValueType> output_values(size_t i) const
   {
-    return { f_ptr_->host_vector().at(i) };
+    return { values_.at(i) };
   }
   
 };
@@ -301,18 +310,16 @@ public:
   using DepthFieldType = Field<T,MeshDefn,FM>;
 
   DepthFieldType* h_ptr_;
+  std::vector<T> h_values_;
   
   DepthOutputFunction(DepthFieldType* h)
     : FieldMappedOutputFunction<ValueType, MeshType, FM>(),
-      h_ptr_(h)
-  {
-    h_ptr_->move_to_host();
-  }
+      h_ptr_(h),
+      h_values_(h->host_copy())
+  {}
 
   virtual ~DepthOutputFunction(void)
-  {
-    h_ptr_->move_to_device();
-  }
+  {}
 
   virtual std::string name(void) const
   {
@@ -326,7 +333,7 @@ public:
   
   virtual std::vector<ValueType> output_values(size_t i) const
   {
-    return { h_ptr_->host_vector().at(i) };
+    return { h_values_.at(i) };
   }
   
 };
@@ -399,20 +406,17 @@ public:
 
   VelFieldType* u_ptr_;
   VelFieldType* v_ptr_;
+  std::vector<T> u_values_;
+  std::vector<T> v_values_;
   
   ComponentVelocityOutputFunction(VelFieldType* u, VelFieldType* v)
     : FieldMappedOutputFunction<ValueType, MeshType, FM>(),
-      u_ptr_(u), v_ptr_(v)
-  {
-    u_ptr_->move_to_host();
-    v_ptr_->move_to_host();
-  }
+      u_ptr_(u), v_ptr_(v),
+      u_values_(u->host_copy()), v_values_(v->host_copy())
+  {}
 
   virtual ~ComponentVelocityOutputFunction(void)
-  {
-    u_ptr_->move_to_device();
-    v_ptr_->move_to_device();
-  }
+  {}
 
   virtual std::string name(void) const
   {
@@ -427,8 +431,8 @@ public:
   virtual std::vector<ValueType> output_values(size_t i) const
   {
     return {
-      u_ptr_->host_vector().at(i),
-      v_ptr_->host_vector().at(i)
+      u_values_.at(i),
+      v_values_.at(i)
     };
   }
   
@@ -449,21 +453,18 @@ public:
 
   BdyFieldVectorType* Q_in_;
   BdyFieldVectorType* h_in_;
+  std::array<std::vector<T>,4> values_;
   
   DebugBoundaryOutputFunction(BdyFieldVectorType* Q_in,
 			      BdyFieldVectorType* h_in)
     : FieldMappedOutputFunction<ValueType, MeshType, FM>(),
-      Q_in_(Q_in), h_in_(h_in)
-  {
-    Q_in_->move_to_host();
-    h_in_->move_to_host();
-  }
+      Q_in_(Q_in), h_in_(h_in),
+      values_({ Q_in->at(0).host_copy(), Q_in->at(1).host_copy(),
+		h_in->at(0).host_copy(), h_in->at(1).host_copy() })
+  {}
 
   virtual ~DebugBoundaryOutputFunction(void)
-  {
-    Q_in_->move_to_device();
-    h_in_->move_to_device();
-  }
+  {}
 
   virtual std::string name(void) const
   {
@@ -478,10 +479,10 @@ public:
   virtual std::vector<ValueType> output_values(size_t i) const
   {
     return {
-      Q_in_->at(0).host_vector().at(i),
-      Q_in_->at(1).host_vector().at(i),
-      h_in_->at(0).host_vector().at(i),
-      h_in_->at(1).host_vector().at(i)
+      values_[0].at(i),
+      values_[1].at(i),
+      values_[2].at(i),
+      values_[3].at(i)
     };
   }
   
@@ -502,21 +503,19 @@ public:
 
   SlopeFieldVectorType* dUdx_;
   SlopeFieldVectorType* dUdy_;
+  std::array<std::vector<T>,6> values_;
   
   DebugSlopeOutputFunction(SlopeFieldVectorType* dUdx,
 			   SlopeFieldVectorType* dUdy)
     : FieldMappedOutputFunction<ValueType, MeshType, FM>(),
-      dUdx_(dUdx), dUdy_(dUdy)
-  {
-    dUdx_->move_to_host();
-    dUdy_->move_to_host();
-  }
+      dUdx_(dUdx), dUdy_(dUdy),
+      values_({ dUdx->at(0).host_copy(), dUdx->at(1).host_copy(),
+		dUdx->at(2).host_copy(), dUdy->at(0).host_copy(),
+		dUdy->at(1).host_copy(), dUdy->at(2).host_copy() })
+  {}
 
   virtual ~DebugSlopeOutputFunction(void)
-  {
-    dUdx_->move_to_device();
-    dUdy_->move_to_device();
-  }
+  {}
 
   virtual std::string name(void) const
   {
@@ -531,12 +530,12 @@ public:
   virtual std::vector<ValueType> output_values(size_t i) const
   {
     return {
-      dUdx_->at(0).host_vector().at(i),
-      dUdx_->at(1).host_vector().at(i),
-      dUdx_->at(2).host_vector().at(i),
-      dUdy_->at(0).host_vector().at(i),
-      dUdy_->at(1).host_vector().at(i),
-      dUdy_->at(2).host_vector().at(i)
+      values_[0].at(i),
+      values_[1].at(i),
+      values_[2].at(i),
+      values_[3].at(i),
+      values_[4].at(i),
+      values_[5].at(i)
     };
   }
   
@@ -555,18 +554,17 @@ public:
   using FluxFieldVectorType = FieldVector<T,MeshDefn,FM,4>;
 
   FluxFieldVectorType* flux_;
+  std::array<std::vector<T>,4> values_;
   
   DebugFluxOutputFunction(FluxFieldVectorType* flux)
     : FieldMappedOutputFunction<ValueType, MeshType, FM>(),
-      flux_(flux)
-  {
-    flux_->move_to_host();
-  }
+      flux_(flux),
+      values_({ flux->at(0).host_copy(), flux->at(1).host_copy(),
+		flux->at(2).host_copy(), flux->at(3).host_copy() })
+  {}
 
   virtual ~DebugFluxOutputFunction(void)
-  {
-    flux_->move_to_device();
-  }
+  {}
 
   virtual std::string name(void) const
   {
@@ -581,10 +579,10 @@ public:
   virtual std::vector<ValueType> output_values(size_t i) const
   {
     return {
-      flux_->at(0).host_vector().at(i),
-      flux_->at(1).host_vector().at(i),
-      flux_->at(2).host_vector().at(i),
-      flux_->at(3).host_vector().at(i)
+      values_[0].at(i),
+      values_[1].at(i),
+      values_[2].at(i),
+      values_[3].at(i)
     };
   }
   
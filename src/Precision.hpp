@@ -0,0 +1,36 @@
+/***********************************************************************
+ * Precision.hpp
+ *
+ * Floating point types used by a solver. ValueType is the type of the
+ * solution state, the fluxes and the other fields derived from it;
+ * BedType is the type of the bed level and of the water levels formed
+ * from it. In mixed precision the bed and water levels are held in
+ * double, as a depth of a few millimetres over a bed several hundred
+ * metres above datum is poorly resolved by their sum in float, while
+ * everything else remains in float.
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef Precision_hpp
+#define Precision_hpp
+
+struct SinglePrecision
+{
+  using ValueType = float;
+  using BedType = float;
+};
+
+struct DoublePrecision
+{
+  using ValueType = double;
+  using BedType = double;
+};
+
+struct MixedPrecision
+{
+  using ValueType = float;
+  using BedType = double;
+};
+
+#endif
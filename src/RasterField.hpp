@@ -215,9 +215,9 @@ public:
 
   void bind(sycl::handler& cgh)
   {
-    cgh.require(values_ro_);
-    cgh.require(ncells_ro_);
-    cgh.require(geotrans_ro_);
+    DataArray<T>::require(cgh, values_ro_);
+    DataArray<size_t>::require(cgh, ncells_ro_);
+    DataArray<double>::require(cgh, geotrans_ro_);
   }
 
   T inspect_point(const std::array<double,2>& loc,
@@ -18,64 +18,269 @@
 #include "SpatialDerivatives/MinmodSpatialDerivative.hpp"
 #include "FluxFunctions/SVFluxFunction.hpp"
 #include "TemporalDerivatives/SVTemporalDerivative.hpp"
+#include "TemporalDerivatives/FusedSVTemporalDerivative.hpp"
 #include "ControlNumbers/SVControlNumber.hpp"
+#include "ActiveTileSet.hpp"
+#include "Precision.hpp"
+#include "MathProfile.hpp"
+#include "KernelTuningCache.hpp"
 
+#include <chrono>
+#include <limits>
+#include <sstream>
+
+// StateStorage selects the memory layout of the solution state and of
+// the temporaries derived from it (slopes, fluxes, dU/dt).
+// ConstantType is the type in which the bed slopes and Manning's n
+// are stored; the kernels widen them to ValueType when they are read.
+// The bed level itself is stored as BedType, as the precision of a
+// half would be too coarse for absolute levels. Precision gives
+// ValueType and BedType (see Precision.hpp).
+template<FieldStorage StateStorage = FieldStorage::Separate,
+	 typename ConstantType = float,
+	 typename Precision = SinglePrecision>
 class SVSolver
 {
 public:
 
-  using ValueType = float;
+  using ValueType = typename Precision::ValueType;
+  using BedType = typename Precision::BedType;
   using MeshType = Cartesian2DMesh;
-  using SolutionState = CellFieldVector<ValueType, MeshType, 3>;
+  using SolutionState = CellFieldVector<ValueType, MeshType, 3, StateStorage>;
+
+  // The next Runge-Kutta stage, formed by update_ddt_and_combine() in
+  // the same pass as dU/dt (see TemporalDerivative.hpp)
+  using StageCombinationType = StageCombination<ValueType, MeshType, FieldMapping::Cell, 3, StateStorage>;
+  using SlopeVector = CellFieldVector<ValueType, MeshType, 3, StateStorage>;
+  using FluxVector = FaceFieldVector<ValueType, MeshType, 3, StateStorage>;
+  using FaceBedVector = FaceFieldVector<BedType, MeshType, 3>;
   using SpatialDerivativeType = SpatialDerivative<ValueType,
 						  MeshType,
 						  FieldMapping::Cell,
-						  FieldMapping::Cell,3>;
+						  FieldMapping::Cell,3,
+						  StateStorage>;
   using FluxFunctionType = FluxFunction<ValueType,
 					MeshType,
 					FieldMapping::Cell,
 					FieldMapping::Face,
-					3, 4>;
+					3, 3, StateStorage,
+					ConstantType, BedType>;
   using TemporalDerivativeType = TemporalDerivative<ValueType,
 						    MeshType,
-						    FieldMapping::Cell,3>;
+						    FieldMapping::Cell,3,
+						    StateStorage,
+						    ConstantType, BedType>;
+  using FusedTemporalDerivativeType = FusedSVTemporalDerivative<ValueType,
+								MeshType,
+								FieldMapping::Cell,3,
+								StateStorage,
+								ConstantType, BedType>;
+
+  using CellControlNumberType = SVCellControlNumber<ValueType>;
 
   static const FieldMapping BCFieldMappingType = FieldMapping::Cell;
 
   using ValueField = Field<ValueType,MeshType,FieldMapping::Cell>;
+  using BedField = Field<BedType,MeshType,FieldMapping::Cell>;
+  using ConstantField = Field<ConstantType,MeshType,FieldMapping::Cell>;
   
 private:
 
   std::shared_ptr<sycl::queue> queue_;
   std::shared_ptr<MeshType> mesh_;
+
+  // Tiles of the mesh that need calculating. Null unless active tiles
+  // are selected, in which case the whole mesh is calculated.
+  std::shared_ptr<ActiveTileSet<MeshType>> active_tiles_;
+
+  // Whether the SV kernels use FastMath rather than ExactMath (see
+  // MathProfile.hpp)
+  bool fast_math_;
+
+  // Whether the friction source term is point-implicit over the time
+  // step rather than explicit (see
+  // TemporalDerivatives/SV/Kernels/SVCellTemporalDerivative.hpp)
+  bool implicit_friction_;
+
+  // Variant of the kernels used by update_ddt(), which the solver
+  // parameters give and autotune() may replace
+  struct KernelChoice
+  {
+    bool fused;
+    // Work-group tile size of the tiled stencil kernels; zero for the
+    // untiled kernels
+    std::array<size_t,2> tile_size;
+    // Calculate the fluxes with the row kernel (see
+    // FluxFunctions/SV/Kernels/Cartesian2DMeshCell2FaceRowKernel.hpp)
+    bool row_flux;
+  };
+
+  KernelChoice kernels_;
+
+  // Number of timed calls of update_ddt() for each choice of kernels
+  // when autotuning
+  static const size_t TuningRepeats = 5;
+
+  static std::string kernel_choice_name(const KernelChoice& choice)
+  {
+    if (choice.fused) return "fused";
+    if (choice.tile_size[0] > 0) {
+      return ("tiled " + std::to_string(choice.tile_size[0]) + " "
+	      + std::to_string(choice.tile_size[1]));
+    }
+    return (choice.row_flux ? "untiled row" : "untiled");
+  }
+
+  static std::optional<KernelChoice> parse_kernel_choice(const std::string& name)
+  {
+    std::istringstream in(name);
+    std::string kind;
+    in >> kind;
+    if (kind == "fused") {
+      return KernelChoice({ true, { 0, 0 }, false });
+    } else if (kind == "tiled") {
+      std::array<size_t,2> tile_size;
+      if (in >> tile_size[0] >> tile_size[1]) {
+	return KernelChoice({ false, tile_size, false });
+      }
+    } else if (kind == "untiled") {
+      std::string row;
+      in >> row;
+      return KernelChoice({ false, { 0, 0 }, (row == "row") });
+    }
+    return std::nullopt;
+  }
+  
   std::shared_ptr<SpatialDerivativeType> spatial_derivative_;
   std::shared_ptr<FluxFunctionType> flux_function_;
   std::shared_ptr<TemporalDerivativeType> temporal_derivative_;
 
+  // Single-pass replacement for the three operators above. Null
+  // unless the fused kernel is selected.
+  std::shared_ptr<FusedTemporalDerivativeType> fused_derivative_;
+
   // Constants
-  CellFieldVector<ValueType, MeshType, 3> zbed_;
-  CellFieldVector<ValueType, MeshType, 4> manning_n_;
+  CellFieldVector<BedType, MeshType, 1> zbed_;
+  CellFieldVector<ConstantType, MeshType, 2> dzbed_;
+  // Usually uniform, in which case it is folded (see
+  // FieldVectors/FoldableFieldVector.hpp)
+  CellFoldableFieldVector<ConstantType, MeshType, 4> manning_n_;
+
+  // Bed at the faces, calculated once from zbed_ and dzbed_ (not
+  // allocated when using the fused kernel, which works it out itself)
+  std::shared_ptr<FaceBedVector> face_bed_;
 
-  // Temporaries
-  CellFieldVector<ValueType, MeshType, 3> dUdx_;
-  CellFieldVector<ValueType, MeshType, 3> dUdy_;
-  FaceFieldVector<ValueType, MeshType, 4> flux_;
+  // Temporaries (not allocated when using the fused kernel)
+  std::shared_ptr<SlopeVector> dUdx_;
+  std::shared_ptr<SlopeVector> dUdy_;
+  std::shared_ptr<FluxVector> flux_;
   
-  // Boundary Conditions
-  FieldVector<ValueType, MeshType, BCFieldMappingType, 2> Q_in_;
-  FieldVector<ValueType, MeshType, BCFieldMappingType, 2> h_in_;
+  // Boundary Conditions. Each stays folded (to zero inflow and no
+  // imposed depth) until a boundary condition asks for its fields.
+  FoldableFieldVector<ValueType, MeshType, BCFieldMappingType, 2> Q_in_;
+  FoldableFieldVector<ValueType, MeshType, BCFieldMappingType, 2> h_in_;
+
+  std::shared_ptr<ActiveTileSet<MeshType>> create_active_tiles(void) const
+  {
+    size_t tile_size =
+      GlobalConfig::instance().get_solver_parameters().active_tile_size;
+    if (tile_size == 0) return nullptr;
+    return std::make_shared<ActiveTileSet<MeshType>>(queue_, mesh_, tile_size);
+  }
+
+  // Create the operators used by update_ddt() for a choice of kernels,
+  // and the temporaries they need, which are freed for the fused
+  // kernel. The bed must be final, as the bed at the faces is
+  // calculated from it here. Quiet while autotuning.
+  void select_kernels(const KernelChoice& choice, bool verbose = true)
+  {
+    kernels_ = choice;
+    if (choice.fused) {
+      if (verbose) {
+	std::cout << "Using fused single-pass temporal derivative kernel."
+		  << std::endl;
+      }
+      fused_derivative_ = std::make_shared<FusedSVTemporalDerivative<ValueType,MeshType,FieldMapping::Cell,3,StateStorage,ConstantType,BedType>>(active_tiles_, fast_math_, implicit_friction_);
+      spatial_derivative_.reset();
+      flux_function_.reset();
+      face_bed_.reset();
+      dUdx_.reset();
+      dUdy_.reset();
+      flux_.reset();
+      return;
+    }
+
+    fused_derivative_.reset();
+    spatial_derivative_ = std::make_shared<MinmodSpatialDerivative<ValueType,MeshType,FieldMapping::Cell,FieldMapping::Cell,3,StateStorage>>(choice.tile_size, active_tiles_);
+    flux_function_ = std::make_shared<SVFluxFunction<ValueType,MeshType,FieldMapping::Cell,FieldMapping::Face,3,3,StateStorage,ConstantType,BedType>>(choice.tile_size, active_tiles_, fast_math_, choice.row_flux);
+    if (not face_bed_) {
+      face_bed_ = std::make_shared<FaceBedVector>
+	(queue_, std::array<std::string,3>({ "zb_m", "zb_p", "zb_w" }),
+	 mesh_, true, 0.0f);
+      dUdx_ = std::make_shared<SlopeVector>
+	(queue_, std::array<std::string,3>({ "dh⁄dx", "du⁄dx", "dv⁄dx" }),
+	 mesh_, true, 0.0f);
+      dUdy_ = std::make_shared<SlopeVector>
+	(queue_, std::array<std::string,3>({ "dh⁄dy", "du⁄dy", "dv⁄dy" }),
+	 mesh_, true, 0.0f);
+      flux_ = std::make_shared<FluxVector>
+	(queue_, std::array<std::string,3>({ "mass", "xmom", "ymom" }),
+	 mesh_, true, 0.0f);
+      flux_function_->calculate_face_bed(zbed_, dzbed_, *face_bed_);
+    }
+  }
+
+  // Key of the tuning cache for this device, mesh and solver, and the
+  // queue and time step settings that change how the kernels overlap
+  std::string tuning_key(void) const
+  {
+    auto& gconf = GlobalConfig::instance();
+    auto ncells = mesh_->get_cell_index_size();
+    return (queue_->get_device().template get_info<sycl::info::device::name>()
+	    + " | " + std::to_string(ncells[0]) + " x " + std::to_string(ncells[1])
+	    + " | " + std::to_string(sizeof(ValueType))
+	    + std::to_string(sizeof(BedType)) + std::to_string(sizeof(ConstantType))
+	    + (StateStorage == FieldStorage::Interleaved ? " interleaved" : " separate")
+	    + (fast_math_ ? " fast" : " exact")
+	    + " | active tiles " + std::to_string(gconf.get_solver_parameters().active_tile_size)
+	    + (gconf.get_device_parameters().in_order_queue ? " | in order" : " | out of order")
+	    + " | sync " + std::to_string(gconf.get_timestep_parameters().steps_per_sync));
+  }
+
+  // Generate a constant field from the configuration. The field
+  // generators work in ValueType, so a narrower field is generated
+  // through a full-precision copy.
+  void generate_constant_field(ConstantField& field)
+  {
+    if constexpr (std::is_same<ConstantType, ValueType>::value) {
+      generate_field<ValueType, MeshType, FieldMapping::Cell>(field);
+    } else {
+      ValueField full =
+	field_cast<ConstantField,ValueField>(field.name(), field);
+      generate_field<ValueType, MeshType, FieldMapping::Cell>(full);
+      field_cast_to<ValueField,ConstantField>(full, field);
+    }
+  }
 
 public:
 
   SVSolver(std::shared_ptr<sycl::queue>& queue)
     : queue_(queue),
       mesh_(std::make_shared<MeshType>(GlobalConfig::instance().configuration().get_child("mesh"))),
-      spatial_derivative_(std::make_shared<MinmodSpatialDerivative<ValueType,MeshType,FieldMapping::Cell,FieldMapping::Cell,3>>()),
-      flux_function_(std::make_shared<SVFluxFunction<ValueType,MeshType,FieldMapping::Cell,FieldMapping::Face,3,4>>()),
-      temporal_derivative_(std::make_shared<SVTemporalDerivative<ValueType,MeshType,FieldMapping::Cell,3>>()),
-      zbed_(queue, { "zb", "dzb⁄dx", "dzb⁄dy" }, mesh_, true, 0.0f),
+      active_tiles_(create_active_tiles()),
+      fast_math_(GlobalConfig::instance().get_solver_parameters().math_profile == GlobalConfig::SolverParameters::MathProfile::fast),
+      implicit_friction_(GlobalConfig::instance().get_solver_parameters().friction == GlobalConfig::SolverParameters::Friction::implicit_friction),
+      kernels_({ GlobalConfig::instance().get_solver_parameters().fused_kernel,
+		 GlobalConfig::instance().get_solver_parameters().tile_size,
+		 GlobalConfig::instance().get_solver_parameters().cpu_flux_kernel and queue->get_device().is_cpu() }),
+      spatial_derivative_(),
+      flux_function_(),
+      temporal_derivative_(std::make_shared<SVTemporalDerivative<ValueType,MeshType,FieldMapping::Cell,3,StateStorage,ConstantType,BedType>>(active_tiles_, fast_math_, implicit_friction_)),
+      fused_derivative_(),
+      zbed_(queue, std::array<std::string,1>({ "zb" }), mesh_, true, 0.0f),
+      dzbed_(queue, { "dzb⁄dx", "dzb⁄dy" }, mesh_, true, 0.0f),
       manning_n_(queue, {"manning_n0", "manning_h0",
-			 "manning_n1", "manning_h1"}, mesh_, true, 0.0f),
+			 "manning_n1", "manning_h1"}, mesh_, 0.0f),
       /*
       zbed_({
 	generate_field<ValueType,MeshType,FieldMapping::Cell>(queue, "zb",
@@ -100,11 +305,9 @@ public:
 							      mesh_, 0.1f)
       }),
       */
-      dUdx_(queue, { "dh⁄dx", "du⁄dx", "dv⁄dx" }, mesh_, true, 0.0f),
-      dUdy_(queue, { "dh⁄dy", "du⁄dy", "dv⁄dy" }, mesh_, true, 0.0f),
-      flux_(queue, { "mass", "xmom", "ymom", "wall" }, mesh_, true, 0.0f),
-      Q_in_(queue, { "Q_in_0", "Q_in_1" }, mesh_, true, 0.0f),
-      h_in_(queue, { "h_in_0", "h_in_1" }, mesh_, true, -1.0f)
+      face_bed_(), dUdx_(), dUdy_(), flux_(),
+      Q_in_(queue, { "Q_in_0", "Q_in_1" }, mesh_, 0.0f),
+      h_in_(queue, { "h_in_0", "h_in_1" }, mesh_, -1.0f)
       /*
       dUdx_({
 	CellField<ValueType, MeshType>(queue, "dh⁄dx", mesh_, true, 0.0f),
@@ -137,11 +340,13 @@ public:
       */
   {
     // Read user-specified values for zb, n, etc.
-    generate_field<ValueType, MeshType, FieldMapping::Cell>(zbed_.at(0));
-    generate_field<ValueType, MeshType, FieldMapping::Cell>(manning_n_.at(0));
-    generate_field<ValueType, MeshType, FieldMapping::Cell>(manning_n_.at(1));
-    generate_field<ValueType, MeshType, FieldMapping::Cell>(manning_n_.at(2));
-    generate_field<ValueType, MeshType, FieldMapping::Cell>(manning_n_.at(3));
+    generate_field<BedType, MeshType, FieldMapping::Cell>(zbed_.at(0));
+    auto& manning_n = manning_n_.fields();
+    generate_constant_field(manning_n.at(0));
+    generate_constant_field(manning_n.at(1));
+    generate_constant_field(manning_n.at(2));
+    generate_constant_field(manning_n.at(3));
+    manning_n_.fold();
 
     // Deactivate user-specified areas of the mesh.
     const Config& gconf = GlobalConfig::instance().configuration();
@@ -149,7 +354,17 @@ public:
     for (auto it = deact_range.first; it != deact_range.second; ++it) {
       MeshSelection<MeshType,FieldMapping::Cell> sel(queue, mesh_, it->second);
       std::cout << "Deactivating " << sel.size() << " cells." << std::endl;
-      set_field_nan<ValueField>(sel, zbed_.at(0));
+      set_field_nan<BedField>(sel, zbed_.at(0));
+    }
+
+    select_kernels(kernels_);
+
+    if (fast_math_) {
+      std::cout << "Using fast math profile." << std::endl;
+    }
+
+    if (implicit_friction_) {
+      std::cout << "Using point-implicit friction." << std::endl;
     }
 
     std::cout << "Initialised solver." << std::endl;
@@ -179,7 +394,7 @@ public:
     } else if (stage_specified) {
       // Get bed levels and stage (as doubles)
       using DoubleField = Field<double,MeshType,FieldMapping::Cell>;
-      DoubleField zb2 = field_cast<ValueField,DoubleField>("zb2", zbed_.at(0));
+      DoubleField zb2 = field_cast<BedField,DoubleField>("zb2", zbed_.at(0));
       DoubleField st2
 	= generate_field<double,MeshType,FieldMapping::Cell>(queue_, "stage",
 							     mesh_, 0.0f);
@@ -276,7 +491,8 @@ public:
   
   SolutionState initial_state(void)
   {
-    SolutionState init(queue_, { "h", "u", "v" }, mesh_, true, 0.0f);
+    CellFieldVector<ValueType, MeshType, 3> init(queue_, { "h", "u", "v" },
+						 mesh_, true, 0.0f);
     
     const Config& gconf = GlobalConfig::instance().configuration();
     bool depth_specified = (gconf.count("h") > 0);
@@ -291,7 +507,7 @@ public:
       // Get bed levels and stage (as doubles)
       using DoubleField = Field<double,MeshType,FieldMapping::Cell>;
       DoubleField zb2
-	= field_cast<ValueField, DoubleField>("zb2", zbed_.at(0));
+	= field_cast<BedField, DoubleField>("zb2", zbed_.at(0));
       DoubleField st2(queue_, "stage", mesh_, true, 0.0f);
       generate_field<double,MeshType,FieldMapping::Cell>(st2);
       
@@ -316,7 +532,8 @@ public:
     SolutionState init = { h, uv.at(0), uv.at(1) };
     std::cout << "d" << std::endl;
     */
-    return init;
+    // Repack into the solver's storage layout if needed
+    return SolutionState(std::move(init));
   }
 
   void write_check_files(void)
@@ -344,24 +561,27 @@ public:
     std::optional<Config> ac_conf = gc.write_check_file("active");
     if (ac_conf) {
       auto format = std::make_shared<CSVOutputFormat<ValueType,MeshType>>(Config(), "wkt", ", ", check_file_path);
-      std::shared_ptr<OutputFunction<ValueType,MeshType>> ac_func = std::make_shared<IsNaNOutputFunction<ValueType,MeshType,FieldMapping::Cell>>("active cells", &(zbed_.at(0)));
+      std::shared_ptr<OutputFunction<ValueType,MeshType>> ac_func = std::make_shared<IsNaNOutputFunction<ValueType,MeshType,FieldMapping::Cell,BedType>>("active cells", &(zbed_.at(0)));
       format->output(ac_func, "init");
     }
     std::optional<Config> zbn_conf = gc.write_check_file("cell constants");
     if (zbn_conf) {
+      // Written from a copy so as not to unfold Manning's n
+      CellFieldVector<ConstantType, MeshType, 4> manning_n =
+	manning_n_.expanded();
       auto format = std::make_shared<CSVOutputFormat<ValueType,MeshType>>(Config(), "wkt", ", ", check_file_path);
       std::shared_ptr<OutputFunction<ValueType,MeshType>> zbn_func =
 	std::make_shared<MultiFieldOutputFunction<ValueType,
 						  MeshType,
 						  FieldMapping::Cell,
-						  ValueType, ValueType,
-						  ValueType,
-						  ValueType, ValueType,
-						  ValueType, ValueType>>
+						  BedType,
+						  ConstantType, ConstantType,
+						  ConstantType, ConstantType,
+						  ConstantType, ConstantType>>
 	("cell constants",
-	 zbed_.at(0), zbed_.at(1), zbed_.at(2),
-	 manning_n_.at(0), manning_n_.at(1),
-	 manning_n_.at(2), manning_n_.at(3));
+	 zbed_.at(0), dzbed_.at(0), dzbed_.at(1),
+	 manning_n.at(0), manning_n.at(1),
+	 manning_n.at(2), manning_n.at(3));
       format->output(zbn_func, "const");
     }
   }
@@ -377,32 +597,38 @@ public:
     FixedValueFieldFunctor<ValueType, CoordType> qfunc(0.0f);
     FixedValueFieldFunctor<ValueType, CoordType> hfunc(-1.0f);
     
-    modify_field<FieldModifierType,
-		 SetOperation<ValueType>,
-		 FixedValueFieldFunctor<ValueType, CoordType>>
-      (fm, qfunc, 0.0, Q_in_.at(0));
-    modify_field<FieldModifierType,
-		 SetOperation<ValueType>,
-		 FixedValueFieldFunctor<ValueType, CoordType>>
-      (fm, qfunc, 0.0, Q_in_.at(1));
-    modify_field<FieldModifierType,
-		 SetOperation<ValueType>,
-		 FixedValueFieldFunctor<ValueType, CoordType>>
-      (fm, hfunc, 0.0, h_in_.at(0));
-    modify_field<FieldModifierType,
-		 SetOperation<ValueType>,
-		 FixedValueFieldFunctor<ValueType, CoordType>>
-      (fm, hfunc, 0.0, h_in_.at(1));
+    // Folded vectors already hold the cleared values
+    if (not Q_in_.is_folded()) {
+      modify_field<FieldModifierType,
+		   SetOperation<ValueType>,
+		   FixedValueFieldFunctor<ValueType, CoordType>>
+	(fm, qfunc, 0.0, Q_in_.fields().at(0));
+      modify_field<FieldModifierType,
+		   SetOperation<ValueType>,
+		   FixedValueFieldFunctor<ValueType, CoordType>>
+	(fm, qfunc, 0.0, Q_in_.fields().at(1));
+    }
+    if (not h_in_.is_folded()) {
+      modify_field<FieldModifierType,
+		   SetOperation<ValueType>,
+		   FixedValueFieldFunctor<ValueType, CoordType>>
+	(fm, hfunc, 0.0, h_in_.fields().at(0));
+      modify_field<FieldModifierType,
+		   SetOperation<ValueType>,
+		   FixedValueFieldFunctor<ValueType, CoordType>>
+	(fm, hfunc, 0.0, h_in_.fields().at(1));
+    }
   }
   
+  // The boundary inflow fields, which are unfolded from here on
   FieldVector<ValueType, MeshType, BCFieldMappingType, 2>& Q_in(void)
   {
-    return Q_in_;
+    return Q_in_.fields();
   }
 
   FieldVector<ValueType, MeshType, BCFieldMappingType, 2>& h_in(void)
   {
-    return h_in_;
+    return h_in_.fields();
   }
 
   std::shared_ptr<OutputFunction<ValueType,MeshType>>
@@ -410,46 +636,332 @@ public:
 		      SolutionState& U)
   {
     if (name == "depth") {
-      return std::make_shared<DepthOutputFunction<ValueType, MeshType, FieldMapping::Cell>>(&(U.at(0)));
+      return std::make_shared<MultiFieldOutputFunction<ValueType, MeshType, FieldMapping::Cell,ValueType>>("depth", U.component(0));
     } else if (name == "stage") {
-      return std::make_shared<MultiFieldOutputFunction<ValueType, MeshType, FieldMapping::Cell,ValueType,ValueType,ValueType>>("stage", field_sum<ValueField,ValueField,ValueField>("stage", zbed_.at(0), U.at(0)), zbed_.at(0), U.at(0));
+      const ValueField& h = U.component(0);
+      return std::make_shared<MultiFieldOutputFunction<ValueType, MeshType, FieldMapping::Cell,BedType,BedType,ValueType>>("stage", field_sum<BedField,ValueField,BedField>("stage", zbed_.at(0), h), zbed_.at(0), h);
     } else if (name == "component velocity") {
-      return std::make_shared<MultiFieldOutputFunction<ValueType, MeshType, FieldMapping::Cell,ValueType,ValueType>>("component velocity", U.at(1), U.at(2));
+      return std::make_shared<MultiFieldOutputFunction<ValueType, MeshType, FieldMapping::Cell,ValueType,ValueType>>("component velocity", U.component(1), U.component(2));
       // return std::make_shared<ComponentVelocityOutputFunction<ValueType, MeshType, FieldMapping::Cell>>(&(U.at(1)), &(U.at(2)));
     } else if (name == "huv") {
-      return std::make_shared<MultiFieldOutputFunction<ValueType, MeshType, FieldMapping::Cell,ValueType,ValueType,ValueType>>("huv", U.at(0), U.at(1), U.at(2));
+      return std::make_shared<MultiFieldOutputFunction<ValueType, MeshType, FieldMapping::Cell,ValueType,ValueType,ValueType>>("huv", U.component(0), U.component(1), U.component(2));
     } else if (name == "active cells") {
-      return std::make_shared<IsNaNOutputFunction<ValueType,MeshType,FieldMapping::Cell>>("active cells", &(zbed_.at(0)));
+      return std::make_shared<IsNaNOutputFunction<ValueType,MeshType,FieldMapping::Cell,BedType>>("active cells", &(zbed_.at(0)));
     } else if (name == "debug boundaries") {
-      return std::make_shared<DebugBoundaryOutputFunction<ValueType,MeshType,FieldMapping::Cell>>(&Q_in_, &h_in_);
-    } else if (name == "debug slopes") {
-      return std::make_shared<DebugSlopeOutputFunction<ValueType,MeshType,FieldMapping::Cell>>(&dUdx_, &dUdy_);
-    } else if (name == "debug fluxes") {
-      return std::make_shared<DebugFluxOutputFunction<ValueType,MeshType,FieldMapping::Face>>(&flux_);
+      return std::make_shared<DebugBoundaryOutputFunction<ValueType,MeshType,FieldMapping::Cell>>(&Q_in(), &h_in());
+    } else if (name == "debug slopes" or name == "debug fluxes") {
+      if (fused_derivative_) {
+	std::cerr << "Output function \"" << name << "\" is not available "
+		  << "with the fused kernel." << std::endl;
+	throw std::runtime_error("Output function not available with fused kernel");
+      }
+      if (name == "debug slopes") {
+	return std::make_shared<MultiFieldOutputFunction<ValueType,MeshType,FieldMapping::Cell,ValueType,ValueType,ValueType,ValueType,ValueType,ValueType>>("debug slopes", dUdx_->component(0), dUdx_->component(1), dUdx_->component(2), dUdy_->component(0), dUdy_->component(1), dUdy_->component(2));
+      } else {
+	return std::make_shared<MultiFieldOutputFunction<ValueType,MeshType,FieldMapping::Face,ValueType,ValueType,ValueType>>("debug fluxes", flux_->component(0), flux_->component(1), flux_->component(2));
+      }
     } else {
       std::cerr << "Unknown output function type: " << name << std::endl;
       throw std::runtime_error("Unknown output function type");
     }
   }
 
+  // Calculate dU/dt at a stage (a fraction of the time step held by
+  // the clock) through the current step
   void update_ddt(const SolutionState& U,
 		  SolutionState& dUdt,
-		  const double& time_now, const double& timestep,
+		  const StepClock<ValueType>& clock, const double& stage,
 		  const double& bdy_t0, const double& bdy_t1)
   {
-    spatial_derivative_->calculate(U, dUdx_, dUdy_);
-    flux_function_->calculate(U, zbed_, manning_n_, dUdx_, dUdy_, flux_);
-    temporal_derivative_->calculate(U, zbed_, manning_n_, Q_in_, h_in_,
-				    flux_, dUdt, time_now, timestep, bdy_t0, bdy_t1);
+    if (fused_derivative_) {
+      fused_derivative_->calculate(U, zbed_, dzbed_, manning_n_, Q_in_, h_in_,
+				   dUdt, clock, stage, bdy_t0, bdy_t1);
+    } else {
+      spatial_derivative_->calculate(U, *dUdx_, *dUdy_);
+      flux_function_->calculate(U, *face_bed_, *dUdx_, *dUdy_, *flux_);
+      temporal_derivative_->calculate(U, *face_bed_, dzbed_, manning_n_, Q_in_, h_in_,
+				      *flux_, dUdt, clock, stage,
+				      bdy_t0, bdy_t1);
+    }
+  }
+
+  // As update_ddt(), then overwrite U with the state of next_stage.
+  // This is only supported without the fused kernel (see
+  // supports_stage_combination()).
+  void update_ddt_and_combine(SolutionState& U,
+			      SolutionState& dUdt,
+			      const StepClock<ValueType>& clock, const double& stage,
+			      const double& bdy_t0, const double& bdy_t1,
+			      const StageCombinationType& next_stage)
+  {
+    if (fused_derivative_) {
+      throw std::logic_error("Stage combination not supported by the fused kernel");
+    }
+    spatial_derivative_->calculate(U, *dUdx_, *dUdy_);
+    flux_function_->calculate(U, *face_bed_, *dUdx_, *dUdy_, *flux_);
+    temporal_derivative_->calculate_and_combine(U, *face_bed_, dzbed_, manning_n_,
+						Q_in_, h_in_, *flux_, dUdt,
+						clock, stage, bdy_t0, bdy_t1,
+						next_stage);
+  }
+
+  // As update_ddt(), but add dU/dt to the register dQ of a low-storage
+  // Runge-Kutta stage, dQ = A dQ + Δt dU/dt. This is also only
+  // supported without the fused kernel.
+  void update_ddt_and_accumulate(const SolutionState& U,
+				 SolutionState& dQ,
+				 const StepClock<ValueType>& clock, const double& stage,
+				 const double& bdy_t0, const double& bdy_t1,
+				 const double& A)
+  {
+    if (fused_derivative_) {
+      throw std::logic_error("Stage accumulation not supported by the fused kernel");
+    }
+    spatial_derivative_->calculate(U, *dUdx_, *dUdy_);
+    flux_function_->calculate(U, *face_bed_, *dUdx_, *dUdy_, *flux_);
+    temporal_derivative_->calculate_and_accumulate(U, *face_bed_, dzbed_, manning_n_,
+						   Q_in_, h_in_, *flux_, dQ,
+						   clock, stage, bdy_t0, bdy_t1, A);
+  }
+
+  // Whether update_ddt_and_combine() and update_ddt_and_accumulate()
+  // can be used. The fused kernel reads the state of neighbouring
+  // cells, so it cannot overwrite it in place, and only writes dU/dt.
+  bool supports_stage_combination(void) const
+  {
+    return not fused_derivative_;
   }
   
+  // Whether the solver can take local time steps (see
+  // TemporalSchemes/LocalTimestep.hpp). They need the active tiles,
+  // whose lists they restrict to the tiles changing at each sub-step,
+  // and the separate slope and flux temporaries.
+  bool supports_local_timesteps(void) const
+  {
+    return (active_tiles_ and not fused_derivative_);
+  }
+
+  // Choose the fastest kernels for update_ddt() by timing each variant
+  // on the state U: the untiled kernels, with and (on CPU devices)
+  // without the row flux kernel, the tiled kernels with several tile
+  // sizes and, if
+  // allow_fused, the fused kernel. The choice is kept in a cache in the
+  // check file directory, from which later runs on the same device and
+  // mesh take it without tuning again.
+  void autotune(const SolutionState& U, const StepClock<ValueType>& clock,
+		bool allow_fused)
+  {
+    KernelTuningCache cache(GlobalConfig::instance().get_check_file_path()
+			    / "kernel tuning");
+    std::string key = tuning_key();
+
+    std::optional<std::string> cached = cache.get(key);
+    if (cached) {
+      std::optional<KernelChoice> choice = parse_kernel_choice(*cached);
+      if (choice and (allow_fused or not choice->fused)) {
+	std::cout << "Using tuned kernels: " << *cached << std::endl;
+	select_kernels(*choice);
+	return;
+      }
+    }
+
+    std::vector<KernelChoice> candidates = {
+      { false, { 0, 0 }, false }
+    };
+    if (queue_->get_device().is_cpu()) {
+      candidates.push_back({ false, { 0, 0 }, true });
+    }
+#ifndef MORGFLOW_HOST_BACKEND
+    size_t max_group_size =
+      queue_->get_device().template get_info<sycl::info::device::max_work_group_size>();
+    for (auto&& tile_size : std::vector<std::array<size_t,2>>({ { 8, 8 }, { 16, 8 }, { 16, 16 }, { 32, 4 }, { 32, 8 }, { 64, 4 } })) {
+      if (tile_size[0] * tile_size[1] <= max_group_size) {
+	candidates.push_back({ false, tile_size, false });
+      }
+    }
+#endif
+    if (allow_fused) {
+      candidates.push_back({ true, { 0, 0 }, false });
+    }
+
+    // The boundary values are interpolated over a non-empty interval,
+    // so that the timed calls do the same arithmetic as in a step
+    SolutionState dUdt("", U, "_tuning");
+
+    DisplayTable<std::string, double>
+      results({ {20, "Kernels", "%|s|"},
+		{20, "Time per call (ms)", "%|.3f|"} });
+    std::cout << "   Tuning kernels for " << key << ":" << std::endl;
+    results.write_top_rule();
+    results.write_header_row();
+    results.write_mid_rule();
+    KernelChoice best = kernels_;
+    double best_time = std::numeric_limits<double>::infinity();
+    for (auto&& candidate : candidates) {
+      std::string name = kernel_choice_name(candidate);
+      try {
+	select_kernels(candidate, false);
+	update_ddt(U, dUdt, clock, 0.0, 0.0, 1.0);
+	queue_->wait_and_throw();
+
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < TuningRepeats; ++i) {
+	  update_ddt(U, dUdt, clock, 0.0, 0.0, 1.0);
+	}
+	queue_->wait_and_throw();
+	std::chrono::duration<double,std::milli> elapsed =
+	  std::chrono::steady_clock::now() - start;
+
+	double time = elapsed.count() / TuningRepeats;
+	results.write_data_row(name, time);
+	if (time < best_time) {
+	  best = candidate;
+	  best_time = time;
+	}
+      } catch (sycl::exception&) {
+	results.write_data_row(name, std::numeric_limits<double>::quiet_NaN());
+      }
+    }
+    results.write_bot_rule();
+
+    std::cout << "Using tuned kernels: " << kernel_choice_name(best)
+	      << std::endl;
+    select_kernels(best);
+    cache.set(key, kernel_choice_name(best));
+  }
+
+  // Choose the time step level of each tile for a local time stepping
+  // cycle of the length held by the clock
+  void update_timestep_levels(const SolutionState& U,
+			      const StepClock<ValueType>& clock,
+			      const double& courant_target,
+			      const size_t& max_level)
+  {
+    active_tiles_->update_levels(U, get_cell_control_number(1.0), clock,
+				 courant_target, max_level);
+  }
+
+  // Take a sub-step of a local time stepping cycle, updating U in
+  // place. acc accumulates the flux terms of each cell until the end
+  // of its step and must be zero at the start of the cycle.
+  void local_substep(SolutionState& U,
+		     SolutionState& acc,
+		     const StepClock<ValueType>& clock,
+		     const size_t& substep,
+		     const size_t& max_level,
+		     const double& bdy_t0, const double& bdy_t1)
+  {
+    active_tiles_->select_substep(substep);
+    
+    spatial_derivative_->calculate(U, *dUdx_, *dUdy_);
+    flux_function_->calculate(U, *face_bed_, *dUdx_, *dUdy_, *flux_);
+    if (fast_math_) {
+      local_substep_update<FastMath>(U, acc, clock, substep, max_level,
+				     bdy_t0, bdy_t1);
+    } else {
+      local_substep_update<ExactMath>(U, acc, clock, substep, max_level,
+				      bdy_t0, bdy_t1);
+    }
+
+    active_tiles_->select_active();
+  }
+
+  // Launch the cell update of local_substep() with math profile M
+  template<typename M>
+  void local_substep_update(SolutionState& U,
+			    SolutionState& acc,
+			    const StepClock<ValueType>& clock,
+			    const size_t& substep,
+			    const size_t& max_level,
+			    const double& bdy_t0, const double& bdy_t1)
+  {
+    queue_->submit([&] (sycl::handler& cgh) {
+      using Kernel = SVCartesian2DMeshCellLocalTimestepKernel<ValueType,
+							      StateStorage,
+							      ConstantType,
+							      BedType, M>;
+      auto kernel = Kernel(cgh, U, acc, *face_bed_, dzbed_, manning_n_,
+			   Q_in_, h_in_,
+			   *flux_, active_tiles_->get_level_map(cgh),
+			   clock, substep, max_level, bdy_t0, bdy_t1,
+			   implicit_friction_);
+      active_tiles_->parallel_for_cells(cgh, kernel);
+    });
+  }
+
   ValueType get_control_number(const SolutionState& U,
 			       const double& timestep)
   {
     return SVControlNumber<ValueType,
 			   MeshType,
 			   FieldMapping::Cell,
-			   3>().calculate(U, timestep);
+			   3, StateStorage>(active_tiles_).calculate(U, timestep);
+  }
+
+  // Per-cell control number for use within other kernels. With a
+  // time step of one this gives the control number per unit time step.
+  CellControlNumberType get_cell_control_number(const double& timestep) const
+  {
+    auto cell_size = mesh_->cell_size();
+    return CellControlNumberType(cell_size[0], cell_size[1], timestep);
+  }
+
+  // Launch an elementwise kernel, called with the id of a cell, over
+  // the cells whose state may change
+  template<typename Kernel>
+  void parallel_for_elements(sycl::handler& cgh, const Kernel& kernel) const
+  {
+    if (active_tiles_) {
+      active_tiles_->parallel_for_elements(cgh, kernel);
+    } else {
+      cgh.parallel_for(sycl::range<1>(mesh_->cell_count()), kernel);
+    }
+  }
+
+  // As above, for a kernel (called with the id of a cell and a
+  // reducer) that also combines a value into a reduction
+  template<typename Reduction, typename Kernel>
+  void parallel_for_elements(sycl::handler& cgh,
+			     Reduction reduction,
+			     const Kernel& kernel) const
+  {
+    if (active_tiles_) {
+      active_tiles_->parallel_for_elements(cgh, reduction, kernel);
+    } else {
+      cgh.parallel_for(sycl::range<1>(mesh_->cell_count()), reduction, kernel);
+    }
+  }
+
+  // Refresh the active tiles from the solution state and boundary
+  // inflows, either after an accepted step (new_step == true) or after
+  // the boundaries have been updated.
+  void update_active_tiles(const SolutionState& U, bool new_step)
+  {
+    if (active_tiles_) {
+      active_tiles_->update(U, Q_in_, h_in_, new_step);
+    }
+  }
+
+  // As above, after a step accepted or rejected on the device by the
+  // clock
+  void update_active_tiles(const SolutionState& U,
+			   const StepClock<ValueType>& clock)
+  {
+    if (active_tiles_) {
+      active_tiles_->update(U, Q_in_, h_in_, clock);
+    }
+  }
+
+  // Size the launches over the active tiles for up to the given number
+  // of further updates of them (see ActiveTileSet::bound_launches()).
+  // This waits for the device. Returns the number of tiles launched
+  // over, or zero without active tiles.
+  size_t bound_active_tiles(const size_t& updates)
+  {
+    if (active_tiles_) {
+      return active_tiles_->bound_launches(updates);
+    }
+    return 0;
   }
   
 };
@@ -13,7 +13,8 @@ template<typename T,
 	 typename MeshType,
 	 FieldMapping FromFM,
 	 FieldMapping ToFM,
-	 size_t N>
+	 size_t N,
+	 FieldStorage FS = FieldStorage::Separate>
 class SpatialDerivative
 {
 public:
@@ -24,9 +25,9 @@ public:
   virtual ~SpatialDerivative(void)
   {}
 
-  virtual void calculate(const FieldVector<T,MeshType,FromFM,N>& U,
-			 FieldVector<T,MeshType,ToFM,N>& dUdx,
-			 FieldVector<T,MeshType,ToFM,N>& dUdy) const = 0;
+  virtual void calculate(const FieldVector<T,MeshType,FromFM,N,FS>& U,
+			 FieldVector<T,MeshType,ToFM,N,FS>& dUdx,
+			 FieldVector<T,MeshType,ToFM,N,FS>& dUdy) const = 0;
   
 };
 
@@ -8,12 +8,13 @@
 #define SpatialDerivatives_Minmod_Cartesian2DMeshCell2Cell_hpp
 
 #include "Kernels/Cartesian2DMeshCell2CellKernel.hpp"
+#include "Kernels/Cartesian2DMeshCell2CellTiledKernel.hpp"
 
-template<typename T, size_t N>
+template<typename T, size_t N, FieldStorage FS>
 class MinmodSpatialDerivative<T, Cartesian2DMesh,
-			      FieldMapping::Cell, FieldMapping::Cell, N>
+			      FieldMapping::Cell, FieldMapping::Cell, N, FS>
   : public SpatialDerivative<T, Cartesian2DMesh,
-			     FieldMapping::Cell, FieldMapping::Cell, N>
+			     FieldMapping::Cell, FieldMapping::Cell, N, FS>
 {
 public:
 
@@ -24,26 +25,77 @@ public:
 private:
 
   T theta_;
+
+  // Work-group tile size (x, y) for the tiled kernel; zero to use the
+  // untiled kernel.
+  std::array<size_t,2> tile_size_;
+
+  // Tiles to calculate; null to calculate the whole mesh.
+  std::shared_ptr<ActiveTileSet<MeshType>> active_tiles_;
   
 public:
   
-  MinmodSpatialDerivative(void)
-    : SpatialDerivative<T, MeshType, FromFM, ToFM, N>(),
-      theta_(2.0)
+  MinmodSpatialDerivative(const std::array<size_t,2>& tile_size = { 0, 0 },
+			  const std::shared_ptr<ActiveTileSet<MeshType>>& active_tiles = nullptr)
+    : SpatialDerivative<T, MeshType, FromFM, ToFM, N, FS>(),
+      theta_(2.0),
+      tile_size_(tile_size),
+      active_tiles_(active_tiles)
   {}
 
   virtual ~MinmodSpatialDerivative(void)
   {}
 
-  virtual void calculate(const FieldVector<T,MeshType,FromFM,N>& U,
-			 FieldVector<T,MeshType,ToFM,N>& dUdx,
-			 FieldVector<T,MeshType,ToFM,N>& dUdy) const
+  virtual void calculate(const FieldVector<T,MeshType,FromFM,N,FS>& U,
+			 FieldVector<T,MeshType,ToFM,N,FS>& dUdx,
+			 FieldVector<T,MeshType,ToFM,N,FS>& dUdy) const
   {
     // Update dU/dx and dU/dy
-    U.at(0).queue().submit([&] (sycl::handler& cgh) {
-      auto kernel = MinmodCartesian2DMeshCell2CellSpatialDerivativeKernel<T,N>(cgh, U, dUdx, dUdy, theta_);
+    if (active_tiles_) {
+      U.queue().submit([&] (sycl::handler& cgh) {
+	using Kernel = MinmodCartesian2DMeshCell2CellSpatialDerivativeKernel<T,N,FS>;
+	auto kernel = Kernel(cgh, U, dUdx, dUdy, theta_);
+
+	active_tiles_->parallel_for_cells(cgh, kernel);
+      });
+      return;
+    }
+
+    if (tile_size_[0] > 0 and tile_size_[1] > 0) {
+      U.queue().submit([&] (sycl::handler& cgh) {
+	using Kernel = MinmodCartesian2DMeshCell2CellTiledSpatialDerivativeKernel<T,N,FS>;
+	auto kernel = Kernel(cgh, U, dUdx, dUdy, theta_, tile_size_);
+
+	cgh.parallel_for(Kernel::get_range(*(U.mesh_definition()), tile_size_),
+			 kernel);
+      });
+      return;
+    }
+    
+    // The interior and the ring of cells at the edge of the mesh are
+    // calculated separately, so that only the latter checks for the
+    // edge
+    if (Cartesian2DMeshRegion<>::has_interior(*(U.mesh_definition()))) {
+      submit<Cartesian2DMeshRegion<Cartesian2DMeshRegionType::Interior>>(U, dUdx, dUdy);
+      submit<Cartesian2DMeshRegion<Cartesian2DMeshRegionType::Perimeter>>(U, dUdx, dUdy);
+    } else {
+      submit<Cartesian2DMeshRegion<>>(U, dUdx, dUdy);
+    }
+  }
+
+private:
+
+  // Launch the untiled kernel over a region of the mesh
+  template<typename Region>
+  void submit(const FieldVector<T,MeshType,FromFM,N,FS>& U,
+	      FieldVector<T,MeshType,ToFM,N,FS>& dUdx,
+	      FieldVector<T,MeshType,ToFM,N,FS>& dUdy) const
+  {
+    U.queue().submit([&] (sycl::handler& cgh) {
+      using Kernel = MinmodCartesian2DMeshCell2CellSpatialDerivativeKernel<T,N,FS,Region>;
+      auto kernel = Kernel(cgh, U, dUdx, dUdy, theta_);
       
-      cgh.parallel_for(dUdx.get_range(), kernel);
+      cgh.parallel_for(Kernel::get_range(*(U.mesh_definition())), kernel);
     });
   }
 };
@@ -7,17 +7,23 @@
 #ifndef SpatialDerivatives_Minmod_Cartesian2DMeshCell2CellKernel_hpp
 #define SpatialDerivatives_Minmod_Cartesian2DMeshCell2CellKernel_hpp
 
+#include "MinmodSlope.hpp"
+#include "../../../Meshes/Cartesian2DMeshRegion.hpp"
+
+// Region is the Cartesian2DMeshRegion the kernel is launched over. In
+// the interior the neighbouring cells are not checked for the edge of
+// the mesh.
 template<typename T,
-	 size_t N>
+	 size_t N,
+	 FieldStorage FS = FieldStorage::Separate,
+	 typename Region = Cartesian2DMeshRegion<>>
 class MinmodCartesian2DMeshCell2CellSpatialDerivativeKernel
 {
 protected:
 
   using ValueType = T;
   using MeshType = Cartesian2DMesh;
-  using FV = FieldVector<T,MeshType,FieldMapping::Cell,N>;
-  
-  MeshType mesh_;
+  using FV = FieldVector<T,MeshType,FieldMapping::Cell,N,FS>;
   
   using ReadAccessor =
     typename FV::template Accessor<sycl::access::mode::read>;
@@ -31,17 +37,10 @@ protected:
   WriteAccessor dUdy_wo_;
 
   ValueType theta_;
-  
-  ValueType minmod3(ValueType a,
-		    ValueType b,
-		    ValueType c) const
-  {
-    ValueType mm =
-      0.5 * (sycl::sign(a) + sycl::sign(b)) *
-      sycl::min(sycl::fabs(a), sycl::fabs(b));
-    return 0.5 * (sycl::sign(mm) + sycl::sign(c)) *
-      sycl::min(sycl::fabs(mm), sycl::fabs(c));
-  }
+
+  size_t nx_;
+  size_t ny_;
+  typename MeshType::CoordType cell_size_;
   
 public:
   
@@ -50,69 +49,53 @@ public:
 							FV& dUdx,
 							FV& dUdy,
 							const ValueType& theta)
-    : mesh_(*(U.mesh_definition())),
-      U_ro_(U.get_read_accessor(cgh)),
+    : U_ro_(U.get_read_accessor(cgh)),
       dUdx_wo_(dUdx.get_write_accessor(cgh)),
       dUdy_wo_(dUdy.get_write_accessor(cgh)),
-      theta_(theta)
+      theta_(theta),
+      nx_(U.mesh_definition()->get_cell_index_size()[0]),
+      ny_(U.mesh_definition()->get_cell_index_size()[1]),
+      cell_size_(U.mesh_definition()->cell_size())
   {
   }
+
+  // Launched over the cells of the region (see
+  // Meshes/Cartesian2DMeshRegion.hpp)
+  static sycl::range<2> get_range(const MeshType& mesh)
+  {
+    return Region::get_range(mesh);
+  }
   
-  void operator()(sycl::item<1> item) const {
-    size_t cid_c = item.get_linear_id();
-    typename MeshType::IndexType cidx_c = mesh_.get_cell_index(cid_c);
+  void operator()(sycl::item<2> item) const {
+    auto cidx = Region::cell_index(item, nx_, ny_);
+    calculate(cidx[0], cidx[1]);
+  }
 
-    uint8_t cell_edge = 0;
-    size_t cid_w;
-    if (cidx_c[0] > 0) {
-      cid_w = mesh_.get_cell_linear_id({cidx_c[0] - 1, cidx_c[1]});
-    } else {
-      cid_w = cid_c;
-      cell_edge += 8;
-    }
-    size_t cid_e;
-    if (cidx_c[0] < mesh_.get_cell_index_size()[0] - 1) {
-      cid_e = mesh_.get_cell_linear_id({cidx_c[0] + 1, cidx_c[1]});
-    } else {
-      cid_e = cid_c;
-      cell_edge += 4;
-    }
-    size_t cid_s;
-    if (cidx_c[1] > 0) {
-      cid_s = mesh_.get_cell_linear_id({cidx_c[0], cidx_c[1] - 1});
-    } else {
-      cid_s = cid_c;
-      cell_edge += 2;
-    }
-    size_t cid_n;
-    if (cidx_c[1] < mesh_.get_cell_index_size()[1] - 1) {
-      cid_n = mesh_.get_cell_linear_id({cidx_c[0], cidx_c[1] + 1});
+  // Calculate the slopes at the cell with (x, y) index (ci, cj)
+  void calculate(const size_t& ci, const size_t& cj) const {
+    size_t cid_c = cj * nx_ + ci;
+
+    size_t cid_w, cid_e, cid_s, cid_n;
+    if constexpr (Region::is_interior) {
+      cid_w = cid_c - 1;
+      cid_e = cid_c + 1;
+      cid_s = cid_c - nx_;
+      cid_n = cid_c + nx_;
     } else {
-      cid_n = cid_c;
-      cell_edge += 1;
+      cid_w = (ci > 0 ? cid_c - 1 : cid_c);
+      cid_e = (ci < nx_ - 1 ? cid_c + 1 : cid_c);
+      cid_s = (cj > 0 ? cid_c - nx_ : cid_c);
+      cid_n = (cj < ny_ - 1 ? cid_c + nx_ : cid_c);
     }
 
     for (size_t i = 0; i < U_ro_.size(); ++i) {
-      auto& U = U_ro_[i];
+      const auto& U = U_ro_[i];
 
       ValueType Uc = U[cid_c];
-      ValueType Uw = U[cid_w];
-      ValueType Ue = U[cid_e];
-      ValueType Us = U[cid_s];
-      ValueType Un = U[cid_n];
-
-      if (Uw != Uw) Uw = Uc;
-      if (Ue != Ue) Ue = Uc;
-      if (Us != Us) Us = Uc;
-      if (Un != Un) Un = Uc;
-
-      typename MeshType::CoordType cell_size = mesh_.cell_size();
-      dUdx_wo_[i][cid_c] = minmod3(theta_ * (Uc - Uw) / cell_size[0],
-				   theta_ * (Ue - Uc) / cell_size[0],
-				   0.5f * (Ue - Uw) / cell_size[0]);
-      dUdy_wo_[i][cid_c] = minmod3(theta_ * (Uc - Us) / cell_size[1],
-				   theta_ * (Un - Uc) / cell_size[1],
-				   0.5f * (Un - Us) / cell_size[1]);
+      dUdx_wo_[i][cid_c] = MinmodSlope<T>::calculate(U[cid_w], Uc, U[cid_e],
+						     theta_, cell_size_[0]);
+      dUdy_wo_[i][cid_c] = MinmodSlope<T>::calculate(U[cid_s], Uc, U[cid_n],
+						     theta_, cell_size_[1]);
     }
   }
 
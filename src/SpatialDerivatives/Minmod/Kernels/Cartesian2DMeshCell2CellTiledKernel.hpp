@@ -0,0 +1,143 @@
+/***********************************************************************
+ * SpatialDerivatives/Minmod/Kernels/Cartesian2DMeshCell2CellTiledKernel.hpp
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef SpatialDerivatives_Minmod_Cartesian2DMeshCell2CellTiledKernel_hpp
+#define SpatialDerivatives_Minmod_Cartesian2DMeshCell2CellTiledKernel_hpp
+
+#include "MinmodSlope.hpp"
+
+// Work-group tiled version of the minmod slope kernel. Each work-group
+// covers a tile of cells and first copies the tile, plus a halo one
+// cell wide, into local memory so that each value is read from global
+// memory once rather than once for every cell that uses it.
+//
+// The kernel is launched over an nd_range whose dimension 0 is the row
+// (y-index) and dimension 1 the column (x-index). The global range is
+// rounded up to a whole number of tiles; items beyond the edge of the
+// mesh help to fill the tile but write nothing.
+template<typename T,
+	 size_t N,
+	 FieldStorage FS = FieldStorage::Separate>
+class MinmodCartesian2DMeshCell2CellTiledSpatialDerivativeKernel
+{
+protected:
+
+  using ValueType = T;
+  using MeshType = Cartesian2DMesh;
+  using FV = FieldVector<T,MeshType,FieldMapping::Cell,N,FS>;
+
+  using ReadAccessor =
+    typename FV::template Accessor<sycl::access::mode::read>;
+
+  using WriteAccessor =
+    typename FV::template Accessor<sycl::access::mode::write>;
+
+  using LocalAccessor = sycl::accessor<T, 1,
+				       sycl::access::mode::read_write,
+				       sycl::access::target::local>;
+
+  ReadAccessor U_ro_;
+
+  WriteAccessor dUdx_wo_;
+  WriteAccessor dUdy_wo_;
+
+  ValueType theta_;
+
+  size_t nx_;
+  size_t ny_;
+  typename MeshType::CoordType cell_size_;
+
+  // Tile size in the x- and y-directions and the size of the tile
+  // including its halo
+  size_t tx_;
+  size_t ty_;
+  size_t hx_;
+  size_t hy_;
+
+  // U for the tile and its halo, component by component
+  LocalAccessor U_tile_;
+
+public:
+
+  MinmodCartesian2DMeshCell2CellTiledSpatialDerivativeKernel(sycl::handler& cgh,
+							     const FV& U,
+							     FV& dUdx,
+							     FV& dUdy,
+							     const ValueType& theta,
+							     const std::array<size_t,2>& tile_size)
+    : U_ro_(U.get_read_accessor(cgh)),
+      dUdx_wo_(dUdx.get_write_accessor(cgh)),
+      dUdy_wo_(dUdy.get_write_accessor(cgh)),
+      theta_(theta),
+      nx_(U.mesh_definition()->get_cell_index_size()[0]),
+      ny_(U.mesh_definition()->get_cell_index_size()[1]),
+      cell_size_(U.mesh_definition()->cell_size()),
+      tx_(tile_size[0]),
+      ty_(tile_size[1]),
+      hx_(tile_size[0] + 2),
+      hy_(tile_size[1] + 2),
+      U_tile_(sycl::range<1>(N * (tile_size[0] + 2) * (tile_size[1] + 2)),
+	      cgh)
+  {
+  }
+
+  static sycl::nd_range<2> get_range(const MeshType& mesh,
+				     const std::array<size_t,2>& tile_size)
+  {
+    auto ncells = mesh.get_cell_index_size();
+    size_t gx = ((ncells[0] + tile_size[0] - 1) / tile_size[0]) * tile_size[0];
+    size_t gy = ((ncells[1] + tile_size[1] - 1) / tile_size[1]) * tile_size[1];
+    return sycl::nd_range<2>(sycl::range<2>(gy, gx),
+			     sycl::range<2>(tile_size[1], tile_size[0]));
+  }
+
+  void operator()(sycl::nd_item<2> item) const {
+    size_t lj = item.get_local_id(0);
+    size_t li = item.get_local_id(1);
+    size_t j0 = item.get_group(0) * ty_;
+    size_t i0 = item.get_group(1) * tx_;
+
+    // Fill the tile and halo. Cells off the edge of the mesh take the
+    // value of the nearest edge cell, which gives the same one-sided
+    // stencil as the untiled kernel.
+    size_t tile_count = hx_ * hy_;
+    for (size_t k = lj * tx_ + li; k < tile_count; k += tx_ * ty_) {
+      size_t hj = k / hx_;
+      size_t hi = k % hx_;
+      size_t gj = sycl::min(sycl::max(j0 + hj, (size_t) 1), ny_) - 1;
+      size_t gi = sycl::min(sycl::max(i0 + hi, (size_t) 1), nx_) - 1;
+      size_t gid = gj * nx_ + gi;
+      for (size_t i = 0; i < N; ++i) {
+	U_tile_[i * tile_count + k] = U_ro_[i][gid];
+      }
+    }
+
+    item.barrier(sycl::access::fence_space::local_space);
+
+    size_t cj = j0 + lj;
+    size_t ci = i0 + li;
+    if (cj >= ny_ or ci >= nx_) return;
+
+    size_t cid_c = cj * nx_ + ci;
+    size_t k_c = (lj + 1) * hx_ + (li + 1);
+
+    for (size_t i = 0; i < N; ++i) {
+      size_t offset = i * tile_count;
+      ValueType Uc = U_tile_[offset + k_c];
+      ValueType Uw = U_tile_[offset + k_c - 1];
+      ValueType Ue = U_tile_[offset + k_c + 1];
+      ValueType Us = U_tile_[offset + k_c - hx_];
+      ValueType Un = U_tile_[offset + k_c + hx_];
+      dUdx_wo_[i][cid_c] = MinmodSlope<T>::calculate(Uw, Uc, Ue,
+						     theta_, cell_size_[0]);
+      dUdy_wo_[i][cid_c] = MinmodSlope<T>::calculate(Us, Uc, Un,
+						     theta_, cell_size_[1]);
+    }
+  }
+
+};
+
+#endif
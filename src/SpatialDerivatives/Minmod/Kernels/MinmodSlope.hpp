@@ -0,0 +1,48 @@
+/***********************************************************************
+ * SpatialDerivatives/Minmod/Kernels/MinmodSlope.hpp
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef SpatialDerivatives_Minmod_Kernels_MinmodSlope_hpp
+#define SpatialDerivatives_Minmod_Kernels_MinmodSlope_hpp
+
+template<typename T>
+class MinmodSlope
+{
+public:
+
+  using ValueType = T;
+
+  static ValueType minmod3(ValueType a,
+			   ValueType b,
+			   ValueType c)
+  {
+    ValueType mm =
+      0.5 * (sycl::sign(a) + sycl::sign(b)) *
+      sycl::min(sycl::fabs(a), sycl::fabs(b));
+    return 0.5 * (sycl::sign(mm) + sycl::sign(c)) *
+      sycl::min(sycl::fabs(mm), sycl::fabs(c));
+  }
+
+  // Limited slope at a cell with value Uc, given the values in the
+  // neighbouring cells upstream (Um) and downstream (Up) a distance ds
+  // away. Neighbours that are excluded from the calculation (NaN) take
+  // the central value.
+  static ValueType calculate(ValueType Um,
+			     const ValueType& Uc,
+			     ValueType Up,
+			     const ValueType& theta,
+			     const double& ds)
+  {
+    if (Um != Um) Um = Uc;
+    if (Up != Up) Up = Uc;
+
+    return minmod3(theta * (Uc - Um) / ds,
+		   theta * (Up - Uc) / ds,
+		   0.5f * (Up - Um) / ds);
+  }
+
+};
+
+#endif
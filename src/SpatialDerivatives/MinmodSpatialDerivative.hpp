@@ -8,14 +8,16 @@
 #define SpatialDerivatives_MinmodSpatialDerivative_hpp
 
 #include "../SpatialDerivative.hpp"
+#include "../ActiveTileSet.hpp"
 
 template<typename T,
 	 typename MeshType,
 	 FieldMapping FromFM,
 	 FieldMapping ToFM,
-	 size_t N>
+	 size_t N,
+	 FieldStorage FS = FieldStorage::Separate>
 class MinmodSpatialDerivative
-  : public SpatialDerivative<T, MeshType, FromFM, ToFM, N>
+  : public SpatialDerivative<T, MeshType, FromFM, ToFM, N, FS>
 {
 private:
 
@@ -23,17 +25,18 @@ private:
   
 public:
   
-  MinmodSpatialDerivative(void)
-    : SpatialDerivative<T, MeshType, FromFM, ToFM, N>(),
+  MinmodSpatialDerivative(const std::array<size_t,2>& tile_size = { 0, 0 },
+			  const std::shared_ptr<ActiveTileSet<MeshType>>& active_tiles = nullptr)
+    : SpatialDerivative<T, MeshType, FromFM, ToFM, N, FS>(),
       theta_(2.0)
   {}
 
   virtual ~MinmodSpatialDerivative(void)
   {}
 
-  virtual void calculate(const FieldVector<T,MeshType,FromFM,N>& U,
-			 FieldVector<T,MeshType,ToFM,N>& dUdx,
-			 FieldVector<T,MeshType,ToFM,N>& dUdy) const
+  virtual void calculate(const FieldVector<T,MeshType,FromFM,N,FS>& U,
+			 FieldVector<T,MeshType,ToFM,N,FS>& dUdx,
+			 FieldVector<T,MeshType,ToFM,N,FS>& dUdy) const
   {
     throw std::logic_error("This type of spatial derivative not implemented.");
   }
@@ -0,0 +1,328 @@
+/***********************************************************************
+ * StepClock.hpp
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef StepClock_hpp
+#define StepClock_hpp
+
+#include <memory>
+#include <cstdint>
+
+#include "sycl.hpp"
+
+// The time and time step of the current step, held in device memory.
+// Kernels read them from here rather than being given them by the
+// host, so that the host can either set them before each step (see
+// set()) or leave the device to accept or reject each step and choose
+// the next time step itself (see advance()). In the latter case the
+// host only has to read the state back when it wants to know how far
+// the simulation has got.
+template<typename T>
+class StepClock
+{
+public:
+
+  using ValueType = T;
+
+  // Status flags: the last step was accepted, the end of the inner
+  // loop has been reached, too many steps were repeated
+  static constexpr uint32_t Accepted = 1;
+  static constexpr uint32_t Finished = 2;
+  static constexpr uint32_t Failed = 4;
+
+  struct State
+  {
+    double t_start;	   // Time at the start of the inner loop
+    double t_local;	   // Time of the current step relative to t_start
+    double t_local_end;	   // Length of the inner loop
+    double dt;		   // Time step of the current step
+    double last_dt;	   // Time step of the last step taken
+    double comax;	   // Control number of the last step taken
+    uint32_t inner_steps;  // Number of steps accepted
+    uint32_t repeated_steps; // Number of steps rejected
+    uint32_t status;
+  };
+
+private:
+
+  using StateAccessorRO =
+    sycl::accessor<State, 1, sycl::access::mode::read>;
+  using StateAccessorRW =
+    sycl::accessor<State, 1, sycl::access::mode::read_write>;
+  using RateAccessorRW =
+    sycl::accessor<T, 1, sycl::access::mode::read_write>;
+
+  std::shared_ptr<sycl::queue> queue_;
+
+  std::shared_ptr<sycl::buffer<State,1>> state_;
+
+  // Maximum over the mesh of the control number per unit time step,
+  // reduced into by the kernel that calculates it during a step
+  std::shared_ptr<sycl::buffer<T,1>> rate_;
+
+  // Whether the steps taken find the rate at all. Steps of a fixed
+  // time step mostly do not, which saves the reduction.
+  bool rate_measured_;
+
+  class SetKernel
+  {
+  private:
+
+    StateAccessorRW state_rw_;
+    RateAccessorRW rate_rw_;
+    double t_start_;
+    double t_local_;
+    double t_local_end_;
+    double dt_;
+
+  public:
+
+    SetKernel(const StateAccessorRW& state_rw,
+	      const RateAccessorRW& rate_rw,
+	      const double& t_start,
+	      const double& t_local,
+	      const double& t_local_end,
+	      const double& dt)
+      : state_rw_(state_rw), rate_rw_(rate_rw),
+	t_start_(t_start), t_local_(t_local),
+	t_local_end_(t_local_end), dt_(dt)
+    {}
+
+    void operator()(void) const
+    {
+      State& s = state_rw_[0];
+      s.t_start = t_start_;
+      s.t_local = t_local_;
+      s.t_local_end = t_local_end_;
+      s.dt = dt_;
+      s.last_dt = 0.0;
+      s.comax = 0.0;
+      s.inner_steps = 0;
+      s.repeated_steps = 0;
+      s.status = 0;
+      rate_rw_[0] = 0.0f;
+    }
+  };
+
+  class AdvanceKernel
+  {
+  private:
+
+    StateAccessorRW state_rw_;
+    RateAccessorRW rate_rw_;
+    double courant_target_;
+    double max_dt_;
+    uint32_t max_repeats_;
+
+  public:
+
+    AdvanceKernel(const StateAccessorRW& state_rw,
+		  const RateAccessorRW& rate_rw,
+		  const double& courant_target,
+		  const double& max_dt,
+		  const uint32_t& max_repeats)
+      : state_rw_(state_rw), rate_rw_(rate_rw),
+	courant_target_(courant_target), max_dt_(max_dt),
+	max_repeats_(max_repeats)
+    {}
+
+    // The same decisions as TemporalScheme::inner_loop makes on the
+    // host
+    void operator()(void) const
+    {
+      State& s = state_rw_[0];
+      double rate = rate_rw_[0];
+      rate_rw_[0] = 0.0f;
+
+      // Steps enqueued after the end of the loop do nothing
+      if (s.status & (Finished | Failed)) {
+	s.status &= ~Accepted;
+	return;
+      }
+
+      double dt = s.dt;
+      double comax = rate * dt;
+      double target_dt = dt;
+      s.last_dt = dt;
+      s.comax = comax;
+
+      if (comax > courant_target_) {
+	// Repeat the step with a smaller time step
+	s.status = 0;
+	s.repeated_steps++;
+	if (s.repeated_steps >= max_repeats_) {
+	  s.status = Failed;
+	  return;
+	}
+	target_dt = dt * sycl::fmax(0.1, sycl::fmin(0.9,
+						     comax / courant_target_));
+      } else {
+	s.status = Accepted;
+	s.t_local += dt;
+	s.inner_steps++;
+
+	if (comax < 0.9 * courant_target_) {
+	  target_dt = sycl::fmin(max_dt_, dt * 1.1);
+	}
+
+	if (s.t_local >= s.t_local_end) {
+	  // Keep the time step of the last step for the next loop
+	  s.status |= Finished;
+	  return;
+	}
+	target_dt = approach_end(target_dt, s.t_local, s.t_local_end,
+				 s.inner_steps);
+      }
+
+      s.dt = target_dt;
+    }
+  };
+
+public:
+
+  StepClock(const std::shared_ptr<sycl::queue>& queue)
+    : queue_(queue),
+      state_(std::make_shared<sycl::buffer<State,1>>(sycl::range<1>(1))),
+      rate_(std::make_shared<sycl::buffer<T,1>>(sycl::range<1>(1))),
+      rate_measured_(true)
+  {
+    set(0.0, 0.0, 0.0, 0.0);
+  }
+
+  // Adjust the time step after an accepted step so that the inner
+  // loop finishes exactly on its end time, on an even number of steps
+  // and without a very short last step.
+  static double approach_end(double target_dt,
+			     const double& t_local,
+			     const double& t_local_end,
+			     const size_t& inner_steps)
+  {
+    if (t_local + target_dt > t_local_end) {
+      // The next timestep will take us to or past the end of the
+      // inner loop. Lower it so that it hits exactly.
+      target_dt = t_local_end - t_local;
+      // We need to finish the loop on an even number of steps, so
+      // if we currently have an even number of steps we need to
+      // lower the timestep so that we do two more.
+      if (inner_steps % 2 == 0) {
+	// To do two more steps we need to go 60% of the way
+	target_dt *= 0.6;
+      }
+    } else if (t_local + 1.5 * target_dt >= t_local_end) {
+      // This timestep will take us close to the end of the
+      // loop. Lower it so we don't get really close but not
+      // quite there
+      if (inner_steps % 2 == 0) {
+	// If we're on an even step we want to finish in two
+	// steps, so we go 60% of the way there
+	target_dt = 0.6 * (t_local_end - t_local);
+      } else {
+	// If we're on an odd step we want to finish in one or
+	// three steps. Because we can't guarantee that we can
+	// use a high enough timestep to finish in one, we go
+	// 35% of the way there and aim for three.
+	target_dt = 0.35 * (t_local_end - t_local);
+      }
+    }
+    return target_dt;
+  }
+
+  // Read access to the times from within a kernel
+  class Times
+  {
+  private:
+
+    StateAccessorRO state_ro_;
+    double stage_;
+
+  public:
+
+    Times(const StateAccessorRO& state_ro, const double& stage)
+      : state_ro_(state_ro), stage_(stage)
+    {}
+
+    // Time at the stage of the step being calculated
+    double time_now(void) const
+    {
+      const State& s = state_ro_[0];
+      return s.t_start + s.t_local + stage_ * s.dt;
+    }
+
+    double timestep(void) const
+    {
+      return state_ro_[0].dt;
+    }
+
+    bool step_accepted(void) const
+    {
+      return (state_ro_[0].status & Accepted) != 0;
+    }
+  };
+
+  // stage is the fraction of the time step at which the kernel is
+  // evaluating things
+  Times get_times(sycl::handler& cgh, const double& stage = 0.0) const
+  {
+    return Times(state_->template get_access<sycl::access::mode::read>(cgh),
+		 stage);
+  }
+
+  auto get_rate_reduction(sycl::handler& cgh) const
+  {
+    return sycl::reduction(rate_->get_access(cgh), sycl::maximum<T>());
+  }
+
+  // Whether the steps taken from now on find the rate (see
+  // get_rate_reduction()). If not, get_rate() is meaningless.
+  void measure_rate(bool measured)
+  {
+    rate_measured_ = measured;
+  }
+
+  bool rate_measured(void) const
+  {
+    return rate_measured_;
+  }
+
+  // Set the times of the next step from the host
+  void set(const double& t_start, const double& t_local,
+	   const double& t_local_end, const double& dt)
+  {
+    queue_->submit([&] (sycl::handler& cgh) {
+      auto kernel = SetKernel(state_->get_access(cgh), rate_->get_access(cgh),
+			      t_start, t_local, t_local_end, dt);
+      cgh.single_task(kernel);
+    });
+  }
+
+  // Accept or reject the step just taken and choose the time step of
+  // the next, on the device
+  void advance(const double& courant_target, const double& max_dt,
+	       const uint32_t& max_repeats = 1000)
+  {
+    queue_->submit([&] (sycl::handler& cgh) {
+      auto kernel = AdvanceKernel(state_->get_access(cgh),
+				  rate_->get_access(cgh),
+				  courant_target, max_dt, max_repeats);
+      cgh.single_task(kernel);
+    });
+  }
+
+  // Read the state back to the host. Waits for the device.
+  State get_state(void) const
+  {
+    return state_->get_host_access()[0];
+  }
+
+  // Read the maximum control number per unit time step of the last
+  // step back to the host. Waits for the device.
+  T get_rate(void) const
+  {
+    return rate_->get_host_access()[0];
+  }
+
+};
+
+#endif
@@ -0,0 +1,87 @@
+/***********************************************************************
+ * StepGraph.hpp
+ *
+ * A recording of the commands enqueued for one step, replayed for
+ * each later step rather than submitting them again one command group
+ * at a time. This relies on the time and time step of each step being
+ * held on the device by the StepClock, so the same commands serve
+ * every step of an inner loop whose steps are controlled on the device
+ * (see TemporalScheme::device_inner_loop()).
+ *
+ * It needs the SYCL command graph extension
+ * (sycl_ext_oneapi_graph). Without that, available is false and a
+ * StepGraph cannot be constructed.
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef StepGraph_hpp
+#define StepGraph_hpp
+
+#include <memory>
+#include <optional>
+
+#include "sycl.hpp"
+
+class StepGraph
+{
+public:
+
+#ifdef SYCL_EXT_ONEAPI_GRAPH
+  static constexpr bool available = true;
+#else
+  static constexpr bool available = false;
+#endif
+
+private:
+
+  std::shared_ptr<sycl::queue> queue_;
+
+#ifdef SYCL_EXT_ONEAPI_GRAPH
+  using Graph = sycl::ext::oneapi::experimental::command_graph<
+    sycl::ext::oneapi::experimental::graph_state::executable>;
+
+  std::optional<Graph> graph_;
+#endif
+
+public:
+
+  // Record the commands enqueued on queue by enqueue_step(). Throws
+  // sycl::exception if they cannot be recorded (e.g. a command the
+  // extension does not support), having stopped recording, so that
+  // the queue can be used as before.
+  template<typename F>
+  StepGraph(const std::shared_ptr<sycl::queue>& queue,
+	    const F& enqueue_step)
+    : queue_(queue)
+  {
+#ifdef SYCL_EXT_ONEAPI_GRAPH
+    namespace sycl_exp = sycl::ext::oneapi::experimental;
+    sycl_exp::command_graph graph(queue_->get_context(),
+				  queue_->get_device(),
+				  { sycl_exp::property::graph::assume_buffer_outlives_graph{} });
+    graph.begin_recording(*queue_);
+    try {
+      enqueue_step();
+    } catch (...) {
+      graph.end_recording(*queue_);
+      throw;
+    }
+    graph.end_recording(*queue_);
+    graph_.emplace(graph.finalize());
+#else
+    throw std::logic_error("Step recording is not available.");
+#endif
+  }
+
+  // Enqueue the recorded commands once
+  void replay(void) const
+  {
+#ifdef SYCL_EXT_ONEAPI_GRAPH
+    queue_->ext_oneapi_graph(*graph_);
+#endif
+  }
+
+};
+
+#endif
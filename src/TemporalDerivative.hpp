@@ -8,11 +8,41 @@
 #define TemporalDerivative_hpp
 
 #include "FieldVector.hpp"
+#include "StepClock.hpp"
 
+// The state of the next stage of a Runge-Kutta step,
+//
+//   U* = U + Δt Σᵢ aᵢ (dU/dt)ᵢ,
+//
+// for a temporal derivative to form in the same pass as it calculates
+// dU/dt, which is the last of the terms (see calculate_and_combine()).
+// U is the state at the start of the step and dUdt[i] the dU/dt of the
+// earlier stages. The coefficients are converted to the value type of
+// the state when the kernel is set up.
 template<typename T,
 	 typename MeshType,
 	 FieldMapping FM,
-	 size_t N>
+	 size_t N,
+	 FieldStorage FS = FieldStorage::Separate>
+struct StageCombination
+{
+  static constexpr size_t MaxTerms = 4;
+
+  using StateType = FieldVector<T,MeshType,FM,N,FS>;
+
+  const StateType* U;
+  std::array<const StateType*, MaxTerms-1> dUdt;
+  std::array<double, MaxTerms> a;
+  size_t terms;
+};
+
+template<typename T,
+	 typename MeshType,
+	 FieldMapping FM,
+	 size_t N,
+	 FieldStorage FS = FieldStorage::Separate,
+	 typename CT = T,
+	 typename BT = T>
 class TemporalDerivative
 {
 public:
@@ -23,16 +53,44 @@ public:
   virtual ~TemporalDerivative(void)
   {}
 
-  virtual void calculate(const FieldVector<T,MeshType,FM,N>& U,
-			 const FieldVector<T,MeshType,FieldMapping::Cell,3>& zb,
-			 const FieldVector<T,MeshType,FieldMapping::Cell,4>& n,
-			 const FieldVector<T,MeshType,FieldMapping::Cell,2>& Q_in,
-			 const FieldVector<T,MeshType,FieldMapping::Cell,2>& h_in,
-			 const FieldVector<T,MeshType,FieldMapping::Face,4>& flux,
-			 FieldVector<T,MeshType,FM,N>& dUdt,
-			 const double& time_now, const double& timestep,
+  virtual void calculate(const FieldVector<T,MeshType,FM,N,FS>& U,
+			 const FieldVector<BT,MeshType,FieldMapping::Face,3>& zf,
+			 const FieldVector<CT,MeshType,FieldMapping::Cell,2>& dzb,
+			 const FoldableFieldVector<CT,MeshType,FieldMapping::Cell,4>& n,
+			 const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& Q_in,
+			 const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& h_in,
+			 const FieldVector<T,MeshType,FieldMapping::Face,3,FS>& flux,
+			 FieldVector<T,MeshType,FM,N,FS>& dUdt,
+			 const StepClock<T>& clock, const double& stage,
 			 const double& bdy_t0, const double& bdy_t1) const = 0;
 
+  // As calculate(), then overwrite U with the state of next_stage
+  virtual void calculate_and_combine(FieldVector<T,MeshType,FM,N,FS>& U,
+				     const FieldVector<BT,MeshType,FieldMapping::Face,3>& zf,
+				     const FieldVector<CT,MeshType,FieldMapping::Cell,2>& dzb,
+				     const FoldableFieldVector<CT,MeshType,FieldMapping::Cell,4>& n,
+				     const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& Q_in,
+				     const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& h_in,
+				     const FieldVector<T,MeshType,FieldMapping::Face,3,FS>& flux,
+				     FieldVector<T,MeshType,FM,N,FS>& dUdt,
+				     const StepClock<T>& clock, const double& stage,
+				     const double& bdy_t0, const double& bdy_t1,
+				     const StageCombination<T,MeshType,FM,N,FS>& next_stage) const = 0;
+
+  // As calculate(), but add dU/dt to the register dQ of a low-storage
+  // Runge-Kutta stage, dQ = A dQ + Δt dU/dt, rather than write it
+  virtual void calculate_and_accumulate(const FieldVector<T,MeshType,FM,N,FS>& U,
+					const FieldVector<BT,MeshType,FieldMapping::Face,3>& zf,
+					const FieldVector<CT,MeshType,FieldMapping::Cell,2>& dzb,
+					const FoldableFieldVector<CT,MeshType,FieldMapping::Cell,4>& n,
+					const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& Q_in,
+					const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& h_in,
+					const FieldVector<T,MeshType,FieldMapping::Face,3,FS>& flux,
+					FieldVector<T,MeshType,FM,N,FS>& dQ,
+					const StepClock<T>& clock, const double& stage,
+					const double& bdy_t0, const double& bdy_t1,
+					const double& A) const = 0;
+
 };
 
 #endif
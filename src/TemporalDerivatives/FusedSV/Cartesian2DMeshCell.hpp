@@ -0,0 +1,127 @@
+/***********************************************************************
+ * TemporalDerivatives/FusedSV/Cartesian2DMeshCell.hpp
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef TemporalDerivatives_FusedSV_Cartesian2DMeshCell_hpp
+#define TemporalDerivatives_FusedSV_Cartesian2DMeshCell_hpp
+
+#include "Kernels/Cartesian2DMeshCellKernel.hpp"
+
+template<typename T, FieldStorage FS, typename CT, typename BT>
+class FusedSVTemporalDerivative<T, Cartesian2DMesh,
+				FieldMapping::Cell, 3, FS, CT, BT>
+{
+public:
+
+  using MeshType = Cartesian2DMesh;
+  static const FieldMapping FM = FieldMapping::Cell;
+  static const size_t N = 3;
+
+private:
+
+  T theta_;
+
+  // Tiles to calculate; null to calculate the whole mesh.
+  std::shared_ptr<ActiveTileSet<MeshType>> active_tiles_;
+
+  // Use FastMath rather than ExactMath (see MathProfile.hpp)
+  bool fast_math_;
+
+  // Take the friction point-implicitly (see
+  // ../SV/Kernels/SVCellTemporalDerivative.hpp)
+  bool implicit_friction_;
+  
+public:
+  
+  FusedSVTemporalDerivative(const std::shared_ptr<ActiveTileSet<MeshType>>& active_tiles = nullptr,
+			    bool fast_math = false,
+			    bool implicit_friction = false)
+    : theta_(2.0),
+      active_tiles_(active_tiles),
+      fast_math_(fast_math),
+      implicit_friction_(implicit_friction)
+  {}
+
+  virtual ~FusedSVTemporalDerivative(void)
+  {}
+
+  virtual void calculate(const FieldVector<T,MeshType,FM,N,FS>& U,
+			 const FieldVector<BT,MeshType,FieldMapping::Cell,1>& zb,
+			 const FieldVector<CT,MeshType,FieldMapping::Cell,2>& dzb,
+			 const FoldableFieldVector<CT,MeshType,FieldMapping::Cell,4>& n,
+			 const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& Q_in,
+			 const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& h_in,
+			 FieldVector<T,MeshType,FM,N,FS>& dUdt,
+			 const StepClock<T>& clock, const double& stage,
+			 const double& bdy_t0, const double& bdy_t1) const
+  {
+    if (fast_math_) {
+      calculate_with<FastMath>(U, zb, dzb, n, Q_in, h_in, dUdt,
+			       clock, stage, bdy_t0, bdy_t1);
+    } else {
+      calculate_with<ExactMath>(U, zb, dzb, n, Q_in, h_in, dUdt,
+				clock, stage, bdy_t0, bdy_t1);
+    }
+  }
+
+private:
+
+  // Launch the kernel with math profile M
+  template<typename M>
+  void calculate_with(const FieldVector<T,MeshType,FM,N,FS>& U,
+		      const FieldVector<BT,MeshType,FieldMapping::Cell,1>& zb,
+		      const FieldVector<CT,MeshType,FieldMapping::Cell,2>& dzb,
+		      const FoldableFieldVector<CT,MeshType,FieldMapping::Cell,4>& n,
+		      const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& Q_in,
+		      const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& h_in,
+		      FieldVector<T,MeshType,FM,N,FS>& dUdt,
+		      const StepClock<T>& clock, const double& stage,
+		      const double& bdy_t0, const double& bdy_t1) const
+  {
+    using All = Cartesian2DMeshRegion<Cartesian2DMeshRegionType::All,2>;
+    using Interior = Cartesian2DMeshRegion<Cartesian2DMeshRegionType::Interior,2>;
+    using Perimeter = Cartesian2DMeshRegion<Cartesian2DMeshRegionType::Perimeter,2>;
+
+    // Without active tiles the interior and the ring of cells at the
+    // edge of the mesh are calculated separately, so that only the
+    // latter checks for the edge
+    if (active_tiles_ or not All::has_interior(*(U.mesh_definition()))) {
+      submit<M,All>(U, zb, dzb, n, Q_in, h_in, dUdt,
+		    clock, stage, bdy_t0, bdy_t1);
+    } else {
+      submit<M,Interior>(U, zb, dzb, n, Q_in, h_in, dUdt,
+			 clock, stage, bdy_t0, bdy_t1);
+      submit<M,Perimeter>(U, zb, dzb, n, Q_in, h_in, dUdt,
+			  clock, stage, bdy_t0, bdy_t1);
+    }
+  }
+
+  // Launch the kernel with math profile M over a region of the mesh
+  template<typename M, typename Region>
+  void submit(const FieldVector<T,MeshType,FM,N,FS>& U,
+	      const FieldVector<BT,MeshType,FieldMapping::Cell,1>& zb,
+	      const FieldVector<CT,MeshType,FieldMapping::Cell,2>& dzb,
+	      const FoldableFieldVector<CT,MeshType,FieldMapping::Cell,4>& n,
+	      const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& Q_in,
+	      const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& h_in,
+	      FieldVector<T,MeshType,FM,N,FS>& dUdt,
+	      const StepClock<T>& clock, const double& stage,
+	      const double& bdy_t0, const double& bdy_t1) const
+  {
+    // Update dU/dt directly from U
+    U.queue().submit([&] (sycl::handler& cgh) {
+      using Kernel = FusedSVCartesian2DMeshCellTemporalDerivativeKernel<T,FS,CT,BT,M,Region>;
+      auto kernel = Kernel(cgh, U, zb, dzb, n, Q_in, h_in, dUdt, theta_, clock, stage, bdy_t0, bdy_t1, implicit_friction_);
+      
+      if (active_tiles_) {
+	active_tiles_->parallel_for_cells(cgh, kernel);
+      } else {
+	cgh.parallel_for(Kernel::get_range(*(U.mesh_definition())), kernel);
+      }
+    });
+  }
+};
+
+#endif
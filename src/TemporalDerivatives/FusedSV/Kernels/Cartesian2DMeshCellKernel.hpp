@@ -0,0 +1,279 @@
+/***********************************************************************
+ * TemporalDerivatives/FusedSV/Kernels/Cartesian2DMeshCellKernel.hpp
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef TemporalDerivatives_FusedSV_Kernels_Cartesian2DMeshCellKernel_hpp
+#define TemporalDerivatives_FusedSV_Kernels_Cartesian2DMeshCellKernel_hpp
+
+#include "../../../SpatialDerivatives/Minmod/Kernels/MinmodSlope.hpp"
+#include "../../../FluxFunctions/SV/Kernels/SVFaceFlux.hpp"
+#include "../../SV/Kernels/SVCellTemporalDerivative.hpp"
+#include "../../../Meshes/Cartesian2DMeshRegion.hpp"
+
+// Region is the Cartesian2DMeshRegion the kernel is launched over. The
+// slopes at the faces of a cell use the cells up to two away, so in an
+// interior two cells in from the edge no neighbour is checked for the
+// edge of the mesh.
+template<typename T,
+	 FieldStorage FS = FieldStorage::Separate,
+	 typename CT = T,
+	 typename BT = T,
+	 typename M = ExactMath,
+	 typename Region = Cartesian2DMeshRegion<Cartesian2DMeshRegionType::All,2>>
+class FusedSVCartesian2DMeshCellTemporalDerivativeKernel
+{
+protected:
+
+  using ValueType = T;
+  using MeshType = Cartesian2DMesh;
+  using IndexType = typename MeshType::IndexType;
+
+  template<size_t N>
+  using CellBedVector = FieldVector<BT,MeshType,FieldMapping::Cell,N>;
+
+  // Bed slopes and roughness, which may be stored with a narrower type
+  template<size_t N>
+  using CellConstantVector = FieldVector<CT,MeshType,FieldMapping::Cell,N>;
+
+  // Roughness and boundary inflows, which may each be folded into one
+  // value per component (see FieldVectors/FoldableFieldVector.hpp)
+  template<size_t N>
+  using CellFoldableVector = FoldableFieldVector<T,MeshType,FieldMapping::Cell,N>;
+
+  template<size_t N>
+  using CellFoldableConstantVector = FoldableFieldVector<CT,MeshType,FieldMapping::Cell,N>;
+
+  template<size_t N>
+  using CellStateVector = FieldVector<T,MeshType,FieldMapping::Cell,N,FS>;
+
+  MeshType mesh_;
+
+  template<size_t N>
+  using ReadBedAccessor =
+    typename CellBedVector<N>::template Accessor<sycl::access::mode::read>;
+
+  template<size_t N>
+  using ReadConstantAccessor =
+    typename CellConstantVector<N>::template Accessor<sycl::access::mode::read>;
+
+  template<size_t N>
+  using ReadStateAccessor =
+    typename CellStateVector<N>::template Accessor<sycl::access::mode::read>;
+
+  template<size_t N>
+  using WriteAccessor =
+    typename CellStateVector<N>::template Accessor<sycl::access::mode::write>;
+
+  ReadStateAccessor<3> U_ro_;
+  ReadBedAccessor<1> zb_ro_;
+  ReadConstantAccessor<2> dzb_ro_;
+  typename CellFoldableConstantVector<4>::Reader n_ro_;
+  typename CellFoldableVector<2>::Reader Q_in_ro_;
+  typename CellFoldableVector<2>::Reader h_in_ro_;
+  WriteAccessor<3> dUdt_wo_;
+
+  ValueType theta_;
+
+  typename StepClock<T>::Times times_;
+  float bdy_t0_;
+  float bdy_t1_;
+  bool implicit_friction_;
+
+  using SideType = SVFaceSide<T,BT>;
+  using FaceFluxType = std::array<ValueType,4>;
+  using FaceFlux = SVFaceFlux<T,BT,M>;
+
+  // Get the index of the cell one step in the D-direction (offset -1
+  // or +1) from a cell. Returns false if that would take us off the
+  // mesh.
+  template<int D>
+  bool get_offset_cell(const IndexType& cidx,
+		       const int& offset,
+		       IndexType& nidx) const
+  {
+    nidx = cidx;
+    if constexpr (Region::is_interior) {
+      nidx[D] += offset;
+      return true;
+    }
+    if (offset < 0) {
+      if (cidx[D] == 0) return false;
+      nidx[D] -= 1;
+    } else {
+      if (cidx[D] + 1 >= mesh_.get_cell_index_size()[D]) return false;
+      nidx[D] += 1;
+    }
+    return true;
+  }
+
+  // Get the cell-centred data for a cell along with the limited slopes
+  // normal to a face in the D-direction. The slopes are recalculated
+  // from the neighbouring cells exactly as the minmod spatial
+  // derivative would calculate them.
+  template<int D>
+  SideType get_side(const IndexType& cidx) const
+  {
+    size_t cid_c = mesh_.get_cell_linear_id(cidx);
+    IndexType nidx;
+    size_t cid_m = (get_offset_cell<D>(cidx, -1, nidx) ?
+		    mesh_.get_cell_linear_id(nidx) : cid_c);
+    size_t cid_p = (get_offset_cell<D>(cidx, 1, nidx) ?
+		    mesh_.get_cell_linear_id(nidx) : cid_c);
+    double ds = mesh_.cell_size()[D];
+
+    auto slope = [&](const size_t& i) -> ValueType
+    {
+      return MinmodSlope<T>::calculate(U_ro_[i][cid_m], U_ro_[i][cid_c],
+				       U_ro_[i][cid_p], theta_, ds);
+    };
+
+    return { zb_ro_[0][cid_c], static_cast<ValueType>(dzb_ro_[D][cid_c]),
+	     U_ro_[0][cid_c], slope(0),
+	     U_ro_[1 + D][cid_c], slope(1 + D),
+	     U_ro_[2 - D][cid_c], slope(2 - D) };
+  }
+
+  // Calculate the flux across the face in the D-direction between two
+  // cells. has_lhs and has_rhs are false if that cell is off the edge
+  // of the mesh.
+  template<int D>
+  FaceFluxType get_face_flux(IndexType lhs_idx, const bool& has_lhs,
+			     IndexType rhs_idx, const bool& has_rhs) const
+  {
+    int edge = 0; // -1 if the LHS cell is "fake", 1 if the RHS cell
+		  // is fake
+    if (not has_lhs) {
+      lhs_idx = rhs_idx;
+      edge = -1;
+    } else if (not has_rhs) {
+      rhs_idx = lhs_idx;
+      edge = 1;
+    }
+
+    // Check cell bed levels for NaN--meaning the cell is excluded
+    // from calculation. If we find one, use the same set-up as a mesh
+    // edge. If we find two, just return zero flux.
+    BT zb_L = zb_ro_[0][mesh_.get_cell_linear_id(lhs_idx)];
+    BT zb_R = zb_ro_[0][mesh_.get_cell_linear_id(rhs_idx)];
+    if (zb_L != zb_L) {
+      lhs_idx = rhs_idx;
+      edge = -1;
+
+      if (zb_R != zb_R) {
+	return { 0.0f, 0.0f, 0.0f, 0.0f };
+      }
+    } else if (zb_R != zb_R) {
+      rhs_idx = lhs_idx;
+      edge = 1;
+    }
+
+    SideType L, R;
+    if (edge < 0) {
+      R = get_side<D>(rhs_idx);
+      L = FaceFlux::wall(R);
+    } else if (edge > 0) {
+      L = get_side<D>(lhs_idx);
+      R = FaceFlux::wall(L);
+    } else {
+      L = get_side<D>(lhs_idx);
+      R = get_side<D>(rhs_idx);
+    }
+
+    FaceFluxType F;
+    ValueType ds = mesh_.cell_size()[D];
+    FaceFlux::template calculate<D>(L, R, ds, F);
+    return F;
+  }
+
+public:
+
+  FusedSVCartesian2DMeshCellTemporalDerivativeKernel(sycl::handler& cgh,
+						     const CellStateVector<3>& U,
+						     const CellBedVector<1>& zb,
+						     const CellConstantVector<2>& dzb,
+						     const CellFoldableConstantVector<4>& n,
+						     const CellFoldableVector<2>& Q_in,
+						     const CellFoldableVector<2>& h_in,
+						     CellStateVector<3>& dUdt,
+						     const ValueType& theta,
+						     const StepClock<T>& clock,
+						     const double& stage,
+						     const double& bdy_t0,
+						     const double& bdy_t1,
+						     bool implicit_friction)
+    : mesh_(*(U.mesh_definition())),
+      U_ro_(U.get_read_accessor(cgh)),
+      zb_ro_(zb.get_read_accessor(cgh)),
+      dzb_ro_(dzb.get_read_accessor(cgh)),
+      n_ro_(n.get_reader(cgh)),
+      Q_in_ro_(Q_in.get_reader(cgh)),
+      h_in_ro_(h_in.get_reader(cgh)),
+      dUdt_wo_(dUdt.get_write_accessor(cgh)),
+      theta_(theta),
+      times_(clock.get_times(cgh, stage)),
+      bdy_t0_(bdy_t0), bdy_t1_(bdy_t1),
+      implicit_friction_(implicit_friction)
+  {}
+
+  // Launched over the cells with dimension 0 being the row (y-index)
+  // and dimension 1 the column (x-index), so the linear id of an item
+  // is the linear id of its cell.
+  static sycl::range<2> get_range(const MeshType& mesh)
+  {
+    return Region::get_range(mesh);
+  }
+
+  void operator()(sycl::item<2> item) const
+  {
+    auto ncells = mesh_.get_cell_index_size();
+    auto cidx = Region::cell_index(item, ncells[0], ncells[1]);
+    calculate(cidx[0], cidx[1]);
+  }
+
+  // Calculate dU/dt for the cell with (x, y) index (ci, cj)
+  void calculate(const size_t& ci, const size_t& cj) const
+  {
+    IndexType cidx = { ci, cj };
+    size_t cell_c = mesh_.get_cell_linear_id(cidx);
+
+    // Get the neighbouring cells
+    IndexType widx, eidx, sidx, nidx;
+    bool has_w = get_offset_cell<0>(cidx, -1, widx);
+    bool has_e = get_offset_cell<0>(cidx, 1, eidx);
+    bool has_s = get_offset_cell<1>(cidx, -1, sidx);
+    bool has_n = get_offset_cell<1>(cidx, 1, nidx);
+
+    // Calculate the fluxes across the W, E, S and N faces
+    typename SVCellTemporalDerivative<T,M>::FaceFluxes F = {
+      get_face_flux<0>(widx, has_w, cidx, true),
+      get_face_flux<0>(cidx, true, eidx, has_e),
+      get_face_flux<1>(sidx, has_s, cidx, true),
+      get_face_flux<1>(cidx, true, nidx, has_n)
+    };
+
+    // Get cell size
+    auto cell_size = mesh_.cell_size();
+    float dx = cell_size[0];
+    float dy = cell_size[1];
+
+    auto dUdt = SVCellTemporalDerivative<T,M>::calculate
+      (F,
+       { U_ro_[0][cell_c], U_ro_[1][cell_c], U_ro_[2][cell_c] },
+       { dzb_ro_[0][cell_c], dzb_ro_[1][cell_c] },
+       { n_ro_[0][cell_c], n_ro_[1][cell_c],
+	 n_ro_[2][cell_c], n_ro_[3][cell_c] },
+       { Q_in_ro_[0][cell_c], Q_in_ro_[1][cell_c] },
+       { h_in_ro_[0][cell_c], h_in_ro_[1][cell_c] },
+       dx, dy, times_.time_now(), times_.timestep(),
+       bdy_t0_, bdy_t1_, implicit_friction_);
+
+    dUdt_wo_[0][cell_c] = dUdt[0];
+    dUdt_wo_[1][cell_c] = dUdt[1];
+    dUdt_wo_[2][cell_c] = dUdt[2];
+  }
+
+};
+
+#endif
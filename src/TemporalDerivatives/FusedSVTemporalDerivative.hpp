@@ -0,0 +1,52 @@
+/***********************************************************************
+ * TemporalDerivatives/FusedSVTemporalDerivative.hpp
+ *
+ * Temporal derivative of the shallow water equations calculated in a
+ * single pass over the mesh, recomputing the slopes and face fluxes
+ * each cell needs rather than storing them in intermediate fields.
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef TemporalDerivatives_FusedSVTemporalDerivative_hpp
+#define TemporalDerivatives_FusedSVTemporalDerivative_hpp
+
+#include "../FieldVector.hpp"
+#include "../ActiveTileSet.hpp"
+#include "../StepClock.hpp"
+
+template<typename T,
+	 typename MeshType,
+	 FieldMapping FM,
+	 size_t N,
+	 FieldStorage FS = FieldStorage::Separate,
+	 typename CT = T,
+	 typename BT = T>
+class FusedSVTemporalDerivative
+{
+public:
+  
+  FusedSVTemporalDerivative(const std::shared_ptr<ActiveTileSet<MeshType>>& active_tiles = nullptr)
+  {}
+
+  virtual ~FusedSVTemporalDerivative(void)
+  {}
+
+  virtual void calculate(const FieldVector<T,MeshType,FM,N,FS>& U,
+			 const FieldVector<BT,MeshType,FieldMapping::Cell,1>& zb,
+			 const FieldVector<CT,MeshType,FieldMapping::Cell,2>& dzb,
+			 const FoldableFieldVector<CT,MeshType,FieldMapping::Cell,4>& n,
+			 const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& Q_in,
+			 const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& h_in,
+			 FieldVector<T,MeshType,FM,N,FS>& dUdt,
+			 const StepClock<T>& clock, const double& stage,
+			 const double& bdy_t0, const double& bdy_t1) const
+  {
+    throw std::logic_error("This type of fused temporal derivative is not implemented.");
+  }
+    
+};
+
+#include "FusedSV/Cartesian2DMeshCell.hpp"
+
+#endif
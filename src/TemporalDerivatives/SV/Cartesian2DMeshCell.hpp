@@ -8,43 +8,138 @@
 #define TemporalDerivatives_SV_Cartesian2DMeshCell_hpp
 
 #include "Kernels/Cartesian2DMeshCellKernel.hpp"
+#include "Kernels/Cartesian2DMeshCellLocalTimestepKernel.hpp"
 
-template<typename T>
+template<typename T, FieldStorage FS, typename CT, typename BT>
 class SVTemporalDerivative<T, Cartesian2DMesh,
-		     FieldMapping::Cell, 3>
+		     FieldMapping::Cell, 3, FS, CT, BT>
   : public TemporalDerivative<T, Cartesian2DMesh,
-			FieldMapping::Cell, 3>
+			FieldMapping::Cell, 3, FS, CT, BT>
 {
 public:
 
   using MeshType = Cartesian2DMesh;
   static const FieldMapping FM = FieldMapping::Cell;
   static const size_t N = 3;
+
+private:
+
+  // Tiles to calculate; null to calculate the whole mesh.
+  std::shared_ptr<ActiveTileSet<MeshType>> active_tiles_;
+
+  // Use FastMath rather than ExactMath (see MathProfile.hpp)
+  bool fast_math_;
+
+  // Take the friction point-implicitly (see
+  // Kernels/SVCellTemporalDerivative.hpp)
+  bool implicit_friction_;
   
 public:
   
-  SVTemporalDerivative(void)
-    : TemporalDerivative<T, MeshType, FM, N>()
+  SVTemporalDerivative(const std::shared_ptr<ActiveTileSet<MeshType>>& active_tiles = nullptr,
+		       bool fast_math = false,
+		       bool implicit_friction = false)
+    : TemporalDerivative<T, MeshType, FM, N, FS, CT, BT>(),
+      active_tiles_(active_tiles),
+      fast_math_(fast_math),
+      implicit_friction_(implicit_friction)
   {}
 
   virtual ~SVTemporalDerivative(void)
   {}
 
-  virtual void calculate(const FieldVector<T,MeshType,FM,N>& U,
-			 const FieldVector<T,MeshType,FieldMapping::Cell,3>& zb,
-			 const FieldVector<T,MeshType,FieldMapping::Cell,4>& n,
-			 const FieldVector<T,MeshType,FieldMapping::Cell,2>& Q_in,
-			 const FieldVector<T,MeshType,FieldMapping::Cell,2>& h_in,
-			 const FieldVector<T,MeshType,FieldMapping::Face,4>& flux,
-			 FieldVector<T,MeshType,FM,N>& dUdt,
-			 const double& time_now, const double& timestep,
+  virtual void calculate(const FieldVector<T,MeshType,FM,N,FS>& U,
+			 const FieldVector<BT,MeshType,FieldMapping::Face,3>& zf,
+			 const FieldVector<CT,MeshType,FieldMapping::Cell,2>& dzb,
+			 const FoldableFieldVector<CT,MeshType,FieldMapping::Cell,4>& n,
+			 const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& Q_in,
+			 const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& h_in,
+			 const FieldVector<T,MeshType,FieldMapping::Face,3,FS>& flux,
+			 FieldVector<T,MeshType,FM,N,FS>& dUdt,
+			 const StepClock<T>& clock, const double& stage,
 			 const double& bdy_t0, const double& bdy_t1) const
+  {
+    if (fast_math_) {
+      submit<FastMath,false>(U, zf, dzb, n, Q_in, h_in, flux, dUdt,
+			     clock, stage, bdy_t0, bdy_t1, nullptr);
+    } else {
+      submit<ExactMath,false>(U, zf, dzb, n, Q_in, h_in, flux, dUdt,
+			      clock, stage, bdy_t0, bdy_t1, nullptr);
+    }
+  }
+
+  virtual void calculate_and_combine(FieldVector<T,MeshType,FM,N,FS>& U,
+				     const FieldVector<BT,MeshType,FieldMapping::Face,3>& zf,
+				     const FieldVector<CT,MeshType,FieldMapping::Cell,2>& dzb,
+				     const FoldableFieldVector<CT,MeshType,FieldMapping::Cell,4>& n,
+				     const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& Q_in,
+				     const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& h_in,
+				     const FieldVector<T,MeshType,FieldMapping::Face,3,FS>& flux,
+				     FieldVector<T,MeshType,FM,N,FS>& dUdt,
+				     const StepClock<T>& clock, const double& stage,
+				     const double& bdy_t0, const double& bdy_t1,
+				     const StageCombination<T,MeshType,FM,N,FS>& next_stage) const
+  {
+    if (fast_math_) {
+      submit<FastMath,true>(U, zf, dzb, n, Q_in, h_in, flux, dUdt,
+			    clock, stage, bdy_t0, bdy_t1, &next_stage);
+    } else {
+      submit<ExactMath,true>(U, zf, dzb, n, Q_in, h_in, flux, dUdt,
+			     clock, stage, bdy_t0, bdy_t1, &next_stage);
+    }
+  }
+
+  virtual void calculate_and_accumulate(const FieldVector<T,MeshType,FM,N,FS>& U,
+					const FieldVector<BT,MeshType,FieldMapping::Face,3>& zf,
+					const FieldVector<CT,MeshType,FieldMapping::Cell,2>& dzb,
+					const FoldableFieldVector<CT,MeshType,FieldMapping::Cell,4>& n,
+					const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& Q_in,
+					const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& h_in,
+					const FieldVector<T,MeshType,FieldMapping::Face,3,FS>& flux,
+					FieldVector<T,MeshType,FM,N,FS>& dQ,
+					const StepClock<T>& clock, const double& stage,
+					const double& bdy_t0, const double& bdy_t1,
+					const double& A) const
+  {
+    if (fast_math_) {
+      submit<FastMath,false,true>(U, zf, dzb, n, Q_in, h_in, flux, dQ,
+				  clock, stage, bdy_t0, bdy_t1, nullptr, A);
+    } else {
+      submit<ExactMath,false,true>(U, zf, dzb, n, Q_in, h_in, flux, dQ,
+				   clock, stage, bdy_t0, bdy_t1, nullptr, A);
+    }
+  }
+
+private:
+
+  // Launch the kernel, which also forms the next stage in U if
+  // Combine, or accumulates into dUdt if Accumulate
+  template<typename M, bool Combine, bool Accumulate = false>
+  void submit(std::conditional_t<Combine,
+	                         FieldVector<T,MeshType,FM,N,FS>&,
+	                         const FieldVector<T,MeshType,FM,N,FS>&> U,
+	      const FieldVector<BT,MeshType,FieldMapping::Face,3>& zf,
+	      const FieldVector<CT,MeshType,FieldMapping::Cell,2>& dzb,
+	      const FoldableFieldVector<CT,MeshType,FieldMapping::Cell,4>& n,
+	      const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& Q_in,
+	      const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& h_in,
+	      const FieldVector<T,MeshType,FieldMapping::Face,3,FS>& flux,
+	      FieldVector<T,MeshType,FM,N,FS>& dUdt,
+	      const StepClock<T>& clock, const double& stage,
+	      const double& bdy_t0, const double& bdy_t1,
+	      const StageCombination<T,MeshType,FM,N,FS>* next_stage,
+	      const double& A = 0.0) const
   {
     // Update dU/dx and dU/dy
-    U.at(0).queue().submit([&] (sycl::handler& cgh) {
-      auto kernel = SVCartesian2DMeshCellTemporalDerivativeKernel<T>(cgh, U, zb, n, Q_in, h_in, flux, dUdt, time_now, timestep, bdy_t0, bdy_t1);
+    U.queue().submit([&] (sycl::handler& cgh) {
+      using Kernel = SVCartesian2DMeshCellTemporalDerivativeKernel<T,FS,CT,BT,M,Combine,Accumulate>;
+      auto kernel = Kernel(cgh, U, zf, dzb, n, Q_in, h_in, flux, dUdt, clock, stage, bdy_t0, bdy_t1, implicit_friction_, next_stage, A);
       
-      cgh.parallel_for(dUdt.get_range(), kernel);
+      if (active_tiles_) {
+	active_tiles_->parallel_for_cells(cgh, kernel);
+      } else {
+	cgh.parallel_for(Kernel::get_range(*(U.mesh_definition())), kernel);
+      }
     });
   }
 };
@@ -7,208 +7,269 @@
 #ifndef TemporalDerivatives_SV_Kernels_Cartesian2DMeshCellKernel_hpp
 #define TemporalDerivatives_SV_Kernels_Cartesian2DMeshCellKernel_hpp
 
-template<typename T>
+#include "SVCellTemporalDerivative.hpp"
+#include "../../../FluxFunctions/SV/Kernels/SVFaceBed.hpp"
+
+// With Combine, the kernel also forms the state of the next Runge-Kutta
+// stage from the dU/dt it calculates (see StageCombination in
+// TemporalDerivative.hpp), writing it over U. Each cell only reads its
+// own U, so it can be overwritten in place.
+//
+// With Accumulate, the kernel instead adds the dU/dt it calculates to
+// the register of a low-storage Runge-Kutta scheme held in dUdt,
+//
+//   dQ = A dQ + Δt dU/dt,
+//
+// (see TemporalSchemes/LowStorageRungeKutta.hpp), so that the scheme
+// needs no separate state for dU/dt.
+template<typename T,
+	 FieldStorage FS = FieldStorage::Separate,
+	 typename CT = T,
+	 typename BT = T,
+	 typename M = ExactMath,
+	 bool Combine = false,
+	 bool Accumulate = false>
 class SVCartesian2DMeshCellTemporalDerivativeKernel
 {
+  static_assert(not (Combine and Accumulate),
+		"A stage cannot be both combined and accumulated");
+
 protected:
 
   using ValueType = T;
   using MeshType = Cartesian2DMesh;
 
+  // Bed slopes and roughness, which may be stored with a narrower type
+  template<size_t N>
+  using CellConstantVector = FieldVector<CT,MeshType,FieldMapping::Cell,N>;
+
+  // Roughness and boundary inflows, which may each be folded into one
+  // value per component (see FieldVectors/FoldableFieldVector.hpp)
   template<size_t N>
-  using CellFieldVector = FieldVector<T,MeshType,FieldMapping::Cell,N>;
+  using CellFoldableVector = FoldableFieldVector<T,MeshType,FieldMapping::Cell,N>;
 
   template<size_t N>
-  using FaceFieldVector = FieldVector<T,MeshType,FieldMapping::Face,N>;
+  using CellFoldableConstantVector = FoldableFieldVector<CT,MeshType,FieldMapping::Cell,N>;
 
-  MeshType mesh_;
+  template<size_t N>
+  using CellStateVector = FieldVector<T,MeshType,FieldMapping::Cell,N,FS>;
+
+  template<size_t N>
+  using FaceStateVector = FieldVector<T,MeshType,FieldMapping::Face,N,FS>;
 
+  // Bed at the faces (see FluxFunctions/SV/Kernels/SVFaceBed.hpp)
   template<size_t N>
-  using ReadAccessor =
-    typename CellFieldVector<N>::template Accessor<sycl::access::mode::read>;
+  using FaceBedVector = FieldVector<BT,MeshType,FieldMapping::Face,N>;
+
+  template<size_t N>
+  using ReadFaceBedAccessor =
+    typename FaceBedVector<N>::template Accessor<sycl::access::mode::read>;
+
+  template<size_t N>
+  using ReadConstantAccessor =
+    typename CellConstantVector<N>::template Accessor<sycl::access::mode::read>;
+
+  template<size_t N>
+  using ReadStateAccessor =
+    typename CellStateVector<N>::template Accessor<sycl::access::mode::read>;
+
+  static constexpr sycl::access::mode StateMode =
+    (Combine ? sycl::access::mode::read_write : sycl::access::mode::read);
+
+  template<size_t N>
+  using StateAccessor =
+    typename CellStateVector<N>::template Accessor<StateMode>;
+
+  // The state is only written with Combine
+  using StateArgument = std::conditional_t<Combine,
+					   CellStateVector<3>&,
+					   const CellStateVector<3>&>;
+
+  using NextStage = StageCombination<T,MeshType,FieldMapping::Cell,3,FS>;
 
   template<size_t N>
   using ReadFluxAccessor =
-    typename FaceFieldVector<N>::template Accessor<sycl::access::mode::read>;
+    typename FaceStateVector<N>::template Accessor<sycl::access::mode::read>;
+
+  // Read-write with Accumulate, to add to the register in dUdt
+  static constexpr sycl::access::mode DerivativeMode =
+    (Accumulate ? sycl::access::mode::read_write : sycl::access::mode::write);
 
   template<size_t N>
-  using WriteAccessor =
-    typename CellFieldVector<N>::template Accessor<sycl::access::mode::write>;
-
-  ReadAccessor<3> U_ro_;
-  ReadAccessor<3> zb_ro_;
-  ReadAccessor<4> n_ro_;
-  ReadAccessor<2> Q_in_ro_;
-  ReadAccessor<2> h_in_ro_;
-  ReadFluxAccessor<4> F_ro_;
-  WriteAccessor<3> dUdt_wo_;
-
-  float time_now_;
-  float timestep_;
+  using DerivativeAccessor =
+    typename CellStateVector<N>::template Accessor<DerivativeMode>;
+
+  // Read-write with Combine, to write the next stage over U
+  StateAccessor<3> U_acc_;
+  ReadFaceBedAccessor<3> zf_ro_;
+  ReadConstantAccessor<2> dzb_ro_;
+  typename CellFoldableConstantVector<4>::Reader n_ro_;
+  typename CellFoldableVector<2>::Reader Q_in_ro_;
+  typename CellFoldableVector<2>::Reader h_in_ro_;
+  ReadFluxAccessor<3> F_ro_;
+  DerivativeAccessor<3> dUdt_acc_;
+
+  typename StepClock<T>::Times times_;
   float bdy_t0_;
   float bdy_t1_;
+  bool implicit_friction_;
+
+  // The state at the start of the step, the dU/dt of the earlier
+  // stages and the coefficients of the next stage (Combine only)
+  ReadStateAccessor<3> U0_ro_;
+  std::array<ReadStateAccessor<3>, NextStage::MaxTerms-1> dUdt_ro_;
+  std::array<ValueType, NextStage::MaxTerms> a_;
+  uint32_t terms_;
+
+  // Coefficient of the register (Accumulate only)
+  ValueType A_;
+
+  size_t nx_;
+  size_t x_face_count_;
+  float dx_;
+  float dy_;
 
 public:
 
   SVCartesian2DMeshCellTemporalDerivativeKernel(sycl::handler& cgh,
-						const CellFieldVector<3>& U,
-						const CellFieldVector<3>& zb,
-						const CellFieldVector<4>& n,
-						const CellFieldVector<2>& Q_in,
-						const CellFieldVector<2>& h_in,
-						const FaceFieldVector<4>& flux,
-						CellFieldVector<3>& dUdt,
-						const double& time_now,
-						const double& timestep,
+						StateArgument U,
+						const FaceBedVector<3>& zf,
+						const CellConstantVector<2>& dzb,
+						const CellFoldableConstantVector<4>& n,
+						const CellFoldableVector<2>& Q_in,
+						const CellFoldableVector<2>& h_in,
+						const FaceStateVector<3>& flux,
+						CellStateVector<3>& dUdt,
+						const StepClock<T>& clock,
+						const double& stage,
 						const double& bdy_t0,
-						const double& bdy_t1)
-    : mesh_(*(U.mesh_definition())),
-      U_ro_(U.get_read_accessor(cgh)),
-      zb_ro_(zb.get_read_accessor(cgh)),
-      n_ro_(n.get_read_accessor(cgh)),
-      Q_in_ro_(Q_in.get_read_accessor(cgh)),
-      h_in_ro_(h_in.get_read_accessor(cgh)),
+						const double& bdy_t1,
+						bool implicit_friction,
+						const NextStage* next_stage = nullptr,
+						const double& A = 0.0)
+    : U_acc_(U.template get_accessor<StateMode>(cgh)),
+      zf_ro_(zf.get_read_accessor(cgh)),
+      dzb_ro_(dzb.get_read_accessor(cgh)),
+      n_ro_(n.get_reader(cgh)),
+      Q_in_ro_(Q_in.get_reader(cgh)),
+      h_in_ro_(h_in.get_reader(cgh)),
       F_ro_(flux.get_read_accessor(cgh)),
-      dUdt_wo_(dUdt.get_write_accessor(cgh)),
-      time_now_(time_now),
-      timestep_(timestep),
-      bdy_t0_(bdy_t0), bdy_t1_(bdy_t1)
-  {}
-
-  void operator()(sycl::item<1> item) const
+      dUdt_acc_(dUdt.template get_accessor<DerivativeMode>(cgh)),
+      times_(clock.get_times(cgh, stage)),
+      bdy_t0_(bdy_t0), bdy_t1_(bdy_t1),
+      implicit_friction_(implicit_friction),
+      U0_ro_(), dUdt_ro_(), a_(), terms_(0), A_(A),
+      nx_(U.mesh_definition()->get_cell_index_size()[0]),
+      x_face_count_(U.mesh_definition()->x_face_count()),
+      dx_(U.mesh_definition()->cell_size()[0]),
+      dy_(U.mesh_definition()->cell_size()[1])
   {
-    size_t cell_c = item.get_linear_id();
-
-    // Get the IDs of the surrounding faces
-    auto cell_index = mesh_.get_cell_index(cell_c);
-    auto face_list = mesh_.get_faces_around_cell(cell_index);
-    size_t fid_W = face_list[0];
-    size_t fid_E = face_list[1];
-    size_t fid_S = face_list[2];
-    size_t fid_N = face_list[3];
-
-    // Get cell size
-    auto cell_size = mesh_.cell_size();
-    float dx = cell_size[0];
-    float dy = cell_size[1];
-
-    // Calculate the raw changes in variable from the cell face fluxes
-    float dhdt = (F_ro_[0][fid_W] - F_ro_[0][fid_E]) / dx
-      + (F_ro_[0][fid_S] - F_ro_[0][fid_N]) / dy;
-    float dudt = (F_ro_[1][fid_W] - F_ro_[1][fid_E]) / dx
-      + (F_ro_[1][fid_S] - F_ro_[1][fid_N]) / dy;
-    float dvdt = (F_ro_[2][fid_W] - F_ro_[2][fid_E]) / dx
-      + (F_ro_[2][fid_S] - F_ro_[2][fid_N]) / dy;
-
-    // Get the cell bed-slopes (pre-calculated) and apply gravity
-    // forces as a source term. The magnitude of the horizontal force
-    // due to the bed slope is limited to gh.
-    float dzdx = zb_ro_[1][cell_c];
-    if (sycl::fabs(dzdx) > U_ro_[0][cell_c] / dx) {
-      dzdx = sycl::sign(dzdx) * U_ro_[0][cell_c] / dx;
-    }
-    float dzdy = zb_ro_[2][cell_c];
-    if (sycl::fabs(dzdy) > U_ro_[0][cell_c] / dy) {
-      dzdy = sycl::sign(dzdy) * U_ro_[0][cell_c] / dy;
-    }
-    float dudt_bed = -9.81f * dzdx;
-    float dvdt_bed = -9.81f * dzdy;
-
-    // Calculate the forces on the water in the cell due to vertical
-    // walls at the cell faces and apply as a source term. The
-    // magnitude of the force is limited by the cell water depth (so
-    // only the portion of the wall that is wet affects the water)
-    if (F_ro_[3][fid_W] < 0.0f)
-      dudt_bed += -9.81f * sycl::fmax(F_ro_[3][fid_W], -U_ro_[0][cell_c]) / dx;
-    if (F_ro_[3][fid_E] > 0.0f)
-      dudt_bed += -9.81f * sycl::fmin(F_ro_[3][fid_E], U_ro_[0][cell_c]) / dx;
-    if (F_ro_[3][fid_S] < 0.0f)
-      dvdt_bed += -9.81f * sycl::fmax(F_ro_[3][fid_S], -U_ro_[0][cell_c]) / dy;
-    if (F_ro_[3][fid_N] > 0.0f)
-      dvdt_bed += -9.81f * sycl::fmin(F_ro_[3][fid_N], U_ro_[0][cell_c]) / dy;
-    dudt += dudt_bed;
-    dvdt += dvdt_bed;
-
-    // Calculate volume inflows from flow boundaries...
-    float dhdt_source = 0.0;
-    {
-      float Q_0 = Q_in_ro_[0][cell_c];
-      float Q_1 = Q_in_ro_[1][cell_c];
-      float dQ_dt = (Q_1 - Q_0) / (bdy_t1_ - bdy_t0_);
-      float Q_now = Q_0 + (time_now_ - bdy_t0_) * dQ_dt;
-      float Q_next = Q_now + timestep_ * dQ_dt;
-      dhdt_source = 0.5f * (Q_now + Q_next) / (dx * dy);
-      //      std::cout << timestep_ << "\t" << Q_0 << "\t"
-      //	<< Q_1 << "\t" << dhdt_source << std::endl;
-    }
-    // ...and from water level boundaries
-    float h_boundary = 0.0;
-    {
-      float h_0 = h_in_ro_[0][cell_c];
-      if (h_0 < 0.0f) {
-	h_boundary = -1.0f;
-      } else {
-	float h_1 = h_in_ro_[1][cell_c];
-	float dh_dt = (h_1 - h_0) / (bdy_t1_ - bdy_t0_);
-	float h_now = h_0 + (time_now_ - bdy_t0_) * dh_dt;
-	float h_next = h_now + timestep_ * dh_dt;
-	h_boundary = 0.5f * (h_now + h_next);
+    if constexpr (Combine) {
+      U0_ro_ = next_stage->U->get_read_accessor(cgh);
+      for (size_t i = 0; i + 1 < next_stage->terms; ++i) {
+	dUdt_ro_[i] = next_stage->dUdt[i]->get_read_accessor(cgh);
+      }
+      for (size_t i = 0; i < next_stage->terms; ++i) {
+	a_[i] = next_stage->a[i];
       }
+      terms_ = next_stage->terms;
     }
+  }
 
-    // If there is a water level boundary here, over-ride the
-    // calculated change in water level with one that will satisfy
-    // that boundary
-    if (h_boundary >= 0.0f) {
-      dhdt = (h_boundary - U_ro_[0][cell_c]);
-    } else {
-      // Otherwise, add in any contributions from flow boundaries
-      dhdt += dhdt_source;
-      //std::cout << "dhdt = " << dhdt << std::endl;
-    }
+  // Launched over the cells with dimension 0 being the row (y-index)
+  // and dimension 1 the column (x-index), so the linear id of an item
+  // is the linear id of its cell.
+  static sycl::range<2> get_range(const MeshType& mesh)
+  {
+    auto ncells = mesh.get_cell_index_size();
+    return sycl::range<2>(ncells[1], ncells[0]);
+  }
 
-    // Calculate the Manning's n value for the cell...
-    float manning_n = sycl::mix(n_ro_[0][cell_c], n_ro_[2][cell_c],
-				sycl::smoothstep(n_ro_[1][cell_c],
-						 n_ro_[3][cell_c],
-						 U_ro_[0][cell_c]));
-    // ...and hence the friction slope terms:
-    float sf = 0.0f;
-    if (U_ro_[0][cell_c] > 1e-6) {
-      float inv_h = U_ro_[0][cell_c]
-	/ (U_ro_[0][cell_c] * U_ro_[0][cell_c] + 1e-3);
-      sf = manning_n * manning_n
-	* sycl::sqrt(U_ro_[1][cell_c] * U_ro_[1][cell_c] +
-		     U_ro_[2][cell_c] * U_ro_[2][cell_c])
-	* sycl::pow(inv_h, 1.333333f);
-    }
+  void operator()(sycl::item<2> item) const
+  {
+    calculate(item.get_id(1), item.get_id(0));
+  }
 
-    // Apply the friction slopes to the du/dt and dv/dt terms, but
-    // prevent the friction force being so strong as to push the water
-    // backwards
-    float u_estimate = U_ro_[1][cell_c] + dudt * 0.5f * timestep_;
-    float dudt_f = 9.81f * sf * U_ro_[1][cell_c];
-    if ((sycl::sign(dudt_f) == sycl::sign(u_estimate)) and
-	(sycl::fabs(dudt_f) > sycl::fabs(u_estimate))) {
-      dudt_f = u_estimate;
-    } else if (sycl::sign(dudt_f) == sycl::sign(u_estimate)) {
-      dudt_f = 0.0f;
+  // Calculate dU/dt for the cell with (x, y) index (ci, cj)
+  void calculate(const size_t& ci, const size_t& cj) const
+  {
+    size_t cell_c = cj * nx_ + ci;
+
+    // Get the IDs of the surrounding faces. Each row of x-faces has
+    // one more face than the row of cells.
+    size_t fid_W = cell_c + cj;
+    size_t fid_E = fid_W + 1;
+    size_t fid_S = x_face_count_ + cell_c;
+    size_t fid_N = fid_S + nx_;
+
+    std::array<ValueType,3> U =
+      { U_acc_[0][cell_c], U_acc_[1][cell_c], U_acc_[2][cell_c] };
+
+    // Gather the fluxes across the cell faces and the steps in bed
+    // level at them
+    typename SVCellTemporalDerivative<T,M>::FaceFluxes F;
+    for (size_t i = 0; i < 3; ++i) {
+      F[0][i] = F_ro_[i][fid_W];
+      F[1][i] = F_ro_[i][fid_E];
+      F[2][i] = F_ro_[i][fid_S];
+      F[3][i] = F_ro_[i][fid_N];
     }
-    dudt -= dudt_f;
-
-    float v_estimate = U_ro_[2][cell_c] + dvdt * 0.5f * timestep_;
-    float dvdt_f = 9.81f * sf * U_ro_[2][cell_c];
-    if ((sycl::sign(dvdt_f) == sycl::sign(v_estimate)) and
-	(sycl::fabs(dvdt_f) > sycl::fabs(v_estimate))) {
-      dvdt_f = v_estimate;
-    } else if (sycl::sign(dvdt_f) == sycl::sign(v_estimate)) {
-      dvdt_f = 0.0f;
+    F[0][3] = SVFaceBed<BT>::step(zf_ro_, fid_W, U[0]);
+    F[1][3] = SVFaceBed<BT>::step(zf_ro_, fid_E, U[0]);
+    F[2][3] = SVFaceBed<BT>::step(zf_ro_, fid_S, U[0]);
+    F[3][3] = SVFaceBed<BT>::step(zf_ro_, fid_N, U[0]);
+
+    auto dUdt = SVCellTemporalDerivative<T,M>::calculate
+      (F, U,
+       { dzb_ro_[0][cell_c], dzb_ro_[1][cell_c] },
+       { n_ro_[0][cell_c], n_ro_[1][cell_c],
+	 n_ro_[2][cell_c], n_ro_[3][cell_c] },
+       { Q_in_ro_[0][cell_c], Q_in_ro_[1][cell_c] },
+       { h_in_ro_[0][cell_c], h_in_ro_[1][cell_c] },
+       dx_, dy_, times_.time_now(), times_.timestep(),
+       bdy_t0_, bdy_t1_, implicit_friction_);
+
+    if constexpr (Accumulate) {
+      // As LowStorageStep in TemporalSchemes/LowStorageRungeKutta.hpp.
+      // The first stage has A = 0 and does not read dQ, which is left
+      // over from the last step.
+      ValueType timestep = times_.timestep();
+      for (size_t i = 0; i < 3; ++i) {
+	ValueType dQ = timestep * dUdt[i];
+	if (A_ != (ValueType) 0.0) {
+	  dQ += A_ * dUdt_acc_[i][cell_c];
+	}
+	dUdt_acc_[i][cell_c] = dQ;
+      }
+    } else {
+      dUdt_acc_[0][cell_c] = dUdt[0];
+      dUdt_acc_[1][cell_c] = dUdt[1];
+      dUdt_acc_[2][cell_c] = dUdt[2];
     }
-    dvdt -= dvdt_f;
 
-    dUdt_wo_[0][cell_c] = dhdt;
-    dUdt_wo_[1][cell_c] = dudt;
-    dUdt_wo_[2][cell_c] = dvdt;
+    if constexpr (Combine) {
+      // As RungeKuttaStep in TemporalSchemes/RungeKutta.hpp
+      ValueType timestep = times_.timestep();
+      std::array<ValueType,3> Ustar;
+      for (size_t i = 0; i < 3; ++i) {
+	Ustar[i] = U0_ro_[i][cell_c]
+	  + timestep * a_[terms_ - 1] * dUdt[i];
+	for (uint32_t j = 0; j + 1 < terms_; ++j) {
+	  Ustar[i] += timestep * a_[j] * dUdt_ro_[j][i][cell_c];
+	}
+      }
+
+      if (Ustar[0] < 0.0) {
+	Ustar = { 0.0, 0.0, 0.0 };
+      } else if (Ustar[0] < 1e-4) {
+	Ustar[1] = 0.0;
+	Ustar[2] = 0.0;
+      }
+
+      U_acc_[0][cell_c] = Ustar[0];
+      U_acc_[1][cell_c] = Ustar[1];
+      U_acc_[2][cell_c] = Ustar[2];
+    }
   }
   
 };
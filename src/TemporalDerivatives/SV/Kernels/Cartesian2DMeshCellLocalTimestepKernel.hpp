@@ -0,0 +1,225 @@
+/***********************************************************************
+ * TemporalDerivatives/SV/Kernels/Cartesian2DMeshCellLocalTimestepKernel.hpp
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef TemporalDerivatives_SV_Kernels_Cartesian2DMeshCellLocalTimestepKernel_hpp
+#define TemporalDerivatives_SV_Kernels_Cartesian2DMeshCellLocalTimestepKernel_hpp
+
+#include "SVCellTemporalDerivative.hpp"
+#include "../../../FluxFunctions/SV/Kernels/SVFaceBed.hpp"
+
+// One sub-step of a local time stepping cycle (see
+// TemporalSchemes/LocalTimestep.hpp) for a single cell. The cycle,
+// of the length held by the clock, is divided into 2^max_level
+// sub-steps and a cell at level k takes steps of 2^k of them.
+//
+// A face takes steps at the level of the finer of the cells either
+// side. At each sub-step on which one of its faces starts a step, the
+// cell adds the flux terms of that face times the face's time step to
+// its accumulator; both cells either side add the same amount, so
+// mass is conserved across changes of level. At the sub-step on which
+// the cell finishes its own step, the accumulated flux terms and the
+// source terms over that step are applied to U in place and the
+// accumulator is cleared.
+template<typename T,
+	 FieldStorage FS = FieldStorage::Separate,
+	 typename CT = T,
+	 typename BT = T,
+	 typename M = ExactMath>
+class SVCartesian2DMeshCellLocalTimestepKernel
+{
+protected:
+
+  using ValueType = T;
+  using MeshType = Cartesian2DMesh;
+
+  // Bed slopes and roughness, which may be stored with a narrower type
+  template<size_t N>
+  using CellConstantVector = FieldVector<CT,MeshType,FieldMapping::Cell,N>;
+
+  // Roughness and boundary inflows, which may each be folded into one
+  // value per component (see FieldVectors/FoldableFieldVector.hpp)
+  template<size_t N>
+  using CellFoldableVector = FoldableFieldVector<T,MeshType,FieldMapping::Cell,N>;
+
+  template<size_t N>
+  using CellFoldableConstantVector = FoldableFieldVector<CT,MeshType,FieldMapping::Cell,N>;
+
+  template<size_t N>
+  using CellStateVector = FieldVector<T,MeshType,FieldMapping::Cell,N,FS>;
+
+  template<size_t N>
+  using FaceStateVector = FieldVector<T,MeshType,FieldMapping::Face,N,FS>;
+
+  // Bed at the faces (see FluxFunctions/SV/Kernels/SVFaceBed.hpp)
+  template<size_t N>
+  using FaceBedVector = FieldVector<BT,MeshType,FieldMapping::Face,N>;
+
+  template<size_t N>
+  using ReadFaceBedAccessor =
+    typename FaceBedVector<N>::template Accessor<sycl::access::mode::read>;
+
+  template<size_t N>
+  using ReadConstantAccessor =
+    typename CellConstantVector<N>::template Accessor<sycl::access::mode::read>;
+
+  template<size_t N>
+  using ReadWriteStateAccessor =
+    typename CellStateVector<N>::template Accessor<sycl::access::mode::read_write>;
+
+  template<size_t N>
+  using ReadFluxAccessor =
+    typename FaceStateVector<N>::template Accessor<sycl::access::mode::read>;
+
+  ReadWriteStateAccessor<3> U_rw_;
+  ReadWriteStateAccessor<3> acc_rw_;
+  ReadFaceBedAccessor<3> zf_ro_;
+  ReadConstantAccessor<2> dzb_ro_;
+  typename CellFoldableConstantVector<4>::Reader n_ro_;
+  typename CellFoldableVector<2>::Reader Q_in_ro_;
+  typename CellFoldableVector<2>::Reader h_in_ro_;
+  ReadFluxAccessor<3> F_ro_;
+
+  Cartesian2DMeshTileLevelMap levels_;
+  typename StepClock<T>::Times times_;
+  uint32_t substep_;
+  uint32_t max_level_;
+  float bdy_t0_;
+  float bdy_t1_;
+  bool implicit_friction_;
+
+  size_t nx_;
+  size_t ny_;
+  size_t x_face_count_;
+  float dx_;
+  float dy_;
+
+public:
+
+  SVCartesian2DMeshCellLocalTimestepKernel(sycl::handler& cgh,
+					   CellStateVector<3>& U,
+					   CellStateVector<3>& acc,
+					   const FaceBedVector<3>& zf,
+					   const CellConstantVector<2>& dzb,
+					   const CellFoldableConstantVector<4>& n,
+					   const CellFoldableVector<2>& Q_in,
+					   const CellFoldableVector<2>& h_in,
+					   const FaceStateVector<3>& flux,
+					   const Cartesian2DMeshTileLevelMap& levels,
+					   const StepClock<T>& clock,
+					   const size_t& substep,
+					   const size_t& max_level,
+					   const double& bdy_t0,
+					   const double& bdy_t1,
+					   bool implicit_friction)
+    : U_rw_(U.template get_accessor<sycl::access::mode::read_write>(cgh)),
+      acc_rw_(acc.template get_accessor<sycl::access::mode::read_write>(cgh)),
+      zf_ro_(zf.get_read_accessor(cgh)),
+      dzb_ro_(dzb.get_read_accessor(cgh)),
+      n_ro_(n.get_reader(cgh)),
+      Q_in_ro_(Q_in.get_reader(cgh)),
+      h_in_ro_(h_in.get_reader(cgh)),
+      F_ro_(flux.get_read_accessor(cgh)),
+      levels_(levels),
+      times_(clock.get_times(cgh)),
+      substep_(substep), max_level_(max_level),
+      bdy_t0_(bdy_t0), bdy_t1_(bdy_t1),
+      implicit_friction_(implicit_friction),
+      nx_(U.mesh_definition()->get_cell_index_size()[0]),
+      ny_(U.mesh_definition()->get_cell_index_size()[1]),
+      x_face_count_(U.mesh_definition()->x_face_count()),
+      dx_(U.mesh_definition()->cell_size()[0]),
+      dy_(U.mesh_definition()->cell_size()[1])
+  {}
+
+  // Update the cell with (x, y) index (ci, cj)
+  void calculate(const size_t& ci, const size_t& cj) const
+  {
+    size_t cell_c = cj * nx_ + ci;
+
+    size_t fid_W = cell_c + cj;
+    size_t fid_E = fid_W + 1;
+    size_t fid_S = x_face_count_ + cell_c;
+    size_t fid_N = fid_S + nx_;
+
+    // Levels of the W, E, S and N faces. The faces at the edge of the
+    // mesh take the level of the cell.
+    uint32_t k_c = levels_.level(ci, cj);
+    std::array<uint32_t,4> k_f = { k_c, k_c, k_c, k_c };
+    if (ci > 0) k_f[0] = sycl::min(k_c, levels_.level(ci - 1, cj));
+    if (ci + 1 < nx_) k_f[1] = sycl::min(k_c, levels_.level(ci + 1, cj));
+    if (cj > 0) k_f[2] = sycl::min(k_c, levels_.level(ci, cj - 1));
+    if (cj + 1 < ny_) k_f[3] = sycl::min(k_c, levels_.level(ci, cj + 1));
+    std::array<size_t,4> fid = { fid_W, fid_E, fid_S, fid_N };
+
+    double dt_fine = times_.timestep() / (1u << max_level_);
+
+    std::array<ValueType,3> U =
+      { U_rw_[0][cell_c], U_rw_[1][cell_c], U_rw_[2][cell_c] };
+    std::array<ValueType,3> acc =
+      { acc_rw_[0][cell_c], acc_rw_[1][cell_c], acc_rw_[2][cell_c] };
+
+    // Accumulate the flux terms of the faces starting a step
+    bool any_face = false;
+    for (size_t f = 0; f < 4; ++f) {
+      if (substep_ % (1u << k_f[f]) != 0) continue;
+      typename SVCellTemporalDerivative<T,M>::FaceFluxes F = {};
+      for (size_t i = 0; i < 3; ++i) {
+	F[f][i] = F_ro_[i][fid[f]];
+      }
+      F[f][3] = SVFaceBed<BT>::step(zf_ro_, fid[f], U[0]);
+      auto dUdt_f = SVCellTemporalDerivative<T,M>::flux_terms(F, U, dx_, dy_);
+      ValueType dt_f = dt_fine * (1u << k_f[f]);
+      acc[0] += dt_f * dUdt_f[0];
+      acc[1] += dt_f * dUdt_f[1];
+      acc[2] += dt_f * dUdt_f[2];
+      any_face = true;
+    }
+
+    if ((substep_ + 1) % (1u << k_c) != 0) {
+      if (any_face) {
+	acc_rw_[0][cell_c] = acc[0];
+	acc_rw_[1][cell_c] = acc[1];
+	acc_rw_[2][cell_c] = acc[2];
+      }
+      return;
+    }
+
+    // Finish the cell's step
+    ValueType dt_c = dt_fine * (1u << k_c);
+    double t_c = times_.time_now() + (substep_ + 1 - (1u << k_c)) * dt_fine;
+    auto dUdt = SVCellTemporalDerivative<T,M>::add_source_terms
+      ({ acc[0] / dt_c, acc[1] / dt_c, acc[2] / dt_c },
+       U,
+       { dzb_ro_[0][cell_c], dzb_ro_[1][cell_c] },
+       { n_ro_[0][cell_c], n_ro_[1][cell_c],
+	 n_ro_[2][cell_c], n_ro_[3][cell_c] },
+       { Q_in_ro_[0][cell_c], Q_in_ro_[1][cell_c] },
+       { h_in_ro_[0][cell_c], h_in_ro_[1][cell_c] },
+       dx_, dy_, t_c, dt_c, bdy_t0_, bdy_t1_, implicit_friction_);
+
+    U[0] += dt_c * dUdt[0];
+    U[1] += dt_c * dUdt[1];
+    U[2] += dt_c * dUdt[2];
+
+    // As at the end of each Runge-Kutta stage
+    if (U[0] < 0.0) {
+      U = { 0.0f, 0.0f, 0.0f };
+    } else if (U[0] < 1e-4) {
+      U[1] = 0.0f;
+      U[2] = 0.0f;
+    }
+
+    U_rw_[0][cell_c] = U[0];
+    U_rw_[1][cell_c] = U[1];
+    U_rw_[2][cell_c] = U[2];
+    acc_rw_[0][cell_c] = 0.0f;
+    acc_rw_[1][cell_c] = 0.0f;
+    acc_rw_[2][cell_c] = 0.0f;
+  }
+
+};
+
+#endif
@@ -0,0 +1,214 @@
+/***********************************************************************
+ * TemporalDerivatives/SV/Kernels/SVCellTemporalDerivative.hpp
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef TemporalDerivatives_SV_Kernels_SVCellTemporalDerivative_hpp
+#define TemporalDerivatives_SV_Kernels_SVCellTemporalDerivative_hpp
+
+#include "../../../MathProfile.hpp"
+
+// M is the math profile (see MathProfile.hpp)
+template<typename T, typename M = ExactMath>
+class SVCellTemporalDerivative
+{
+public:
+
+  using ValueType = T;
+  using Divisor = typename M::template Divisor<T>;
+
+  // Fluxes across the W, E, S and N faces of a cell. Each face flux
+  // is { h-flux, u-flux, v-flux, Δz }.
+  using FaceFluxes = std::array<std::array<ValueType,4>,4>;
+
+  // Calculate the rate of change of the cell state U = { h, u, v }
+  // from the fluxes across its faces and the source terms due to bed
+  // slope, friction and boundary inflows. With implicit_friction the
+  // friction is point-implicit over the time step (see
+  // add_source_terms()).
+  static std::array<ValueType,3> calculate(const FaceFluxes& F,
+					   const std::array<ValueType,3>& U,
+					   const std::array<ValueType,2>& dzb,
+					   const std::array<ValueType,4>& n,
+					   const std::array<ValueType,2>& Q_in,
+					   const std::array<ValueType,2>& h_in,
+					   const ValueType& dx,
+					   const ValueType& dy,
+					   const ValueType& time_now,
+					   const ValueType& timestep,
+					   const ValueType& bdy_t0,
+					   const ValueType& bdy_t1,
+					   const bool& implicit_friction)
+  {
+    return add_source_terms(flux_terms(F, U, dx, dy), U, dzb, n,
+			    Q_in, h_in, dx, dy, time_now, timestep,
+			    bdy_t0, bdy_t1, implicit_friction);
+  }
+
+  // The part of the rate of change of U due to the fluxes across the
+  // cell faces, including the forces from vertical walls at them. A
+  // face whose fluxes are all zero contributes nothing, so the terms
+  // of each face can be taken separately.
+  static std::array<ValueType,3> flux_terms(const FaceFluxes& F,
+					    const std::array<ValueType,3>& U,
+					    const ValueType& dx,
+					    const ValueType& dy)
+  {
+    Divisor by_dx(dx);
+    Divisor by_dy(dy);
+
+    // Calculate the raw changes in variable from the cell face fluxes
+    ValueType dhdt = by_dx(F[0][0] - F[1][0])
+      + by_dy(F[2][0] - F[3][0]);
+    ValueType dudt = by_dx(F[0][1] - F[1][1])
+      + by_dy(F[2][1] - F[3][1]);
+    ValueType dvdt = by_dx(F[0][2] - F[1][2])
+      + by_dy(F[2][2] - F[3][2]);
+
+    // Calculate the forces on the water in the cell due to vertical
+    // walls at the cell faces and apply as a source term. The
+    // magnitude of the force is limited by the cell water depth (so
+    // only the portion of the wall that is wet affects the water)
+    if (F[0][3] < 0.0f)
+      dudt += by_dx(-9.81f * sycl::fmax(F[0][3], -U[0]));
+    if (F[1][3] > 0.0f)
+      dudt += by_dx(-9.81f * sycl::fmin(F[1][3], U[0]));
+    if (F[2][3] < 0.0f)
+      dvdt += by_dy(-9.81f * sycl::fmax(F[2][3], -U[0]));
+    if (F[3][3] > 0.0f)
+      dvdt += by_dy(-9.81f * sycl::fmin(F[3][3], U[0]));
+
+    return { dhdt, dudt, dvdt };
+  }
+
+  // Complete the rate of change of U from its flux terms (see
+  // flux_terms()) by adding the source terms due to bed slope,
+  // friction and boundary inflows over the given time step.
+  static std::array<ValueType,3> add_source_terms(const std::array<ValueType,3>& dUdt_flux,
+						  const std::array<ValueType,3>& U,
+						  const std::array<ValueType,2>& dzb,
+						  const std::array<ValueType,4>& n,
+						  const std::array<ValueType,2>& Q_in,
+						  const std::array<ValueType,2>& h_in,
+						  const ValueType& dx,
+						  const ValueType& dy,
+						  const ValueType& time_now,
+						  const ValueType& timestep,
+						  const ValueType& bdy_t0,
+						  const ValueType& bdy_t1,
+						  const bool& implicit_friction)
+  {
+    ValueType dhdt = dUdt_flux[0];
+    ValueType dudt = dUdt_flux[1];
+    ValueType dvdt = dUdt_flux[2];
+
+    // Get the cell bed-slopes (pre-calculated) and apply gravity
+    // forces as a source term. The magnitude of the horizontal force
+    // due to the bed slope is limited to gh.
+    Divisor by_dx(dx);
+    Divisor by_dy(dy);
+    ValueType dzdx = dzb[0];
+    ValueType dzdx_max = by_dx(U[0]);
+    if (sycl::fabs(dzdx) > dzdx_max) {
+      dzdx = sycl::sign(dzdx) * dzdx_max;
+    }
+    ValueType dzdy = dzb[1];
+    ValueType dzdy_max = by_dy(U[0]);
+    if (sycl::fabs(dzdy) > dzdy_max) {
+      dzdy = sycl::sign(dzdy) * dzdy_max;
+    }
+    dudt += -9.81f * dzdx;
+    dvdt += -9.81f * dzdy;
+
+    // Calculate volume inflows from flow boundaries...
+    ValueType dhdt_source = 0.0;
+    {
+      ValueType Q_0 = Q_in[0];
+      ValueType Q_1 = Q_in[1];
+      ValueType dQ_dt = (Q_1 - Q_0) / (bdy_t1 - bdy_t0);
+      ValueType Q_now = Q_0 + (time_now - bdy_t0) * dQ_dt;
+      ValueType Q_next = Q_now + timestep * dQ_dt;
+      dhdt_source = Divisor(dx * dy)(0.5f * (Q_now + Q_next));
+    }
+    // ...and from water level boundaries
+    ValueType h_boundary = 0.0;
+    {
+      ValueType h_0 = h_in[0];
+      if (h_0 < 0.0f) {
+	h_boundary = -1.0f;
+      } else {
+	ValueType h_1 = h_in[1];
+	ValueType dh_dt = (h_1 - h_0) / (bdy_t1 - bdy_t0);
+	ValueType h_now = h_0 + (time_now - bdy_t0) * dh_dt;
+	ValueType h_next = h_now + timestep * dh_dt;
+	h_boundary = 0.5f * (h_now + h_next);
+      }
+    }
+
+    // If there is a water level boundary here, over-ride the
+    // calculated change in water level with one that will satisfy
+    // that boundary
+    if (h_boundary >= 0.0f) {
+      dhdt = (h_boundary - U[0]);
+    } else {
+      // Otherwise, add in any contributions from flow boundaries
+      dhdt += dhdt_source;
+    }
+
+    // Calculate the Manning's n value for the cell...
+    ValueType manning_n = sycl::mix(n[0], n[2],
+				    sycl::smoothstep(n[1], n[3], U[0]));
+    // ...and hence the friction slope terms:
+    ValueType sf = 0.0f;
+    if (U[0] > 1e-6) {
+      ValueType inv_h = U[0] / (U[0] * U[0] + 1e-3);
+      sf = manning_n * manning_n
+	* M::sqrt(U[1] * U[1] + U[2] * U[2])
+	* M::pow4_3(inv_h);
+    }
+
+    if (implicit_friction) {
+      // Take the friction at the velocity at the end of the time step,
+      // u' = u + Δt (du/dt - k u'), with k = g Sf / |u| at the start
+      // of it. However large kΔt is, u' lies between zero and the
+      // velocity without friction, so friction does not limit the
+      // time step.
+      ValueType k = 9.81f * sf;
+      ValueType damping = 1.0f + k * timestep;
+      dudt -= k * (U[1] + dudt * timestep) / damping;
+      dvdt -= k * (U[2] + dvdt * timestep) / damping;
+      return { dhdt, dudt, dvdt };
+    }
+
+    // Apply the friction slopes to the du/dt and dv/dt terms, but
+    // prevent the friction force being so strong as to push the water
+    // backwards
+    ValueType u_estimate = U[1] + dudt * 0.5f * timestep;
+    ValueType dudt_f = 9.81f * sf * U[1];
+    if (M::same_sign(dudt_f, u_estimate)) {
+      if (sycl::fabs(dudt_f) > sycl::fabs(u_estimate)) {
+	dudt_f = u_estimate;
+      } else {
+	dudt_f = 0.0f;
+      }
+    }
+    dudt -= dudt_f;
+
+    ValueType v_estimate = U[2] + dvdt * 0.5f * timestep;
+    ValueType dvdt_f = 9.81f * sf * U[2];
+    if (M::same_sign(dvdt_f, v_estimate)) {
+      if (sycl::fabs(dvdt_f) > sycl::fabs(v_estimate)) {
+	dvdt_f = v_estimate;
+      } else {
+	dvdt_f = 0.0f;
+      }
+    }
+    dvdt -= dvdt_f;
+
+    return { dhdt, dudt, dvdt };
+  }
+
+};
+
+#endif
@@ -8,35 +8,70 @@
 #define TemporalDerivatives_SVTemporalDerivative_hpp
 
 #include "../TemporalDerivative.hpp"
+#include "../ActiveTileSet.hpp"
 
 template<typename T,
 	 typename MeshType,
 	 FieldMapping FM,
-	 size_t N>
+	 size_t N,
+	 FieldStorage FS = FieldStorage::Separate,
+	 typename CT = T,
+	 typename BT = T>
 class SVTemporalDerivative
-  : public TemporalDerivative<T, MeshType, FM, N>
+  : public TemporalDerivative<T, MeshType, FM, N, FS, CT, BT>
 {
 public:
   
-  SVTemporalDerivative(void)
-    : TemporalDerivative<T, MeshType, FM, N>()
+  SVTemporalDerivative(const std::shared_ptr<ActiveTileSet<MeshType>>& active_tiles = nullptr)
+    : TemporalDerivative<T, MeshType, FM, N, FS, CT, BT>()
   {}
 
   virtual ~SVTemporalDerivative(void)
   {}
 
-  virtual void calculate(const FieldVector<T,MeshType,FM,N>& U,
-			 const FieldVector<T,MeshType,FieldMapping::Cell,3>& zb,
-			 const FieldVector<T,MeshType,FieldMapping::Cell,4>& n,
-			 const FieldVector<T,MeshType,FieldMapping::Cell,2>& Q_in,
-			 const FieldVector<T,MeshType,FieldMapping::Cell,2>& h_in,
-			 const FieldVector<T,MeshType,FieldMapping::Face,4>& flux,
-			 FieldVector<T,MeshType,FM,N>& dUdt,
-			 const double& time_now, const double& timestep,
+  virtual void calculate(const FieldVector<T,MeshType,FM,N,FS>& U,
+			 const FieldVector<BT,MeshType,FieldMapping::Face,3>& zf,
+			 const FieldVector<CT,MeshType,FieldMapping::Cell,2>& dzb,
+			 const FoldableFieldVector<CT,MeshType,FieldMapping::Cell,4>& n,
+			 const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& Q_in,
+			 const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& h_in,
+			 const FieldVector<T,MeshType,FieldMapping::Face,3,FS>& flux,
+			 FieldVector<T,MeshType,FM,N,FS>& dUdt,
+			 const StepClock<T>& clock, const double& stage,
 			 const double& bdy_t0, const double& bdy_t1) const
   {
     throw std::logic_error("This type of flux function is not implemented.");
   }
+
+  virtual void calculate_and_combine(FieldVector<T,MeshType,FM,N,FS>& U,
+				     const FieldVector<BT,MeshType,FieldMapping::Face,3>& zf,
+				     const FieldVector<CT,MeshType,FieldMapping::Cell,2>& dzb,
+				     const FoldableFieldVector<CT,MeshType,FieldMapping::Cell,4>& n,
+				     const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& Q_in,
+				     const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& h_in,
+				     const FieldVector<T,MeshType,FieldMapping::Face,3,FS>& flux,
+				     FieldVector<T,MeshType,FM,N,FS>& dUdt,
+				     const StepClock<T>& clock, const double& stage,
+				     const double& bdy_t0, const double& bdy_t1,
+				     const StageCombination<T,MeshType,FM,N,FS>& next_stage) const
+  {
+    throw std::logic_error("This type of flux function is not implemented.");
+  }
+
+  virtual void calculate_and_accumulate(const FieldVector<T,MeshType,FM,N,FS>& U,
+					const FieldVector<BT,MeshType,FieldMapping::Face,3>& zf,
+					const FieldVector<CT,MeshType,FieldMapping::Cell,2>& dzb,
+					const FoldableFieldVector<CT,MeshType,FieldMapping::Cell,4>& n,
+					const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& Q_in,
+					const FoldableFieldVector<T,MeshType,FieldMapping::Cell,2>& h_in,
+					const FieldVector<T,MeshType,FieldMapping::Face,3,FS>& flux,
+					FieldVector<T,MeshType,FM,N,FS>& dQ,
+					const StepClock<T>& clock, const double& stage,
+					const double& bdy_t0, const double& bdy_t1,
+					const double& A) const
+  {
+    throw std::logic_error("This type of flux function is not implemented.");
+  }
     
 };
 
@@ -13,6 +13,8 @@
 #include "Config.hpp"
 #include "OutputDriver.hpp"
 #include "BoundaryCondition.hpp"
+#include "StepClock.hpp"
+#include "StepGraph.hpp"
 
 template<typename Solver>
 class TemporalScheme
@@ -28,14 +30,21 @@ private:
   std::shared_ptr<sycl::queue> initialise_queue(void) const
   {
     std::cout << "Initialising compute device..." << std::endl;
-    sycl::device compute_device =
-      GlobalConfig::instance().get_device_parameters().device;
+    const auto& device_params = GlobalConfig::instance().get_device_parameters();
+    sycl::device compute_device = device_params.device;
+    if (device_params.in_order_queue) {
+      return std::make_shared<sycl::queue>(compute_device,
+					   sycl::property::queue::in_order());
+    }
     return std::make_shared<sycl::queue>(compute_device);
   }
   
 protected:
 
   std::shared_ptr<sycl::queue> queue_;
+
+  // Time and time step of the current step, as seen by the kernels
+  StepClock<ValueType> clock_;
   
   std::shared_ptr<Solver> solver_;
 
@@ -43,15 +52,48 @@ protected:
 
   std::vector<OutputDriver<TemporalScheme<Solver>>> output_drivers_;
   std::vector<std::shared_ptr<BoundaryCondition<Solver>>> boundary_conditions_;
+
+  // Whether steps are taken with the fixed time step. Cleared if the
+  // time step turns out to be unstable and the run carries on with an
+  // adaptive time step.
+  bool fixed_dt_;
+
+  // Whether device_inner_loop() records the commands of a step and
+  // replays them. Cleared if they cannot be recorded.
+  bool record_steps_;
+
+  // The state after the last passing check of fixed_inner_loop(),
+  // restored if a later check fails. Only allocated when the checks
+  // are more than one step apart.
+  std::shared_ptr<typename Solver::SolutionState> checked_U_;
+
+  // Copy every cell of one state into another
+  void copy_whole_state(const typename Solver::SolutionState& from,
+			typename Solver::SolutionState& to)
+  {
+    queue_->submit([&] (sycl::handler& cgh) {
+      auto from_ro = from.template get_accessor<sycl::access::mode::read>(cgh);
+      auto to_wo = to.template get_accessor<sycl::access::mode::discard_write>(cgh);
+      cgh.parallel_for(sycl::range<1>(solver_->mesh()->cell_count()),
+		       [=](sycl::id<1> id) {
+	for (size_t j = 0; j < to_wo.size(); ++j) {
+	  to_wo[j][id] = from_ro[j][id];
+	}
+      });
+    });
+  }
   
 public:
 
   TemporalScheme()
     : queue_(initialise_queue()),
+      clock_(queue_),
       solver_(std::make_shared<Solver>(queue_)),
       U_(solver_->initial_state()),
       output_drivers_(create_output_drivers<TemporalScheme<Solver>>()),
-      boundary_conditions_(create_boundary_conditions<Solver>(solver_))
+      boundary_conditions_(create_boundary_conditions(solver_)),
+      fixed_dt_(false),
+      record_steps_(GlobalConfig::instance().get_timestep_parameters().record_steps)
   {
     
   }
@@ -80,14 +122,22 @@ public:
   {
     solver_->write_check_files();
   }
+
+  // Drop the output drivers, so that run() writes no output
+  void disable_output(void)
+  {
+    output_drivers_.clear();
+  }
   
-  virtual void step(const double& time_now,
-		    const double& timestep,
-		    const double& bdy_t0,
+  // Take a step from the time and with the time step in clock_
+  virtual void step(const double& bdy_t0,
 		    const double& bdy_t1) = 0;
 
   virtual void accept_step(void) = 0;
 
+  // Accept the step just taken if clock_ accepted it on the device
+  virtual void accept_step_on_device(void) = 0;
+
   virtual void end_of_step(void) = 0;
 
   virtual void update_boundaries(const double& bdy_t0,
@@ -95,6 +145,20 @@ public:
 
   virtual void update_measures(const double& time_now) = 0;
 
+  // Whether the solver may use the fused kernel, if autotuning finds
+  // it fastest
+  virtual bool allows_fused_kernel(void) const
+  {
+    return true;
+  }
+
+  // Maximum control number of the state at the start of the step just
+  // taken with the given time step
+  virtual double get_control_number(const double& timestep)
+  {
+    return solver_->get_control_number(U_, timestep);
+  }
+
   std::shared_ptr<OutputFunction<ValueType,MeshType>> get_output_function(const std::string& name)
   {
     return solver_->get_output_function(name, U_);
@@ -110,6 +174,7 @@ public:
     double dt = ts_params.time_step;
     double max_dt = ts_params.max_time_step;
     double courant_target = ts_params.courant_target;
+    size_t steps_per_sync = ts_params.steps_per_sync;
 
     // Number of iterations of outer loop
     size_t nsteps = ((size_t) (0.001 + end_time - start_time) / step_size);
@@ -139,9 +204,65 @@ public:
       double t_step_start = start_time + i * step_size;
       double t_step_end = t_step_start + step_size;
 
-      inner_loop(dt, max_dt, courant_target,
-		 t_step_start, t_step_end,
-		 screen_output_table, display_every);
+      if (fixed_dt_) {
+	fixed_inner_loop(dt, max_dt, courant_target,
+			 t_step_start, t_step_end,
+			 screen_output_table, display_every,
+			 ts_params.courant_check_interval);
+      } else if (steps_per_sync > 0) {
+	device_inner_loop(dt, max_dt, courant_target,
+			  t_step_start, t_step_end,
+			  screen_output_table, steps_per_sync);
+      } else {
+	inner_loop(dt, max_dt, courant_target,
+		   t_step_start, t_step_end,
+		   screen_output_table, display_every);
+      }
+    }
+  }
+
+  // Update the boundaries and measures at the start of an inner loop
+  void start_inner_loop(const double& t_start, const double& t_end)
+  {
+    solver_->clear_boundary_conditions();
+    for (auto&& bdy_ptr : boundary_conditions_) {
+      bdy_ptr->update(*this, t_start, t_end);
+    }
+    solver_->update_active_tiles(U_, false);
+    this->update_measures(t_start);
+  }
+
+  // Wait for the device and write any output due at the end of an
+  // inner loop
+  void finish_inner_loop(const double& t_now,
+			 const size_t& repeated_step_count,
+			 DisplayTable<double,double,double,double>& so_table)
+  {
+    bool any_output = false;
+    
+    queue_->wait_and_throw();
+
+    for (auto&& od : output_drivers_) {
+      if (t_now >= od.next_output_time()) {
+	any_output = true;
+	so_table.write_bot_rule();
+	od.output(*this);
+      }
+    }
+
+    if (repeated_step_count > 0) {
+      if (not any_output) {
+	so_table.write_bot_rule();
+      } else {
+	so_table.write_mid_rule();
+      }
+      std::cout << "WARNING: repeated " << repeated_step_count
+		<< " steps." << std::endl;
+      any_output = true;
+    }
+
+    if (not any_output) {
+      so_table.write_bot_rule();
     }
   }
 
@@ -153,19 +274,30 @@ public:
 		  DisplayTable<double,double,double,double>& so_table,
 		  const size_t& display_every)
   {
-    solver_->clear_boundary_conditions();
-    for (auto&& bdy_ptr : boundary_conditions_) {
-      bdy_ptr->update(*this, t_start, t_end);
-    }
-    this->update_measures(t_start);
-    
+    start_inner_loop(t_start, t_end);
+    adaptive_steps(dt, max_dt, courant_target, t_start, t_end, 0.0,
+		   so_table, display_every);
+  }
+
+  // Take steps with an adaptive time step from t_local (relative to
+  // t_start) to the end of the inner loop
+  void adaptive_steps(double& dt,
+		      const double& max_dt,
+		      const double& courant_target,
+		      const double& t_start,
+		      const double& t_end,
+		      double t_local,
+		      DisplayTable<double,double,double,double>& so_table,
+		      const size_t& display_every)
+  {
     size_t repeated_step_count = 0;
     size_t local_repeat_count = 0;
     size_t inner_steps = 0;
-    double t_local = 0.0;
     double t_local_end = t_end - t_start;
 
     bool any_output = true;
+
+    solver_->bound_active_tiles(0);
     
     while (true) {
       if (any_output) {
@@ -176,10 +308,11 @@ public:
     
       // Do the time step
       double t_now = t_start + t_local;
-      this->step(t_now, dt, t_start, t_end);
+      clock_.set(t_start, t_local, t_local_end, dt);
+      this->step(t_start, t_end);
 
       // Get the solution maximum control number
-      double comax = solver_->get_control_number(U_, dt);
+      double comax = this->get_control_number(dt);
 
       // Variable to hold our new target timestep
       double target_dt = dt;
@@ -205,8 +338,11 @@ public:
 	// our target)
 	local_repeat_count = 0;
 	
-	// Accept this step.
+	// Accept this step. The host waits for the device at every step
+	// anyway, so size the launches over the active tiles exactly.
 	this->accept_step();
+	solver_->update_active_tiles(U_, true);
+	solver_->bound_active_tiles(0);
 
 	// Increment the local time and step counts
 	t_local += dt;
@@ -229,66 +365,216 @@ public:
 					       t_local, comax);
 	  }
 
-	  queue_->wait_and_throw();
+	  finish_inner_loop(t_start + t_local, repeated_step_count,
+			    so_table);
+	  
+	  return;
+	}
 
-	  for (auto&& od : output_drivers_) {
-	    if (t_start + t_local >= od.next_output_time()) {
-	      any_output = true;
-	      so_table.write_bot_rule();
-	      od.output(*this);
-	    }
-	  }
+	target_dt = StepClock<ValueType>::approach_end(target_dt, t_local,
+						       t_local_end,
+						       inner_steps);
+      }
 
-	  if (repeated_step_count > 0) {
-	    if (not any_output) {
-	      so_table.write_bot_rule();
-	    } else {
-	      so_table.write_mid_rule();
-	    }
-	    std::cout << "WARNING: repeated " << repeated_step_count
-		      << " steps." << std::endl;
-	    any_output = true;
+      dt = target_dt;
+    }
+  }
+
+  // As inner_loop(), but every step has the fixed time step dt, except
+  // the last, which is shortened to finish on the end of the loop. The
+  // control number is only found on every check_every-th step and on
+  // the last, so the other steps need neither the reduction nor a wait
+  // for the device. If a checked step exceeds the Courant target,
+  // depending on the time step parameters, either the run stops or
+  // the state is rolled back to the previous check and the rest of the
+  // loop uses an adaptive time step.
+  void fixed_inner_loop(double& dt,
+			const double& max_dt,
+			const double& courant_target,
+			const double& t_start,
+			const double& t_end,
+			DisplayTable<double,double,double,double>& so_table,
+			const size_t& display_every,
+			const size_t& check_every)
+  {
+    using CourantExceeded =
+      GlobalConfig::TimestepParameters::CourantExceeded;
+
+    start_inner_loop(t_start, t_end);
+    solver_->bound_active_tiles(check_every - 1);
+
+    // The unchecked steps since the last check are rolled back to
+    // checked_U_ if a check fails
+    if (check_every > 1) {
+      if (not checked_U_) {
+	checked_U_ = std::make_shared<typename Solver::SolutionState>("", U_, " (checked)");
+      } else {
+	copy_whole_state(U_, *checked_U_);
+      }
+    }
+    double t_checked = 0.0;
+
+    double t_local_end = t_end - t_start;
+    size_t nsteps = std::max((size_t) 1,
+			     (size_t) std::ceil(t_local_end / dt - 1e-6));
+
+    so_table.write_top_rule();
+    so_table.write_header_row();
+
+    double comax = 0.0;
+    for (size_t i = 0; i < nsteps; ++i) {
+      double t_local = i * dt;
+      double step_dt = (i + 1 < nsteps ? dt : t_local_end - t_local);
+      bool check = ((i + 1) % check_every == 0 or i + 1 == nsteps);
+
+      clock_.set(t_start, t_local, t_local_end, step_dt);
+      clock_.measure_rate(check);
+      this->step(t_start, t_end);
+      clock_.measure_rate(true);
+
+      if (check) {
+	comax = this->get_control_number(step_dt);
+	if (not (comax <= courant_target)) {
+	  so_table.write_data_row((t_start + t_local) / 3600., step_dt,
+				  t_local, comax);
+	  so_table.write_bot_rule();
+	  if (GlobalConfig::instance().get_timestep_parameters().courant_exceeded
+	      == CourantExceeded::abort) {
+	    std::cerr << "Courant number " << comax << " exceeds the "
+		      << "target of " << courant_target << " with the "
+		      << "fixed time step." << std::endl;
+	    throw std::runtime_error("Courant target exceeded with fixed time step");
 	  }
 
-	  /*
-	  if (i < nsteps - 1) {
+	  std::cout << "WARNING: Courant number " << comax << " exceeds "
+		    << "the target with the fixed time step. Continuing "
+		    << "with an adaptive time step";
+	  if (t_checked < t_local) {
+	    std::cout << " from the previous check";
 	  }
-	  */
-	  if (not any_output) {
-	    so_table.write_bot_rule();
+	  std::cout << "." << std::endl;
+	  fixed_dt_ = false;
+	  dt = step_dt * std::fmax(0.1, std::fmin(0.9, courant_target / comax));
+	  if (t_checked < t_local) {
+	    // Steps since the last check may be unstable too
+	    copy_whole_state(*checked_U_, U_);
+	    solver_->update_active_tiles(U_, false);
 	  }
-	  
+	  adaptive_steps(dt, max_dt, courant_target, t_start, t_end,
+			 t_checked, so_table, display_every);
 	  return;
-	} else if (t_local + target_dt > t_local_end) {
-	  // The next timestep will take us to or past the end of the
-	  // inner loop. Lower it so that it hits exactly.
-	  target_dt = t_local_end - t_local;
-	  // We need to finish the loop on an even number of steps, so
-	  // if we currently have an even number of steps we need to
-	  // lower the timestep so that we do two more.
-	  if (inner_steps % 2 == 0) {
-	    // To do two more steps we need to go 60% of the way
-	    target_dt *= 0.6;
-	  }
-	} else if (t_local + 1.5 * target_dt >= t_local_end) {
-	  // This timestep will take us close to the end of the
-	  // loop. Lower it so we don't get really close but not
-	  // quite there
-	  if (inner_steps % 2 == 0) {
-	    // If we're on an even step we want to finish in two
-	    // steps, so we go 60% of the way there
-	    target_dt = 0.6 * (t_local_end - t_local);
-	  } else {
-	    // If we're on an odd step we want to finish in one or
-	    // three steps. Because we can't guarantee that we can
-	    // use a high enough timestep to finish in one, we go
-	    // 35% of the way there and aim for three.
-	    target_dt = 0.35 * (t_local_end - t_local);
-	  }
-	}	
+	}
       }
 
-      dt = target_dt;
+      this->accept_step();
+      solver_->update_active_tiles(U_, true);
+      if (check) {
+	t_checked = t_local + step_dt;
+	if (checked_U_ and i + 1 < nsteps) {
+	  copy_whole_state(U_, *checked_U_);
+	}
+
+	// Launches over the active tiles cover the steps up to the next
+	// check
+	solver_->bound_active_tiles(check_every - 1);
+      }
+
+      if ((i + 1) % display_every == 0 or i + 1 == nsteps) {
+	so_table.write_data_row((t_start + t_local) / 3600., step_dt,
+				t_local + step_dt, comax);
+      }
+    }
+
+    finish_inner_loop(t_end, 0, so_table);
+  }
+
+  // As inner_loop(), but the steps are accepted or rejected and the
+  // time step chosen on the device. The host enqueues up to
+  // steps_per_sync steps at a time and only reads the state of the
+  // clock back between them, rather than after every step.
+  void device_inner_loop(double& dt,
+			 const double& max_dt,
+			 const double& courant_target,
+			 const double& t_start,
+			 const double& t_end,
+			 DisplayTable<double,double,double,double>& so_table,
+			 const size_t& steps_per_sync)
+  {
+    start_inner_loop(t_start, t_end);
+
+    double t_local_end = t_end - t_start;
+    clock_.set(t_start, 0.0, t_local_end, dt);
+
+    so_table.write_top_rule();
+    so_table.write_header_row();
+
+    typename StepClock<ValueType>::State state;
+    state.t_local = 0.0;
+    state.dt = dt;
+
+    auto enqueue_step = [&] () {
+      this->step(t_start, t_end);
+      clock_.advance(courant_target, max_dt);
+      this->accept_step_on_device();
+      solver_->update_active_tiles(U_, clock_);
+    };
+
+    // The commands of a step are the same for the whole inner loop, as
+    // the time and time step are read from clock_ on the device, except
+    // for the number of active tiles they are launched over. They are
+    // recorded again if that grows.
+    std::optional<StepGraph> graph;
+    size_t graph_launches = 0;
+    auto record_step = [&] (const size_t& launches) {
+      graph.reset();
+      try {
+	graph.emplace(queue_, enqueue_step);
+	graph_launches = launches;
+      } catch (sycl::exception& e) {
+	std::cout << "WARNING: could not record the commands of a step ("
+		  << e.what() << "). Submitting them for each step "
+		  << "instead." << std::endl;
+	record_steps_ = false;
+      }
+    };
+    
+    while (true) {
+      // Steps enqueued after the end of the loop has been reached are
+      // wasted, so enqueue no more than we expect to need
+      size_t nsteps = (size_t) std::ceil((t_local_end - state.t_local)
+					 / state.dt);
+      nsteps = std::max((size_t) 1, std::min(nsteps, steps_per_sync));
+
+      size_t launches = solver_->bound_active_tiles(nsteps - 1);
+      if (record_steps_ and (not graph or launches > graph_launches)) {
+	record_step(launches);
+      }
+      
+      for (size_t i = 0; i < nsteps; ++i) {
+	if (graph) {
+	  graph->replay();
+	} else {
+	  enqueue_step();
+	}
+      }
+
+      state = clock_.get_state();
+
+      if (state.status & StepClock<ValueType>::Failed) {
+	throw std::runtime_error("Too many repeated steps");
+      }
+
+      so_table.write_data_row((t_start + state.t_local) / 3600.,
+			      state.last_dt, state.t_local, state.comax);
+
+      if (state.status & StepClock<ValueType>::Finished) {
+	// The output may launch kernels over the active tiles
+	solver_->bound_active_tiles(0);
+	dt = state.dt;
+	finish_inner_loop(t_start + state.t_local, state.repeated_steps,
+			  so_table);
+	return;
+      }
     }
   }
   
@@ -304,10 +590,15 @@ public:
     //   std::vector<std::shared_ptr<OutputDriver>> output_drivers;
     // TODO: populate list of output drivers
     
+    if (GlobalConfig::instance().get_solver_parameters().autotune) {
+      solver_->autotune(U_, clock_, this->allows_fused_kernel());
+    }
+    
     if (ts_params.dt_type == GlobalConfig::TimestepParameters::DtType::fixed) {
-      std::cerr << "Fixed timestep mode not currently supported." << std::endl;
-      throw std::runtime_error("Fixed timestep mode not supported.");
+      fixed_dt_ = true;
+      outer_loop(start_time, end_time, sync_step, display_every);
     } else if (ts_params.dt_type == GlobalConfig::TimestepParameters::DtType::adaptive) {
+      fixed_dt_ = false;
       outer_loop(start_time, end_time, sync_step, display_every);
     }
   }
@@ -0,0 +1,172 @@
+/***********************************************************************
+ * TemporalSchemes/LocalTimestep.hpp
+ *
+ * Local (multi-rate) time stepping. Each step of the scheme is a
+ * cycle of the time step chosen by TemporalScheme::inner_loop, divided
+ * into 2^L sub-steps where L is the number of levels. Each active
+ * tile is given a level k from the control number of its cells at the
+ * start of the cycle and takes forward Euler steps of 2^k sub-steps,
+ * so only the tiles where the flow is fastest take the shortest steps.
+ * The fluxes across faces between tiles of different levels are
+ * accumulated by the cells either side, so mass is conserved.
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef TemporalSchemes_LocalTimestep_hpp
+#define TemporalSchemes_LocalTimestep_hpp
+
+#include "../TemporalScheme.hpp"
+
+template<typename Solver>
+class LocalTimestepTemporalScheme : public TemporalScheme<Solver>
+{
+private:
+
+  using ValueType = typename Solver::ValueType;
+
+  using SSAccessorRO = typename Solver::SolutionState::template Accessor<sycl::access::mode::read>;
+  using SSAccessorRW = typename Solver::SolutionState::template Accessor<sycl::access::mode::read_write>;
+
+  // The finest tiles take 2^max_level_ sub-steps per cycle
+  size_t max_level_;
+  double courant_target_;
+
+  typename Solver::SolutionState Ustar_;
+
+  // Flux terms accumulated by each cell since the start of its step
+  typename Solver::SolutionState acc_;
+
+  // Copy U into U* at the start of a cycle, or U* into U if the clock
+  // on the device accepted the cycle
+  class CopyState
+  {
+  private:
+
+    typename StepClock<ValueType>::Times times_;
+    bool if_accepted_;
+    SSAccessorRO from_ro_;
+    SSAccessorRW to_rw_;
+
+  public:
+
+    CopyState(const typename StepClock<ValueType>::Times& times,
+	      bool if_accepted,
+	      const SSAccessorRO& from_ro,
+	      const SSAccessorRW& to_rw)
+      : times_(times),
+	if_accepted_(if_accepted),
+	from_ro_(from_ro),
+	to_rw_(to_rw)
+    {}
+
+    void operator()(sycl::id<1> item) const {
+      if (if_accepted_ and not times_.step_accepted()) return;
+      for (size_t vec_id = 0; vec_id < to_rw_.size(); ++vec_id) {
+	to_rw_[vec_id][item] = from_ro_[vec_id][item];
+      }
+    }
+
+  };
+
+  void copy_state(const typename Solver::SolutionState& from,
+		  typename Solver::SolutionState& to,
+		  bool if_accepted)
+  {
+    this->queue_->submit([&] (sycl::handler& cgh) {
+      auto kernel = CopyState
+	(this->clock_.get_times(cgh), if_accepted,
+	 from.template get_accessor<sycl::access::mode::read>(cgh),
+	 to.template get_accessor<sycl::access::mode::read_write>(cgh));
+      this->solver_->parallel_for_elements(cgh, kernel);
+    });
+  }
+
+public:
+
+  LocalTimestepTemporalScheme(const size_t& max_level)
+    : TemporalScheme<Solver>(),
+      max_level_(max_level),
+      courant_target_(GlobalConfig::instance().get_timestep_parameters().courant_target),
+      Ustar_("", this->U_, "*"),
+      acc_(this->queue_,
+	   std::array<std::string,3>({ "∫h", "∫u", "∫v" }),
+	   this->solver_->mesh(), true, 0.0f)
+  {
+    if (not this->solver_->supports_local_timesteps()) {
+      std::cerr << "Local time stepping needs active tiles and cannot "
+		<< "be used with the fused kernel." << std::endl;
+      throw std::runtime_error("Local time stepping not supported by solver");
+    }
+    if (GlobalConfig::instance().get_timestep_parameters().dt_type ==
+	GlobalConfig::TimestepParameters::DtType::fixed) {
+      std::cerr << "Local time stepping chooses the time step of each "
+		<< "tile and cannot be used with a fixed time step."
+		<< std::endl;
+      throw std::runtime_error("Local time stepping with fixed time step");
+    }
+    std::cout << "Using local time stepping with " << max_level_
+	      << " levels below the cycle time step." << std::endl;
+  }
+
+  virtual ~LocalTimestepTemporalScheme(void) {}
+
+  virtual void step(const double& bdy_t0, const double& bdy_t1)
+  {
+    copy_state(this->U_, Ustar_, false);
+    this->solver_->update_timestep_levels(this->U_, this->clock_,
+					  courant_target_, max_level_);
+    size_t nsubsteps = (size_t) 1 << max_level_;
+    for (size_t s = 0; s < nsubsteps; ++s) {
+      this->solver_->local_substep(Ustar_, acc_, this->clock_, s,
+				   max_level_, bdy_t0, bdy_t1);
+    }
+  }
+
+  // The control number of each tile at its own time step, for the
+  // state at the start of the cycle
+  virtual double get_control_number(const double& timestep)
+  {
+    return this->clock_.get_rate() * timestep;
+  }
+
+  virtual void accept_step(void)
+  {
+    std::swap(this->U_, Ustar_);
+  }
+
+  virtual void accept_step_on_device(void)
+  {
+    copy_state(Ustar_, this->U_, true);
+  }
+
+  virtual void end_of_step(void)
+  {
+  }
+
+  virtual void update_boundaries(const double& bdy_t0,
+				 const double& bdy_t1)
+  {
+  }
+
+  virtual void update_measures(const double& t)
+  {
+  }
+
+  static std::shared_ptr<TemporalScheme<Solver>>
+  create(void)
+  {
+    Config empty;
+    const Config& config = GlobalConfig::instance().configuration().get_child("temporal scheme", empty);
+    size_t levels = config.get<size_t>("levels", 4);
+    if (levels > 16) {
+      std::cerr << "Too many local time step levels: " << levels
+		<< std::endl;
+      throw std::runtime_error("Too many local time step levels");
+    }
+    return std::make_shared<LocalTimestepTemporalScheme<Solver>>(levels);
+  }
+
+};
+
+#endif
@@ -0,0 +1,417 @@
+/***********************************************************************
+ * TemporalSchemes/LowStorageRungeKutta.hpp
+ *
+ * Low-storage (2N) Runge-Kutta schemes in Williamson's form. Each
+ * stage i updates two registers
+ *
+ *   dQ = A_i dQ + Δt dU/dt(U*, t + c_i Δt)
+ *   U* = U* + B_i dQ
+ *
+ * so the memory needed does not depend on the number of stages. The
+ * temporal derivative accumulates into dQ itself (see
+ * SVSolver::update_ddt_and_accumulate()), so only U* and dQ are kept
+ * besides the state at the start of the step. The fused kernel cannot
+ * accumulate, and with it a third state holds dU/dt.
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef TemporalSchemes_LowStorageRungeKutta_hpp
+#define TemporalSchemes_LowStorageRungeKutta_hpp
+
+#include "../TemporalScheme.hpp"
+
+class LowStorageRungeKuttaCoefficientSet
+{
+public:
+
+  struct Stage
+  {
+    double A;
+    double B;
+    double c;
+  };
+
+private:
+
+  std::vector<Stage> stages_;
+
+public:
+
+  LowStorageRungeKuttaCoefficientSet(const std::vector<Stage>& stages)
+    : stages_(stages)
+  {
+    std::cout << "Coefficients for low-storage Runge Kutta scheme are:"
+	      << std::endl;
+    std::cout << std::string(12, ' ') << "A" << std::string(11, ' ')
+	      << "B" << std::string(11, ' ') << "c" << std::endl;
+    for (auto&& st : stages_) {
+      std::cout << std::to_string(st.A) << "   "
+		<< std::to_string(st.B) << "   "
+		<< std::to_string(st.c) << std::endl;
+    }
+  }
+
+  size_t stage_count(void) const
+  {
+    return stages_.size();
+  }
+
+  const Stage& stage(const size_t& i) const
+  {
+    return stages_[i];
+  }
+
+};
+
+template<typename Solver>
+class LowStorageRungeKuttaTemporalScheme : public TemporalScheme<Solver>
+{
+private:
+
+  using ValueType = typename Solver::ValueType;
+
+  using SSAccessorRO = typename Solver::SolutionState::template Accessor<sycl::access::mode::read>;
+  using SSAccessorRW = typename Solver::SolutionState::template Accessor<sycl::access::mode::read_write>;
+
+  std::shared_ptr<LowStorageRungeKuttaCoefficientSet> coeffs_;
+
+  typename Solver::SolutionState Ustar_;
+  typename Solver::SolutionState dQ_;
+
+  // Only allocated if the solver cannot accumulate into dQ
+  std::shared_ptr<typename Solver::SolutionState> dUdt_;
+
+  // Copy U into U* at the start of the step
+  class CopyStep
+  {
+  protected:
+
+    SSAccessorRO U_ro_;
+    SSAccessorRW Ustar_rw_;
+
+  public:
+
+    CopyStep(const SSAccessorRO& U_ro,
+	     const SSAccessorRW& Ustar_rw)
+      : U_ro_(U_ro),
+	Ustar_rw_(Ustar_rw)
+    {}
+
+    void copy(sycl::id<1> item) const {
+      for (size_t vec_id = 0; vec_id < Ustar_rw_.size(); ++vec_id) {
+	Ustar_rw_[vec_id][item] = U_ro_[vec_id][item];
+      }
+    }
+
+    void operator()(sycl::id<1> item) const {
+      copy(item);
+    }
+
+  };
+
+  // As CopyStep, also finding the maximum control number (per unit
+  // time step) of U while reading it
+  template<typename CellControlNumber>
+  class StartStep : public CopyStep
+  {
+  private:
+
+    CellControlNumber cell_cn_;
+
+  public:
+
+    StartStep(const CellControlNumber& cell_cn,
+	      const SSAccessorRO& U_ro,
+	      const SSAccessorRW& Ustar_rw)
+      : CopyStep(U_ro, Ustar_rw),
+	cell_cn_(cell_cn)
+    {}
+
+    template<typename Reducer>
+    void operator()(sycl::id<1> item, Reducer& max) const {
+      max.combine(cell_cn_(this->U_ro_, item[0]));
+      this->copy(item);
+    }
+
+  };
+
+  // Update U* from dQ, once dQ holds the register of a stage
+  class UpdateStage
+  {
+  protected:
+
+    ValueType B_;
+
+    SSAccessorRW Ustar_rw_;
+    SSAccessorRW dQ_rw_;
+
+  public:
+
+    UpdateStage(const LowStorageRungeKuttaCoefficientSet::Stage& stage,
+		const SSAccessorRW& Ustar_rw,
+		const SSAccessorRW& dQ_rw)
+      : B_(stage.B),
+	Ustar_rw_(Ustar_rw),
+	dQ_rw_(dQ_rw)
+    {}
+
+    void update(sycl::id<1> item) const {
+      for (size_t vec_id = 0; vec_id < Ustar_rw_.size(); ++vec_id) {
+	Ustar_rw_[vec_id][item] += B_ * dQ_rw_[vec_id][item];
+      }
+
+      if (Ustar_rw_[0][item] < 0.0) {
+	Ustar_rw_[0][item] = 0.0;
+	Ustar_rw_[1][item] = 0.0;
+	Ustar_rw_[2][item] = 0.0;
+      } else if (Ustar_rw_[0][item] < 1e-4) {
+	Ustar_rw_[1][item] = 0.0;
+	Ustar_rw_[2][item] = 0.0;
+      }
+    }
+
+    void operator()(sycl::id<1> item) const {
+      update(item);
+    }
+
+  };
+
+  // As UpdateStage, first forming dQ from the dU/dt of the stage
+  class LowStorageStep : public UpdateStage
+  {
+  private:
+
+    ValueType A_;
+
+    typename StepClock<ValueType>::Times times_;
+
+    SSAccessorRO dUdt_ro_;
+
+  public:
+
+    LowStorageStep(const LowStorageRungeKuttaCoefficientSet::Stage& stage,
+		   const typename StepClock<ValueType>::Times& times,
+		   const SSAccessorRW& Ustar_rw,
+		   const SSAccessorRW& dQ_rw,
+		   const SSAccessorRO& dUdt_ro)
+      : UpdateStage(stage, Ustar_rw, dQ_rw),
+	A_(stage.A),
+	times_(times),
+	dUdt_ro_(dUdt_ro)
+    {}
+
+    void operator()(sycl::id<1> item) const {
+      ValueType timestep = times_.timestep();
+      for (size_t vec_id = 0; vec_id < this->dQ_rw_.size(); ++vec_id) {
+	// The first stage has A = 0 and does not read dQ, which is
+	// left over from the last step
+	ValueType dQ = timestep * dUdt_ro_[vec_id][item];
+	if (A_ != (ValueType) 0.0) {
+	  dQ += A_ * this->dQ_rw_[vec_id][item];
+	}
+	this->dQ_rw_[vec_id][item] = dQ;
+      }
+      this->update(item);
+    }
+
+  };
+
+  // Copy U* into U if the clock on the device accepted the step
+  class ConditionalAcceptStep
+  {
+  private:
+
+    typename StepClock<ValueType>::Times times_;
+    SSAccessorRO Ustar_ro_;
+    SSAccessorRW U_rw_;
+
+  public:
+
+    ConditionalAcceptStep(const typename StepClock<ValueType>::Times& times,
+			  const SSAccessorRO& Ustar_ro,
+			  const SSAccessorRW& U_rw)
+      : times_(times),
+	Ustar_ro_(Ustar_ro),
+	U_rw_(U_rw)
+    {}
+
+    void operator()(sycl::id<1> item) const {
+      if (not times_.step_accepted()) return;
+      for (size_t vec_id = 0; vec_id < U_rw_.size(); ++vec_id) {
+	U_rw_[vec_id][item] = Ustar_ro_[vec_id][item];
+      }
+    }
+
+  };
+
+public:
+
+  LowStorageRungeKuttaTemporalScheme(const std::shared_ptr<LowStorageRungeKuttaCoefficientSet>& coeffs)
+    : TemporalScheme<Solver>(),
+      coeffs_(coeffs),
+      Ustar_("", this->U_, "*"),
+      dQ_("Δ(", this->U_, ")"),
+      dUdt_()
+  {
+  }
+
+  virtual ~LowStorageRungeKuttaTemporalScheme(void) {}
+
+  virtual void step(const double& bdy_t0, const double& bdy_t1)
+  {
+    using CellControlNumber = typename Solver::CellControlNumberType;
+    this->queue_->submit([&] (sycl::handler& cgh) {
+      if (this->clock_.rate_measured()) {
+	auto rate = this->clock_.get_rate_reduction(cgh);
+	auto kernel = StartStep<CellControlNumber>
+	  (this->solver_->get_cell_control_number(1.0),
+	   this->U_.template get_accessor<sycl::access::mode::read>(cgh),
+	   Ustar_.template get_accessor<sycl::access::mode::read_write>(cgh));
+	this->solver_->parallel_for_elements(cgh, rate, kernel);
+      } else {
+	auto kernel = CopyStep
+	  (this->U_.template get_accessor<sycl::access::mode::read>(cgh),
+	   Ustar_.template get_accessor<sycl::access::mode::read_write>(cgh));
+	this->solver_->parallel_for_elements(cgh, kernel);
+      }
+    });
+
+    bool accumulate = this->solver_->supports_stage_combination();
+    if (not accumulate and not dUdt_) {
+      dUdt_ = std::make_shared<typename Solver::SolutionState>("d", this->U_, "⁄dt");
+    }
+
+    for (size_t st = 0; st < coeffs_->stage_count(); ++st) {
+      const auto& stage = coeffs_->stage(st);
+      if (accumulate) {
+	this->solver_->update_ddt_and_accumulate(Ustar_, dQ_, this->clock_,
+						 stage.c, bdy_t0, bdy_t1,
+						 stage.A);
+	this->queue_->submit([&] (sycl::handler& cgh) {
+	  auto kernel = UpdateStage
+	    (stage,
+	     Ustar_.template get_accessor<sycl::access::mode::read_write>(cgh),
+	     dQ_.template get_accessor<sycl::access::mode::read_write>(cgh));
+	  this->solver_->parallel_for_elements(cgh, kernel);
+	});
+      } else {
+	this->solver_->update_ddt(Ustar_, *dUdt_, this->clock_, stage.c,
+				  bdy_t0, bdy_t1);
+	this->queue_->submit([&] (sycl::handler& cgh) {
+	  auto kernel = LowStorageStep
+	    (stage, this->clock_.get_times(cgh),
+	     Ustar_.template get_accessor<sycl::access::mode::read_write>(cgh),
+	     dQ_.template get_accessor<sycl::access::mode::read_write>(cgh),
+	     dUdt_->template get_accessor<sycl::access::mode::read>(cgh));
+	  this->solver_->parallel_for_elements(cgh, kernel);
+	});
+      }
+    }
+  }
+
+  virtual double get_control_number(const double& timestep)
+  {
+    return this->clock_.get_rate() * timestep;
+  }
+
+  virtual void accept_step(void)
+  {
+    std::swap(this->U_, Ustar_);
+  }
+
+  virtual void accept_step_on_device(void)
+  {
+    this->queue_->submit([&] (sycl::handler& cgh) {
+      auto kernel = ConditionalAcceptStep
+	(this->clock_.get_times(cgh),
+	 Ustar_.template get_accessor<sycl::access::mode::read>(cgh),
+	 this->U_.template get_accessor<sycl::access::mode::read_write>(cgh));
+      this->solver_->parallel_for_elements(cgh, kernel);
+    });
+  }
+
+  virtual void end_of_step(void)
+  {
+  }
+
+  virtual void update_boundaries(const double& bdy_t0,
+				 const double& bdy_t1)
+  {
+  }
+
+  virtual void update_measures(const double& t)
+  {
+  }
+
+  // Whether method names one of the low-storage schemes
+  static bool is_method(const std::string& method)
+  {
+    return (method == "Williamson3" or method == "Carpenter-Kennedy4");
+  }
+
+  static std::shared_ptr<TemporalScheme<Solver>>
+  create(void)
+  {
+    Config empty;
+    const Config& config = GlobalConfig::instance().configuration().get_child("temporal scheme", empty);
+    std::string method = config.get<std::string>("method");
+
+    std::cout << "Using a low-storage Runge-Kutta temporal scheme: '"
+	      << method << "':" << std::endl;
+
+    std::shared_ptr<LowStorageRungeKuttaCoefficientSet> coeffs;
+    if (method == "Williamson3") {
+      // Third order, three stages
+      coeffs = std::make_shared<LowStorageRungeKuttaCoefficientSet>
+	(std::vector<LowStorageRungeKuttaCoefficientSet::Stage>({
+	  {         0.0,   1.0/3.0,     0.0},
+	  {    -5.0/9.0, 15.0/16.0, 1.0/3.0},
+	  {-153.0/128.0,  8.0/15.0, 3.0/4.0},
+	}));
+    } else if (method == "Carpenter-Kennedy4") {
+      // Fourth order, five stages
+      coeffs = std::make_shared<LowStorageRungeKuttaCoefficientSet>
+	(std::vector<LowStorageRungeKuttaCoefficientSet::Stage>({
+	  {0.0,
+	   1432997174477.0/9575080441755.0,
+	   0.0},
+	  {-567301805773.0/1357537059087.0,
+	   5161836677717.0/13612068292357.0,
+	   1432997174477.0/9575080441755.0},
+	  {-2404267990393.0/2016746695238.0,
+	   1720146321549.0/2090206949498.0,
+	   2526269341429.0/6820363962896.0},
+	  {-3550918686646.0/2091501179385.0,
+	   3134564353537.0/4481467310338.0,
+	   2006345519317.0/3224310063776.0},
+	  {-1275806237668.0/842570457699.0,
+	   2277821191437.0/14882151754819.0,
+	   2802321613138.0/2924317926251.0},
+	}));
+    } else {
+      std::cerr << "Temporal Scheme \"" << method << "\" not known." << std::endl;
+      throw std::runtime_error("Temporal scheme not known");
+    }
+
+    // A disturbance spreads two cells per stage, and active tiles only
+    // contain it if they are at least that wide (see
+    // ActiveTileSets/Cartesian2DMesh.hpp). GlobalConfig only enforces
+    // the size needed by schemes of up to four stages.
+    size_t active_tile_size =
+      GlobalConfig::instance().get_solver_parameters().active_tile_size;
+    size_t min_tile_size = 2 * coeffs->stage_count();
+    if (active_tile_size > 0 and active_tile_size < min_tile_size) {
+      std::cerr << "Active tile size (" << active_tile_size
+		<< ") must be at least " << min_tile_size
+		<< " for the temporal scheme \"" << method << "\"."
+		<< std::endl;
+      throw std::runtime_error("Invalid active tile size");
+    }
+
+    return std::make_shared<LowStorageRungeKuttaTemporalScheme<Solver>>(coeffs);
+  }
+
+};
+
+#endif
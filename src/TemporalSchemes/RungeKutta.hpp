@@ -8,6 +8,7 @@
 #define TemporalSchemes_RungeKutta_hpp
 
 #include "../TemporalScheme.hpp"
+#include "RungeKuttaTableaux.hpp"
 //#include "../BoundaryCondition.hpp"
 //#include "../Measure.hpp"
 
@@ -57,7 +58,10 @@ public:
   
 };
 
-template<typename Solver, int S>
+// Tableau is one of the tableaux in RungeKuttaTableaux.hpp, giving
+// stage update kernels specialised for each stage, or void to read the
+// coefficients from a RungeKuttaCoefficientSet at run time.
+template<typename Solver, int S, typename Tableau = void>
 class RungeKuttaTemporalScheme : public TemporalScheme<Solver>
 {
 private:
@@ -67,8 +71,16 @@ private:
   typename Solver::SolutionState Ustar_;
   std::array<typename Solver::SolutionState, S> dUdt_;
 
+  // Whether the temporal derivative of each stage but the last also
+  // forms U* for the next stage, saving a pass over the state. The
+  // final combination is still a kernel of its own, which finds the
+  // control number.
+  bool combine_stages_;
+
   //  double courant_target_;
 
+  using ValueType = typename Solver::ValueType;
+
   using SSAccessorRO = typename Solver::SolutionState::template Accessor<sycl::access::mode::read>;
   using SSAccessorRW = typename Solver::SolutionState::template Accessor<sycl::access::mode::read_write>;
 
@@ -112,13 +124,12 @@ private:
 
   class RungeKuttaStep
   {
-  private:
+  protected:
 
     size_t step_;
     RungeKuttaCoefficientSet<S> coeffs_;
 
-    double time_now_;
-    double timestep_;
+    typename StepClock<ValueType>::Times times_;
 
     SSAccessorRW Ustar_rw_;
     SSAccessorRO U_ro_;
@@ -128,27 +139,30 @@ private:
 
     RungeKuttaStep(const size_t& step,
 		   const RungeKuttaCoefficientSet<S>& coeffs,
-		   const double& time_now,
-		   const double& timestep,
+		   const typename StepClock<ValueType>::Times& times,
 		   const SSAccessorRW& Ustar_rw,
 		   const SSAccessorRO& U_ro,
 		   const std::array<SSAccessorRO, S>& dUdt_ro)
       : step_(step),
 	coeffs_(coeffs),
-	time_now_(time_now),
-	timestep_(timestep),
+	times_(times),
 	Ustar_rw_(Ustar_rw),
 	U_ro_(U_ro),
 	dUdt_ro_(dUdt_ro)
     {}
 
-    void operator()(sycl::item<1> item) const {
+    void operator()(sycl::id<1> item) const {
+      update(item);
+    }
+
+    void update(const sycl::id<1>& item) const {
+      ValueType timestep = times_.timestep();
       for (size_t vec_id = 0; vec_id < Ustar_rw_.size(); ++vec_id) {
 	Ustar_rw_[vec_id][item] = U_ro_[vec_id][item];
 
 	if (step_ > 0) {
 	  for (size_t i = 0; i < step_; ++i) {
-	    Ustar_rw_[vec_id][item] += timestep_ * coeffs_.a(step_, i) * dUdt_ro_[i][vec_id][item];
+	    Ustar_rw_[vec_id][item] += timestep * coeffs_.a(step_, i) * dUdt_ro_[i][vec_id][item];
 	  }
 	}
 
@@ -166,63 +180,295 @@ private:
 
   };
 
-  void update_Ustar(size_t step,
-		    const double& time_now, const double& timestep,
-		    const double& bdy_t0, const double& bdy_t1)
+  // As RungeKuttaStep, for a stage known at compile time and with the
+  // coefficients of a Tableau
+  template<size_t Stage>
+  class RungeKuttaTableauStep
   {
-    this->queue_->submit([&] (sycl::handler& cgh) {
-      SSAccessorRW Ustar_rw =
-	Ustar_.template get_accessor<sycl::access::mode::read_write>(cgh);
+  public:
+
+    // The stages whose dU/dt this stage uses
+    static constexpr auto terms = rk_stage_terms<Tableau, Stage>();
+    static constexpr size_t NT = terms.size();
+
+  protected:
+
+    typename StepClock<ValueType>::Times times_;
+
+    SSAccessorRW Ustar_rw_;
+    SSAccessorRO U_ro_;
+    std::array<SSAccessorRO, NT> dUdt_ro_;
+
+    template<size_t I>
+    static constexpr float a(void)
+    {
+      return Tableau::a[Stage][terms[I]];
+    }
+
+    template<size_t... I>
+    ValueType combine(const size_t& vec_id,
+		      const sycl::id<1>& item,
+		      const ValueType& timestep,
+		      std::index_sequence<I...>) const
+    {
+      ValueType value = U_ro_[vec_id][item];
+      ((value += timestep * a<I>() * dUdt_ro_[I][vec_id][item]), ...);
+      return value;
+    }
+
+  public:
 
-      SSAccessorRO U_ro =
-	this->U_.template get_accessor<sycl::access::mode::read>(cgh);
+    RungeKuttaTableauStep(const typename StepClock<ValueType>::Times& times,
+			  const SSAccessorRW& Ustar_rw,
+			  const SSAccessorRO& U_ro,
+			  const std::array<SSAccessorRO, NT>& dUdt_ro)
+      : times_(times),
+	Ustar_rw_(Ustar_rw),
+	U_ro_(U_ro),
+	dUdt_ro_(dUdt_ro)
+    {}
+
+    void operator()(sycl::id<1> item) const {
+      update(item);
+    }
+
+    void update(const sycl::id<1>& item) const {
+      ValueType timestep = times_.timestep();
+      for (size_t vec_id = 0; vec_id < Ustar_rw_.size(); ++vec_id) {
+	Ustar_rw_[vec_id][item] =
+	  combine(vec_id, item, timestep, std::make_index_sequence<NT>());
+      }
       
-      std::array<SSAccessorRO, S> dUdt_ro;
-      for (size_t i = 0; i < S; ++i) {
-	dUdt_ro[i] =
-	  dUdt_[i].template get_accessor<sycl::access::mode::read>(cgh);
+      if (Ustar_rw_[0][item] < 0.0) {
+	Ustar_rw_[0][item] = 0.0;
+	Ustar_rw_[1][item] = 0.0;
+	Ustar_rw_[2][item] = 0.0;
+      } else if (Ustar_rw_[0][item] < 1e-4) {
+	Ustar_rw_[1][item] = 0.0;
+	Ustar_rw_[2][item] = 0.0;
       }
+    }
 
-      auto kernel = RungeKuttaStep(step, *coeffs_, time_now, timestep,
-				   Ustar_rw, U_ro, dUdt_ro);
+  };
+
+  // The final stage, which also finds the maximum control number (per
+  // unit time step) of the state at the start of the step while it is
+  // reading it anyway.
+  template<typename StepKernel, typename CellControlNumber>
+  class RungeKuttaFinalStep : public StepKernel
+  {
+  private:
+
+    CellControlNumber cell_cn_;
+
+  public:
+
+    RungeKuttaFinalStep(const StepKernel& step,
+			const CellControlNumber& cell_cn)
+      : StepKernel(step),
+	cell_cn_(cell_cn)
+    {}
+
+    template<typename Reducer>
+    void operator()(sycl::id<1> item, Reducer& max) const {
+      max.combine(cell_cn_(this->U_ro_, item[0]));
+      this->update(item);
+    }
+
+  };
+
+  // Call f with the stage as a compile-time constant
+  template<typename F, size_t... I>
+  static void with_stage(const size_t& step, const F& f,
+			 std::index_sequence<I...>)
+  {
+    ((step == I ? f(std::integral_constant<size_t, I>()) : void()), ...);
+  }
+
+  // Submit the update of U* for a stage with the kernel made by
+  // make_kernel, then calculate the dU/dt of the stage
+  template<typename MakeKernel>
+  void submit_stage(size_t step, const MakeKernel& make_kernel,
+		    const double& bdy_t0, const double& bdy_t1)
+  {
+    if (step < S or not this->clock_.rate_measured()) {
+      // With combine_stages_, U* of stages after the first was formed
+      // with the dU/dt of the stage before
+      if (step == 0 or step == S or not combine_stages_) {
+	this->queue_->submit([&] (sycl::handler& cgh) {
+	  auto kernel = make_kernel(cgh);
+	  this->solver_->parallel_for_elements(cgh, kernel);
+	});
+      }
+
+      if (step + 1 < S and combine_stages_) {
+	typename Solver::StageCombinationType next_stage;
+	next_stage.U = &(this->U_);
+	for (size_t i = 0; i < step; ++i) {
+	  next_stage.dUdt[i] = &(dUdt_[i]);
+	}
+	for (size_t i = 0; i <= step; ++i) {
+	  next_stage.a[i] = coeffs_->a(step + 1, i);
+	}
+	next_stage.terms = step + 1;
+	this->solver_->update_ddt_and_combine(Ustar_,
+					      dUdt_[step],
+					      this->clock_, coeffs_->c(step),
+					      bdy_t0, bdy_t1, next_stage);
+      } else if (step < S) {
+	this->solver_->update_ddt(Ustar_,
+				  dUdt_[step],
+				  this->clock_, coeffs_->c(step),
+				  bdy_t0, bdy_t1);
+      }
+    } else {
+      // The final stage reads every cell of U anyway, so take the
+      // maximum control number of U in the same pass. It is left on
+      // the device in the clock.
+      using CellControlNumber = typename Solver::CellControlNumberType;
+      this->queue_->submit([&] (sycl::handler& cgh) {
+	auto rate = this->clock_.get_rate_reduction(cgh);
+	auto step_kernel = make_kernel(cgh);
+	auto kernel = RungeKuttaFinalStep<decltype(step_kernel),
+					  CellControlNumber>
+	  (step_kernel, this->solver_->get_cell_control_number(1.0));
+	this->solver_->parallel_for_elements(cgh, rate, kernel);
+      });
+    }
+  }
+
+  void update_Ustar(size_t step,
+		    const double& bdy_t0, const double& bdy_t1)
+  {
+    if constexpr (std::is_void_v<Tableau>) {
+      submit_stage(step, [&] (sycl::handler& cgh) {
+	SSAccessorRW Ustar_rw =
+	  Ustar_.template get_accessor<sycl::access::mode::read_write>(cgh);
+
+	SSAccessorRO U_ro =
+	  this->U_.template get_accessor<sycl::access::mode::read>(cgh);
       
-      cgh.parallel_for(this->U_.get_range(), kernel);
-    });
+	std::array<SSAccessorRO, S> dUdt_ro;
+	for (size_t i = 0; i < S; ++i) {
+	  dUdt_ro[i] =
+	    dUdt_[i].template get_accessor<sycl::access::mode::read>(cgh);
+	}
 
-    if (step < S) {
-      this->solver_->update_ddt(Ustar_,
-				dUdt_[step],
-				time_now + coeffs_->c(step) * timestep,
-				timestep, bdy_t0, bdy_t1);
+	return RungeKuttaStep(step, *coeffs_, this->clock_.get_times(cgh),
+			      Ustar_rw, U_ro, dUdt_ro);
+      }, bdy_t0, bdy_t1);
+    } else {
+      with_stage(step, [&] (auto stage) {
+	using Kernel = RungeKuttaTableauStep<decltype(stage)::value>;
+	submit_stage(step, [&] (sycl::handler& cgh) {
+	  // Only bind the dU/dt of the stages this one uses
+	  std::array<SSAccessorRO, Kernel::NT> dUdt_ro;
+	  for (size_t i = 0; i < Kernel::NT; ++i) {
+	    dUdt_ro[i] = dUdt_[Kernel::terms[i]].template
+	      get_accessor<sycl::access::mode::read>(cgh);
+	  }
+
+	  return Kernel
+	    (this->clock_.get_times(cgh),
+	     Ustar_.template get_accessor<sycl::access::mode::read_write>(cgh),
+	     this->U_.template get_accessor<sycl::access::mode::read>(cgh),
+	     dUdt_ro);
+	}, bdy_t0, bdy_t1);
+      }, std::make_index_sequence<S+1>());
     }
   }
 
+  // Copy U* into U if the clock on the device accepted the step
+  class ConditionalAcceptStep
+  {
+  private:
+
+    typename StepClock<ValueType>::Times times_;
+    SSAccessorRO Ustar_ro_;
+    SSAccessorRW U_rw_;
+
+  public:
+
+    ConditionalAcceptStep(const typename StepClock<ValueType>::Times& times,
+			  const SSAccessorRO& Ustar_ro,
+			  const SSAccessorRW& U_rw)
+      : times_(times),
+	Ustar_ro_(Ustar_ro),
+	U_rw_(U_rw)
+    {}
+
+    void operator()(sycl::id<1> item) const {
+      if (not times_.step_accepted()) return;
+      for (size_t vec_id = 0; vec_id < U_rw_.size(); ++vec_id) {
+	U_rw_[vec_id][item] = Ustar_ro_[vec_id][item];
+      }
+    }
+
+  };
+
 public:
 
   RungeKuttaTemporalScheme(const std::shared_ptr<RungeKuttaCoefficientSet<S>>& coeffs)
     : TemporalScheme<Solver>(),
       coeffs_(coeffs),
       Ustar_("", this->U_, "*"),
-      dUdt_(construct_dUdt<S>())
+      dUdt_(construct_dUdt<S>()),
+      combine_stages_(false)
   {
+    static_assert(S <= Solver::StageCombinationType::MaxTerms,
+		  "Too many stages to combine in the temporal derivative");
+    Config empty;
+    const Config& config = GlobalConfig::instance().configuration().get_child("temporal scheme", empty);
+    combine_stages_ = config.get<bool>("combine stages", false);
+    if (combine_stages_) {
+      if (not this->solver_->supports_stage_combination()) {
+	std::cerr << "Runge-Kutta stages cannot be combined in the "
+		  << "temporal derivative with the fused kernel."
+		  << std::endl;
+	throw std::runtime_error("Stage combination not supported by solver");
+      }
+      std::cout << "Forming each Runge-Kutta stage in the temporal "
+		<< "derivative of the stage before." << std::endl;
+    }
   }
 
   virtual ~RungeKuttaTemporalScheme(void) {}
 
-  virtual void step(const double& time_now, const double& timestep,
-		    const double& bdy_t0, const double& bdy_t1)
+  virtual void step(const double& bdy_t0, const double& bdy_t1)
   {
     for (size_t st = 0; st <= S; ++st) {
       //std::cout << "sub-step " << st << std::endl;
-      update_Ustar(st, time_now, timestep, bdy_t0, bdy_t1);
+      update_Ustar(st, bdy_t0, bdy_t1);
     }
   }
 
+  virtual double get_control_number(const double& timestep)
+  {
+    return this->clock_.get_rate() * timestep;
+  }
+
+  // Stages can only be combined without the fused kernel
+  virtual bool allows_fused_kernel(void) const
+  {
+    return not combine_stages_;
+  }
+
   virtual void accept_step(void)
   {
     std::swap(this->U_, Ustar_);
   }
 
+  virtual void accept_step_on_device(void)
+  {
+    this->queue_->submit([&] (sycl::handler& cgh) {
+      auto kernel = ConditionalAcceptStep
+	(this->clock_.get_times(cgh),
+	 Ustar_.template get_accessor<sycl::access::mode::read>(cgh),
+	 this->U_.template get_accessor<sycl::access::mode::read_write>(cgh));
+      this->solver_->parallel_for_elements(cgh, kernel);
+    });
+  }
+
   virtual void end_of_step(void)
   {
     // U_.end_of_step(this->queue_);
@@ -237,6 +483,16 @@ public:
   {
   }
 
+  // Create a scheme using one of the tableaux in RungeKuttaTableaux.hpp
+  template<typename Tab>
+  static std::shared_ptr<TemporalScheme<Solver>>
+  create_from_tableau(void)
+  {
+    auto coeffs = std::make_shared<RungeKuttaCoefficientSet<Tab::S>>
+      (Tab::a, Tab::c);
+    return std::make_shared<RungeKuttaTemporalScheme<Solver,Tab::S,Tab>>(coeffs);
+  }
+
   static std::shared_ptr<TemporalScheme<Solver>>
   create(void)
   {
@@ -249,48 +505,13 @@ public:
 		<< method << "':" << std::endl;
       
       if (method == "Euler") {
-	std::shared_ptr<RungeKuttaCoefficientSet<1>> coeffs
-	  = std::make_shared<RungeKuttaCoefficientSet<1>>
-	  (std::array<std::array<float, 1>,2>({{
-		{0.0,},
-		{1.0,},
-	      }}),
-	    //std::array<float, 1>({{1.0,}}),
-	    std::array<float, 1>({{0.0,}}));
-	return std::make_shared<RungeKuttaTemporalScheme<Solver,1>>(coeffs);
+	return create_from_tableau<EulerTableau>();
       } else if (method == "midpoint") {
-	std::shared_ptr<RungeKuttaCoefficientSet<2>> coeffs
-	  = std::make_shared<RungeKuttaCoefficientSet<2>>
-	  (std::array<std::array<float, 2>,3>({{
-		{0.0, 0.0},
-		{0.5, 0.0},
-		{0.0, 1.0},
-	      }}),
-	    // std::array<float, 2>({{0.0, 1.0}}),
-	    std::array<float, 2>({{0.0, 0.5}}));
-	return std::make_shared<RungeKuttaTemporalScheme<Solver,2>>(coeffs);
+	return create_from_tableau<MidpointTableau>();
       } else if (method == "Heun") {
-	std::shared_ptr<RungeKuttaCoefficientSet<2>> coeffs
-	  = std::make_shared<RungeKuttaCoefficientSet<2>>
-	  (std::array<std::array<float, 2>,3>({{
-		{0.0, 0.0},
-		{1.0, 0.0},
-		{0.5, 0.5},
-	      }}),
-	    // std::array<float, 2>({{0.0, 1.0}}),
-	    std::array<float, 2>({{0.0, 1.0}}));
-	return std::make_shared<RungeKuttaTemporalScheme<Solver,2>>(coeffs);
+	return create_from_tableau<HeunTableau>();
       } else if (method == "Ralston") {
-	std::shared_ptr<RungeKuttaCoefficientSet<2>> coeffs
-	  = std::make_shared<RungeKuttaCoefficientSet<2>>
-	  (std::array<std::array<float, 2>,3>({{
-		{0.0, 0.0},
-		{2.0/3.0, 0.0},
-		{0.25, 0.75},
-	      }}),
-	    // std::array<float, 2>({{0.0, 1.0}}),
-	    std::array<float, 2>({{0.0, 2.0/3.0}}));
-	return std::make_shared<RungeKuttaTemporalScheme<Solver,2>>(coeffs);
+	return create_from_tableau<RalstonTableau>();
       } else if (method == "generic2") {
 	float alpha = config.get<float>("alpha");
 	std::shared_ptr<RungeKuttaCoefficientSet<2>> coeffs
@@ -304,53 +525,13 @@ public:
 	    std::array<float, 2>({{0.0, alpha}}));
 	return std::make_shared<RungeKuttaTemporalScheme<Solver,2>>(coeffs);
       } else if (method == "Kutta3") {
-	std::shared_ptr<RungeKuttaCoefficientSet<3>> coeffs
-	  = std::make_shared<RungeKuttaCoefficientSet<3>>
-	  (std::array<std::array<float, 3>,4>({{
-		{0.0, 0.0, 0.0},
-		{0.5, 0.0, 0.0},
-		{-1.0, 2.0, 0.0},
-		{1.0/6.0, 2.0/3.0, 1.0/6.0},
-	      }}),
-	    // std::array<float, 2>({{0.0, 1.0}}),
-	    std::array<float, 3>({{0.0, 0.5, 1.0}}));
-	return std::make_shared<RungeKuttaTemporalScheme<Solver,3>>(coeffs);
+	return create_from_tableau<Kutta3Tableau>();
       } else if (method == "Heun3") {
-	std::shared_ptr<RungeKuttaCoefficientSet<3>> coeffs
-	  = std::make_shared<RungeKuttaCoefficientSet<3>>
-	  (std::array<std::array<float, 3>,4>({{
-		{0.0, 0.0, 0.0},
-		{1.0/3.0, 0.0, 0.0},
-		{0.0, 2.0/3.0, 0.0},
-		{0.25, 0.0, 0.75},
-	      }}),
-	    // std::array<float, 2>({{0.0, 1.0}}),
-	    std::array<float, 3>({{0.0, 1.0/3.0, 2.0/3.0}}));
-	return std::make_shared<RungeKuttaTemporalScheme<Solver,3>>(coeffs);
+	return create_from_tableau<Heun3Tableau>();
       } else if (method == "Ralston3") {
-	std::shared_ptr<RungeKuttaCoefficientSet<3>> coeffs
-	  = std::make_shared<RungeKuttaCoefficientSet<3>>
-	  (std::array<std::array<float, 3>,4>({{
-		{0.0, 0.0, 0.0},
-		{0.5, 0.0, 0.0},
-		{0.0, 0.75, 0.0},
-		{2.0/9.0, 1.0/3.0, 4.0/9.0},
-	      }}),
-	    // std::array<float, 2>({{0.0, 1.0}}),
-	    std::array<float, 3>({{0.0, 0.5, 0.75}}));
-	return std::make_shared<RungeKuttaTemporalScheme<Solver,3>>(coeffs);
+	return create_from_tableau<Ralston3Tableau>();
       } else if (method == "SSPRK3") {
-	std::shared_ptr<RungeKuttaCoefficientSet<3>> coeffs
-	  = std::make_shared<RungeKuttaCoefficientSet<3>>
-	  (std::array<std::array<float, 3>,4>({{
-		{0.0, 0.0, 0.0},
-		{1.0, 0.0, 0.0},
-		{0.25, 0.25, 0.0},
-		{1.0/6.0, 1.0/6.0, 2.0/3.0},
-	      }}),
-	    // std::array<float, 2>({{0.0, 1.0}}),
-	    std::array<float, 3>({{0.0, 1.0, 0.5}}));
-	return std::make_shared<RungeKuttaTemporalScheme<Solver,3>>(coeffs);
+	return create_from_tableau<SSPRK3Tableau>();
       } else if (method == "generic3") {
 	float alpha = config.get<float>("alpha");
 	std::shared_ptr<RungeKuttaCoefficientSet<3>> coeffs
@@ -369,44 +550,11 @@ public:
 	    std::array<float, 3>({{0.0, alpha, 1.0}}));
 	return std::make_shared<RungeKuttaTemporalScheme<Solver,3>>(coeffs);
       } else if (method == "classic") {
-	std::shared_ptr<RungeKuttaCoefficientSet<4>> coeffs
-	  = std::make_shared<RungeKuttaCoefficientSet<4>>
-	  (std::array<std::array<float, 4>,5>({{
-		{0.0, 0.0, 0.0, 0.0},
-		{0.5, 0.0, 0.0, 0.0},
-		{0.0, 0.5, 0.0, 0.0},
-		{0.0, 0.0, 1.0, 0.0},
-		{1.0/6.0, 1.0/3.0, 1.0/3.0, 1.0/6.0},
-	      }}),
-	    // std::array<float, 4>({{1.0/6.0, 1.0/3.0, 1.0/3.0, 1.0/6.0}}),
-	    std::array<float, 4>({{0.0, 0.5, 0.5, 1.0}}));
-	return std::make_shared<RungeKuttaTemporalScheme<Solver,4>>(coeffs);
+	return create_from_tableau<ClassicTableau>();
       } else if (method == "Ralston4") {
-	std::shared_ptr<RungeKuttaCoefficientSet<4>> coeffs
-	  = std::make_shared<RungeKuttaCoefficientSet<4>>
-	  (std::array<std::array<float, 4>,5>({{
-		{       0.0,         0.0,        0.0, 0.0},
-		{       0.4,         0.0,        0.0, 0.0},
-		{0.29697761,  0.15875964,        0.0, 0.0},
-		{0.21810040, -3.05096516, 3.83286476, 0.0},
-		{0.17476028, -0.55148066, 1.20553560, 0.17118478},
-	      }}),
-	    // std::array<float, 4>({{1.0/6.0, 1.0/3.0, 1.0/3.0, 1.0/6.0}}),
-	    std::array<float, 4>({{0.0, 0.4, 0.45573725, 1.0}}));
-	return std::make_shared<RungeKuttaTemporalScheme<Solver,4>>(coeffs);
+	return create_from_tableau<Ralston4Tableau>();
       } else if (method == "3/8") {
-	std::shared_ptr<RungeKuttaCoefficientSet<4>> coeffs
-	  = std::make_shared<RungeKuttaCoefficientSet<4>>
-	  (std::array<std::array<float, 4>,5>({{
-		{ 0.0, 0.0, 0.0, 0.0},
-		{ 1.0/3.0, 0.0, 0.0, 0.0},
-		{ -1.0/3.0, 1.0, 0.0, 0.0},
-		{ 1.0, -1.0, 1.0, 0.0},
-		{ 1.0/8.0, 3.0/8.0, 3.0/8.0, 1.0/8.0},
-	      }}),
-	    // std::array<float, 4>({{1.0/6.0, 1.0/3.0, 1.0/3.0, 1.0/6.0}}),
-	    std::array<float, 4>({{0.0, 1.0/3.0, 2.0/3.0, 1.0}}));
-	return std::make_shared<RungeKuttaTemporalScheme<Solver,4>>(coeffs);
+	return create_from_tableau<ThreeEighthsTableau>();
       } else {
 	std::cerr << "Temporal Scheme \"" << method << "\" not known." << std::endl;
 	throw std::runtime_error("Temporal scheme not known");
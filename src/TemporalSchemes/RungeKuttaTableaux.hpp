@@ -0,0 +1,177 @@
+/***********************************************************************
+ * TemporalSchemes/RungeKuttaTableaux.hpp
+ *
+ * Butcher tableaux of the named Runge-Kutta schemes, known at compile
+ * time so that the stage update kernels of RungeKuttaTemporalScheme
+ * can be specialised for each stage: the coefficient loops unroll,
+ * terms with zero coefficients drop out and the dU/dt of a stage is
+ * only bound to the kernels that use it.
+ *
+ * Row i < S of a holds the coefficients of stage i, row S those of the
+ * final combination.
+ *
+ * Copyright (C) Gerald C J Morgan 2021
+ ***********************************************************************/
+
+#ifndef TemporalSchemes_RungeKuttaTableaux_hpp
+#define TemporalSchemes_RungeKuttaTableaux_hpp
+
+#include <array>
+#include <utility>
+
+struct EulerTableau
+{
+  static constexpr int S = 1;
+  static constexpr std::array<std::array<float, S>, S+1> a = {{
+      {0.0,},
+      {1.0,},
+    }};
+  static constexpr std::array<float, S> c = {{0.0,}};
+};
+
+struct MidpointTableau
+{
+  static constexpr int S = 2;
+  static constexpr std::array<std::array<float, S>, S+1> a = {{
+      {0.0, 0.0},
+      {0.5, 0.0},
+      {0.0, 1.0},
+    }};
+  static constexpr std::array<float, S> c = {{0.0, 0.5}};
+};
+
+struct HeunTableau
+{
+  static constexpr int S = 2;
+  static constexpr std::array<std::array<float, S>, S+1> a = {{
+      {0.0, 0.0},
+      {1.0, 0.0},
+      {0.5, 0.5},
+    }};
+  static constexpr std::array<float, S> c = {{0.0, 1.0}};
+};
+
+struct RalstonTableau
+{
+  static constexpr int S = 2;
+  static constexpr std::array<std::array<float, S>, S+1> a = {{
+      {0.0, 0.0},
+      {2.0/3.0, 0.0},
+      {0.25, 0.75},
+    }};
+  static constexpr std::array<float, S> c = {{0.0, 2.0/3.0}};
+};
+
+struct Kutta3Tableau
+{
+  static constexpr int S = 3;
+  static constexpr std::array<std::array<float, S>, S+1> a = {{
+      {0.0, 0.0, 0.0},
+      {0.5, 0.0, 0.0},
+      {-1.0, 2.0, 0.0},
+      {1.0/6.0, 2.0/3.0, 1.0/6.0},
+    }};
+  static constexpr std::array<float, S> c = {{0.0, 0.5, 1.0}};
+};
+
+struct Heun3Tableau
+{
+  static constexpr int S = 3;
+  static constexpr std::array<std::array<float, S>, S+1> a = {{
+      {0.0, 0.0, 0.0},
+      {1.0/3.0, 0.0, 0.0},
+      {0.0, 2.0/3.0, 0.0},
+      {0.25, 0.0, 0.75},
+    }};
+  static constexpr std::array<float, S> c = {{0.0, 1.0/3.0, 2.0/3.0}};
+};
+
+struct Ralston3Tableau
+{
+  static constexpr int S = 3;
+  static constexpr std::array<std::array<float, S>, S+1> a = {{
+      {0.0, 0.0, 0.0},
+      {0.5, 0.0, 0.0},
+      {0.0, 0.75, 0.0},
+      {2.0/9.0, 1.0/3.0, 4.0/9.0},
+    }};
+  static constexpr std::array<float, S> c = {{0.0, 0.5, 0.75}};
+};
+
+struct SSPRK3Tableau
+{
+  static constexpr int S = 3;
+  static constexpr std::array<std::array<float, S>, S+1> a = {{
+      {0.0, 0.0, 0.0},
+      {1.0, 0.0, 0.0},
+      {0.25, 0.25, 0.0},
+      {1.0/6.0, 1.0/6.0, 2.0/3.0},
+    }};
+  static constexpr std::array<float, S> c = {{0.0, 1.0, 0.5}};
+};
+
+struct ClassicTableau
+{
+  static constexpr int S = 4;
+  static constexpr std::array<std::array<float, S>, S+1> a = {{
+      {0.0, 0.0, 0.0, 0.0},
+      {0.5, 0.0, 0.0, 0.0},
+      {0.0, 0.5, 0.0, 0.0},
+      {0.0, 0.0, 1.0, 0.0},
+      {1.0/6.0, 1.0/3.0, 1.0/3.0, 1.0/6.0},
+    }};
+  static constexpr std::array<float, S> c = {{0.0, 0.5, 0.5, 1.0}};
+};
+
+struct Ralston4Tableau
+{
+  static constexpr int S = 4;
+  static constexpr std::array<std::array<float, S>, S+1> a = {{
+      {       0.0,         0.0,        0.0, 0.0},
+      {       0.4,         0.0,        0.0, 0.0},
+      {0.29697761,  0.15875964,        0.0, 0.0},
+      {0.21810040, -3.05096516, 3.83286476, 0.0},
+      {0.17476028, -0.55148066, 1.20553560, 0.17118478},
+    }};
+  static constexpr std::array<float, S> c = {{0.0, 0.4, 0.45573725, 1.0}};
+};
+
+struct ThreeEighthsTableau
+{
+  static constexpr int S = 4;
+  static constexpr std::array<std::array<float, S>, S+1> a = {{
+      { 0.0, 0.0, 0.0, 0.0},
+      { 1.0/3.0, 0.0, 0.0, 0.0},
+      { -1.0/3.0, 1.0, 0.0, 0.0},
+      { 1.0, -1.0, 1.0, 0.0},
+      { 1.0/8.0, 3.0/8.0, 3.0/8.0, 1.0/8.0},
+    }};
+  static constexpr std::array<float, S> c = {{0.0, 1.0/3.0, 2.0/3.0, 1.0}};
+};
+
+// Number of earlier stages whose dU/dt is used by a stage (or, for
+// Stage == S, by the final combination)
+template<typename Tableau, size_t Stage>
+constexpr size_t rk_stage_term_count(void)
+{
+  size_t n = 0;
+  for (size_t i = 0; i < Stage; ++i) {
+    if (Tableau::a[Stage][i] != 0.0f) n++;
+  }
+  return n;
+}
+
+// Indices of those stages
+template<typename Tableau, size_t Stage>
+constexpr std::array<size_t, rk_stage_term_count<Tableau, Stage>()>
+rk_stage_terms(void)
+{
+  std::array<size_t, rk_stage_term_count<Tableau, Stage>()> terms = {};
+  size_t n = 0;
+  for (size_t i = 0; i < Stage; ++i) {
+    if (Tableau::a[Stage][i] != 0.0f) terms[n++] = i;
+  }
+  return terms;
+}
+
+#endif
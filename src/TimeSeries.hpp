@@ -218,8 +218,8 @@ public:
 
   void bind(sycl::handler& cgh)
   {
-    cgh.require(time_ro_);
-    cgh.require(values_ro_);
+    DataArray<double>::require(cgh, time_ro_);
+    DataArray<T>::require(cgh, values_ro_);
   }
   
   T operator()(const double& time,
@@ -11,6 +11,8 @@
 #include "SVSolver.hpp"
 #include "SpatialDerivative.hpp"
 #include "TemporalSchemes/RungeKutta.hpp"
+#include "TemporalSchemes/LowStorageRungeKutta.hpp"
+#include "TemporalSchemes/LocalTimestep.hpp"
 
 #include "GlobalConfig.cpp"
 #include "Config.cpp"
@@ -19,19 +21,174 @@
 #include "OutputFormat.cpp"
 #include "BoundaryConditions/SVBoundaryCondition.cpp"
 
+template<typename Solver>
+std::shared_ptr<TemporalScheme<Solver>> create_temporal_scheme(void)
+{
+  Config empty;
+  const Config& ts_conf = GlobalConfig::instance().configuration().get_child("temporal scheme", empty);
+  std::string method = ts_conf.get<std::string>("method", "");
+  if (method == "local") {
+    return LocalTimestepTemporalScheme<Solver>::create();
+  } else if (LowStorageRungeKuttaTemporalScheme<Solver>::is_method(method)) {
+    return LowStorageRungeKuttaTemporalScheme<Solver>::create();
+  } else {
+    return RungeKuttaTemporalScheme<Solver,1>::create();
+  }
+}
+
+// Run the simulation with the exact and then the fast math profile
+// (see MathProfile.hpp) and compare the depths at the end of the two
+// runs. The exact run writes no output, so the output written is that
+// of the fast run. Throws if the depths differ anywhere by more than
+// the tolerance, or if the fast run has gone NaN where the exact run
+// has not.
+template<typename Solver>
+void compare_math_profiles(void)
+{
+  using MathProfile = GlobalConfig::SolverParameters::MathProfile;
+  using ValueType = typename Solver::ValueType;
+
+  std::array<std::vector<ValueType>,2> h;
+  std::array<MathProfile,2> profiles = { MathProfile::exact,
+					 MathProfile::fast };
+  for (size_t k = 0; k < 2; ++k) {
+    std::cout << "Running with the "
+	      << (profiles[k] == MathProfile::exact ? "exact" : "fast")
+	      << " math profile." << std::endl;
+    GlobalConfig::instance().select_math_profile(profiles[k]);
+    auto scheme = create_temporal_scheme<Solver>();
+    if (k == 0) {
+      scheme->write_check_files();
+      scheme->disable_output();
+      std::cout << "Output is not written for the exact run; the "
+		<< "output written is that of the fast run." << std::endl;
+    }
+    scheme->run();
+
+    // The output function brings the depths back to the host
+    auto depth = scheme->get_output_function("depth");
+    h[k].resize(depth->output_size());
+    for (size_t i = 0; i < h[k].size(); ++i) {
+      h[k][i] = depth->output_values(i).at(0);
+    }
+  }
+
+  // Only cells wet in either run are counted, so that the mean is not
+  // diluted by the dry parts of the mesh
+  double max_diff = 0.0;
+  double sum_diff = 0.0;
+  size_t max_cell = 0;
+  size_t wet_cells = 0;
+  for (size_t i = 0; i < h[0].size(); ++i) {
+    if (not (h[0][i] > 0.0f or h[1][i] > 0.0f)) continue;
+    double diff = std::fabs((double) h[1][i] - (double) h[0][i]);
+    if (std::isnan(diff)) diff = std::numeric_limits<double>::infinity();
+    if (diff > max_diff) {
+      max_diff = diff;
+      max_cell = i;
+    }
+    sum_diff += diff;
+    wet_cells++;
+  }
+  double mean_diff = (wet_cells > 0 ? sum_diff / wet_cells : 0.0);
+  double tolerance =
+    GlobalConfig::instance().get_solver_parameters().math_profile_tolerance;
+
+  DisplayTable<std::string, std::string> results
+    ({ {40, "Depth difference (fast - exact)", "%|s|"},
+       {20, "Value", "%|s|"} });
+  std::cout << "   Math profile comparison:" << std::endl;
+  results.write_top_rule();
+  results.write_header_row();
+  results.write_mid_rule();
+  results.write_data_row("Wet cells", std::to_string(wet_cells));
+  results.write_data_row("Maximum |Δh| (m)", std::to_string(max_diff));
+  results.write_data_row("Cell of maximum", std::to_string(max_cell));
+  results.write_data_row("Mean |Δh| (m)", std::to_string(mean_diff));
+  results.write_data_row("Tolerance (m)", std::to_string(tolerance));
+  results.write_bot_rule();
+
+  if (not (max_diff <= tolerance)) {
+    std::cerr << "Depths of the fast math profile differ from those of "
+	      << "the exact math profile by up to " << max_diff
+	      << " m, more than the tolerance of " << tolerance << " m."
+	      << std::endl;
+    throw std::runtime_error("Math profile comparison failed");
+  }
+  std::cout << "Fast math profile is within tolerance." << std::endl;
+}
+
+template<typename Solver>
+void run_simulation(void)
+{
+  if (GlobalConfig::instance().get_solver_parameters().compare_math_profiles) {
+    compare_math_profiles<Solver>();
+    return;
+  }
+
+  auto scheme = create_temporal_scheme<Solver>();
+  scheme->write_check_files();
+  scheme->run();
+}
+
+// Select the solver for the constant storage configured
+template<FieldStorage StateStorage, typename Precision>
+void run_with_storage(void)
+{
+  using ConstantStorage = GlobalConfig::SolverParameters::ConstantStorage;
+  using ValueType = typename Precision::ValueType;
+  const auto& sp = GlobalConfig::instance().get_solver_parameters();
+#ifdef MORGFLOW_HALF_CONSTANTS
+  if (sp.constant_storage == ConstantStorage::half) {
+    run_simulation<SVSolver<StateStorage, sycl::half, Precision>>();
+    return;
+  }
+#endif
+  run_simulation<SVSolver<StateStorage, ValueType, Precision>>();
+}
+
+// Select the solver for the state storage configured. The interleaved
+// state and half-precision constants are only built with
+// MORGFLOW_INTERLEAVED_STATE and MORGFLOW_HALF_CONSTANTS defined, as
+// each doubles the number of solvers compiled.
+template<typename Precision>
+void run_with_precision(void)
+{
+  using StateStorage = GlobalConfig::SolverParameters::StateStorage;
+  const auto& sp = GlobalConfig::instance().get_solver_parameters();
+  switch (sp.state_storage) {
+#ifdef MORGFLOW_INTERLEAVED_STATE
+  case StateStorage::interleaved:
+    run_with_storage<FieldStorage::Interleaved, Precision>();
+    break;
+#endif
+  case StateStorage::separate:
+  default:
+    run_with_storage<FieldStorage::Separate, Precision>();
+    break;
+  }
+}
+
 int main(int argc, char* argv[])
 {
   std::locale loc;
   GlobalConfig::init(argc, argv);
 
   std::cout << "Initialised global configuration" << std::endl;
-  using Solver = SVSolver;
-  
-  std::shared_ptr<TemporalScheme<Solver>> scheme =
-    RungeKuttaTemporalScheme<Solver,1>::create();
 
-  scheme->write_check_files();
-  scheme->run();
+  using Precision = GlobalConfig::SolverParameters::Precision;
+  switch (GlobalConfig::instance().get_solver_parameters().precision) {
+  case Precision::double_precision:
+    run_with_precision<DoublePrecision>();
+    break;
+  case Precision::mixed_precision:
+    run_with_precision<MixedPrecision>();
+    break;
+  case Precision::single_precision:
+  default:
+    run_with_precision<SinglePrecision>();
+    break;
+  }
 
   return 0;
 };
@@ -5,12 +5,18 @@
 #ifndef sycl_hpp
 #define sycl_hpp
 
+// Builds with MORGFLOW_HOST_BACKEND defined run the kernels directly
+// on host memory, without a SYCL implementation (see HostBackend.hpp)
+#ifdef MORGFLOW_HOST_BACKEND
+#include "HostBackend.hpp"
+#else
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wnull-conversion"
 #pragma GCC diagnostic ignored "-Wignored-attributes"
 #include <CL/sycl.hpp>
 namespace sycl = cl::sycl;
 #pragma GCC diagnostic pop
+#endif
 
 /*
 std::vector<std::string> platform_name_list(void)